@@ -0,0 +1,82 @@
+#include "../../GeometryExporter/code/GeoFile.h"
+#include "../../GeometryExporter/code/GeoAoBaker.h"
+
+#include <Utils/Log.h>
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bakes per vertex ambient occlusion into an exported .geo, without 3ds Max,
+// so it can run on a build machine. Every mesh of the file is baked and
+// occludes the others.
+//
+// GeoAoTool <input.geo> [output.geo] [-samples n] [-distance d]
+//
+// Without output, the input file is replaced. Sources don't depend on
+// Windows, outside of it the tool builds with something like
+//
+// g++ -O2 -pthread -I<Framework> code/main.cpp ../GeometryExporter/code/GeoFile.cpp
+//     ../GeometryExporter/code/GeoAoBaker.cpp ../GeometryExporter/code/scene3d/AoBaker.cpp
+//     ../GeometryExporter/code/scene3d/Bvh.cpp <Framework>/IO/BinaryReader.cpp
+//     <Framework>/IO/BinaryWriter.cpp <Framework>/Graphics/VertexInformation.cpp
+//     <Framework>/Utils/Log.cpp
+int main(int argc, char **argv)
+{
+	std::string inputFileName;
+	std::string outputFileName;
+	int samplesCount = 64;
+	float distance = 0.0f;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-samples") == 0 && i + 1 < argc)
+			samplesCount = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-distance") == 0 && i + 1 < argc)
+			distance = (float)atof(argv[++i]);
+		else if (inputFileName.empty())
+			inputFileName = argv[i];
+		else if (outputFileName.empty())
+			outputFileName = argv[i];
+		else
+			inputFileName.clear();
+	}
+
+	if (inputFileName.empty() || samplesCount < 1 || distance < 0.0f)
+	{
+		printf("usage: GeoAoTool <input.geo> [output.geo] [-samples n] [-distance d]\n");
+		return 1;
+	}
+
+	if (outputFileName.empty())
+		outputFileName = inputFileName;
+
+	Log::StartLog(true, false, false);
+
+	GeoFile geoFile;
+	if (!geoFile.Load(inputFileName))
+	{
+		printf("couldn't load '%s', see the log for details\n", inputFileName.c_str());
+		return 1;
+	}
+
+	std::vector<GeoFile*> files;
+	files.push_back(&geoFile);
+
+	if (!GeoAoBaker::Bake(files, NULL, samplesCount, distance) ||
+		!geoFile.Save(outputFileName))
+	{
+		printf("couldn't bake '%s', see the log for details\n", inputFileName.c_str());
+		return 1;
+	}
+
+	// the manifest describes the file before the bake, a patch made against it wouldn't apply
+	if (outputFileName == inputFileName)
+		remove((inputFileName + ".manifest").c_str());
+
+	printf("ambient occlusion baked into '%s'\n", outputFileName.c_str());
+
+	return 0;
+}
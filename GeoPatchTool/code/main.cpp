@@ -0,0 +1,51 @@
+#include "..\..\GeometryExporter\code\GeoPatch.h"
+
+#include <Utils/Log.h>
+
+#include <string>
+#include <stdio.h>
+
+// Applies a patch made by GeometryExporter to the previous version of a .geo
+//
+// GeoPatchTool <base.geo> <file.geo.patch> [output.geo]
+//
+// Without output, the base file is replaced with the patched one.
+int main(int argc, char **argv)
+{
+	if (argc != 3 && argc != 4)
+	{
+		printf("usage: GeoPatchTool <base.geo> <file.geo.patch> [output.geo]\n");
+		return 1;
+	}
+
+	Log::StartLog(true, false, false);
+
+	std::string baseFileName = argv[1];
+	std::string patchFileName = argv[2];
+	std::string outputFileName = argc == 4 ? argv[3] : baseFileName;
+
+	bool inPlace = outputFileName == baseFileName;
+	std::string targetFileName = inPlace ? outputFileName + ".tmp" : outputFileName;
+
+	if (!GeoPatch::Apply(baseFileName, patchFileName, targetFileName))
+	{
+		printf("couldn't apply '%s' to '%s', see the log for details\n", patchFileName.c_str(), baseFileName.c_str());
+		remove(targetFileName.c_str());
+		return 1;
+	}
+
+	if (inPlace)
+	{
+		remove(baseFileName.c_str());
+
+		if (rename(targetFileName.c_str(), baseFileName.c_str()) != 0)
+		{
+			printf("couldn't replace '%s', patched file left in '%s'\n", baseFileName.c_str(), targetFileName.c_str());
+			return 1;
+		}
+	}
+
+	printf("'%s' patched\n", outputFileName.c_str());
+
+	return 0;
+}
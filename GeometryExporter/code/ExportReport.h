@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "scene3d/MeshPartStats.h"
+
+// Collects per mesh and per part statistics during the export and saves
+// them as a JSON report next to the exported file.
+class ExportReport
+{
+public:
+	enum Stage
+	{
+		Stage_ConvertMesh, // whole ConvertMesh call, property collection included
+		Stage_Properties,
+		Stage_Serialization,
+
+		StagesCount
+	};
+
+	void Clear();
+
+	void BeginMesh(int id, const std::string &name);
+	void AddTime(Stage stage, double seconds);
+	void AddPart(const MeshPartStats &partStats);
+	void SkipMesh();
+
+	bool Save(const std::string &fileName, const std::string &exportedFileName) const;
+
+private:
+	class MeshEntry
+	{
+	public:
+		int id;
+		std::string name;
+		bool exported;
+		double times[StagesCount];
+		std::vector<MeshPartStats> parts;
+	};
+
+	static const char *StageNames[StagesCount];
+
+	std::vector<MeshEntry> meshes;
+};
@@ -0,0 +1,281 @@
+#include "ExportSettings.h"
+
+#include <windows.h>
+#include <Utils/Log.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+const char *ExportSettings::Section = "GeometryExporter";
+
+ExportSettings::ExportSettings() :
+	Profile("desktop"),
+	MaxIndexBits(32),
+	OutOfCoreFaceThreshold(2000000),
+	OutOfCoreWindowFaces(65536),
+	OutOfCoreMemoryMB(256),
+	WritePatch(1),
+	SectorMode("none"),
+	SectorSize(100.0f),
+	SectorMaxMeshes(32),
+	WireEdges(1),
+	WireFeatureAngle(0.0f),
+	SdfBake(0),
+	SdfResolution(32),
+	SdfRange(8.0f),
+	AoBake(0),
+	AoSamples(64),
+	AoDistance(0.0f),
+	BvhMode("none"),
+	OccluderResolution(32),
+	OccluderMaxBoxes(16),
+	SampleDensity(0.0f),
+	SampleSeed(1),
+	SampleMaxCount(65536),
+	NormalMapBake(0),
+	NormalMapSize(1024),
+	NormalMapDistance(0.0f),
+	ProgressiveParts(0),
+	ProgressiveMinTriangles(1024),
+	ProgressiveBaseRatio(0.05f),
+	PropertyKeyTolerance(0.001f),
+	PropertySampleRate(0.0f)
+{
+}
+
+void ExportSettings::Load(const std::string &fileName)
+{
+	char value[256];
+
+	GetPrivateProfileStringA(Section, "Profile", Profile.c_str(), value, sizeof(value), fileName.c_str());
+	Profile = value;
+
+	// mobile profile has no 32-bit index support
+	MaxIndexBits = Profile == "mobile" ? 16 : 32;
+	MaxIndexBits = GetPrivateProfileIntA(Section, "MaxIndexBits", MaxIndexBits, fileName.c_str());
+
+	if (MaxIndexBits != 16 && MaxIndexBits != 32)
+	{
+		Log::LogT("warning: MaxIndexBits must be 16 or 32, got %d, using 32", MaxIndexBits);
+		MaxIndexBits = 32;
+	}
+
+	OutOfCoreFaceThreshold = GetPrivateProfileIntA(Section, "OutOfCoreFaceThreshold", OutOfCoreFaceThreshold, fileName.c_str());
+	OutOfCoreWindowFaces = GetPrivateProfileIntA(Section, "OutOfCoreWindowFaces", OutOfCoreWindowFaces, fileName.c_str());
+	OutOfCoreMemoryMB = GetPrivateProfileIntA(Section, "OutOfCoreMemoryMB", OutOfCoreMemoryMB, fileName.c_str());
+
+	if (OutOfCoreWindowFaces < 1)
+		OutOfCoreWindowFaces = 1;
+	if (OutOfCoreMemoryMB < 1)
+		OutOfCoreMemoryMB = 1;
+
+	// the budget is counted in 32-bit bytes
+	if (OutOfCoreMemoryMB > 4095)
+	{
+		Log::LogT("warning: OutOfCoreMemoryMB can be at most 4095, got %d", OutOfCoreMemoryMB);
+		OutOfCoreMemoryMB = 4095;
+	}
+
+	GetPrivateProfileStringA(Section, "TempDir", "", value, sizeof(value), fileName.c_str());
+	TempDir = value;
+
+	if (TempDir.size() == 0)
+	{
+		GetTempPathA(sizeof(value), value);
+		TempDir = value;
+	}
+
+	if (!TempDir.empty() && TempDir[TempDir.size() - 1] != '\\' && TempDir[TempDir.size() - 1] != '/')
+		TempDir += "\\";
+
+	WritePatch = GetPrivateProfileIntA(Section, "WritePatch", WritePatch, fileName.c_str());
+
+	GetPrivateProfileStringA(Section, "SectorMode", SectorMode.c_str(), value, sizeof(value), fileName.c_str());
+	SectorMode = value;
+
+	if (SectorMode != "none" && SectorMode != "grid" && SectorMode != "adaptive")
+	{
+		Log::LogT("warning: unknown SectorMode '%s', using none", SectorMode.c_str());
+		SectorMode = "none";
+	}
+
+	char defaultValue[32];
+	sprintf(defaultValue, "%f", SectorSize);
+	GetPrivateProfileStringA(Section, "SectorSize", defaultValue, value, sizeof(value), fileName.c_str());
+	SectorSize = (float)atof(value);
+
+	if (SectorSize <= 0.0f)
+	{
+		Log::LogT("warning: SectorSize must be positive, using 100");
+		SectorSize = 100.0f;
+	}
+
+	SectorMaxMeshes = GetPrivateProfileIntA(Section, "SectorMaxMeshes", SectorMaxMeshes, fileName.c_str());
+	if (SectorMaxMeshes < 1)
+		SectorMaxMeshes = 1;
+
+	WireEdges = GetPrivateProfileIntA(Section, "WireEdges", WireEdges, fileName.c_str());
+
+	sprintf(defaultValue, "%f", WireFeatureAngle);
+	GetPrivateProfileStringA(Section, "WireFeatureAngle", defaultValue, value, sizeof(value), fileName.c_str());
+	WireFeatureAngle = (float)atof(value);
+
+	if (WireFeatureAngle < 0.0f || WireFeatureAngle > 180.0f)
+	{
+		Log::LogT("warning: WireFeatureAngle must be between 0 and 180, using 0");
+		WireFeatureAngle = 0.0f;
+	}
+
+	SdfBake = GetPrivateProfileIntA(Section, "SdfBake", SdfBake, fileName.c_str());
+	SdfResolution = GetPrivateProfileIntA(Section, "SdfResolution", SdfResolution, fileName.c_str());
+
+	if (SdfResolution < 8)
+	{
+		Log::LogT("warning: SdfResolution must be at least 8, using 8");
+		SdfResolution = 8;
+	}
+
+	sprintf(defaultValue, "%f", SdfRange);
+	GetPrivateProfileStringA(Section, "SdfRange", defaultValue, value, sizeof(value), fileName.c_str());
+	SdfRange = (float)atof(value);
+
+	if (SdfRange <= 0.0f)
+	{
+		Log::LogT("warning: SdfRange must be positive, using 8");
+		SdfRange = 8.0f;
+	}
+
+	AoBake = GetPrivateProfileIntA(Section, "AoBake", AoBake, fileName.c_str());
+	AoSamples = GetPrivateProfileIntA(Section, "AoSamples", AoSamples, fileName.c_str());
+
+	if (AoSamples < 1)
+	{
+		Log::LogT("warning: AoSamples must be at least 1, using 64");
+		AoSamples = 64;
+	}
+
+	sprintf(defaultValue, "%f", AoDistance);
+	GetPrivateProfileStringA(Section, "AoDistance", defaultValue, value, sizeof(value), fileName.c_str());
+	AoDistance = (float)atof(value);
+
+	if (AoDistance < 0.0f)
+	{
+		Log::LogT("warning: AoDistance can't be negative, using 0");
+		AoDistance = 0.0f;
+	}
+
+	GetPrivateProfileStringA(Section, "BvhMode", BvhMode.c_str(), value, sizeof(value), fileName.c_str());
+	BvhMode = value;
+
+	if (BvhMode != "none" && BvhMode != "mesh" && BvhMode != "level")
+	{
+		Log::LogT("warning: unknown BvhMode '%s', using none", BvhMode.c_str());
+		BvhMode = "none";
+	}
+
+	OccluderResolution = GetPrivateProfileIntA(Section, "OccluderResolution", OccluderResolution, fileName.c_str());
+	OccluderMaxBoxes = GetPrivateProfileIntA(Section, "OccluderMaxBoxes", OccluderMaxBoxes, fileName.c_str());
+
+	if (OccluderResolution < 4)
+	{
+		Log::LogT("warning: OccluderResolution must be at least 4, using 4");
+		OccluderResolution = 4;
+	}
+
+	if (OccluderMaxBoxes < 1)
+	{
+		Log::LogT("warning: OccluderMaxBoxes must be at least 1, using 16");
+		OccluderMaxBoxes = 16;
+	}
+
+	sprintf(defaultValue, "%f", SampleDensity);
+	GetPrivateProfileStringA(Section, "SampleDensity", defaultValue, value, sizeof(value), fileName.c_str());
+	SampleDensity = (float)atof(value);
+
+	if (SampleDensity < 0.0f)
+	{
+		Log::LogT("warning: SampleDensity can't be negative, using 0");
+		SampleDensity = 0.0f;
+	}
+
+	SampleSeed = GetPrivateProfileIntA(Section, "SampleSeed", SampleSeed, fileName.c_str());
+	SampleMaxCount = GetPrivateProfileIntA(Section, "SampleMaxCount", SampleMaxCount, fileName.c_str());
+
+	if (SampleMaxCount < 1)
+	{
+		Log::LogT("warning: SampleMaxCount must be at least 1, using 65536");
+		SampleMaxCount = 65536;
+	}
+
+	NormalMapBake = GetPrivateProfileIntA(Section, "NormalMapBake", NormalMapBake, fileName.c_str());
+	NormalMapSize = GetPrivateProfileIntA(Section, "NormalMapSize", NormalMapSize, fileName.c_str());
+
+	if (NormalMapSize < 16 || NormalMapSize > 8192)
+	{
+		Log::LogT("warning: NormalMapSize must be between 16 and 8192, using 1024");
+		NormalMapSize = 1024;
+	}
+
+	sprintf(defaultValue, "%f", NormalMapDistance);
+	GetPrivateProfileStringA(Section, "NormalMapDistance", defaultValue, value, sizeof(value), fileName.c_str());
+	NormalMapDistance = (float)atof(value);
+
+	if (NormalMapDistance < 0.0f)
+	{
+		Log::LogT("warning: NormalMapDistance can't be negative, using 0");
+		NormalMapDistance = 0.0f;
+	}
+
+	ProgressiveParts = GetPrivateProfileIntA(Section, "ProgressiveParts", ProgressiveParts, fileName.c_str());
+	ProgressiveMinTriangles = GetPrivateProfileIntA(Section, "ProgressiveMinTriangles", ProgressiveMinTriangles, fileName.c_str());
+
+	if (ProgressiveMinTriangles < 1)
+	{
+		Log::LogT("warning: ProgressiveMinTriangles must be at least 1, using 1024");
+		ProgressiveMinTriangles = 1024;
+	}
+
+	sprintf(defaultValue, "%f", ProgressiveBaseRatio);
+	GetPrivateProfileStringA(Section, "ProgressiveBaseRatio", defaultValue, value, sizeof(value), fileName.c_str());
+	ProgressiveBaseRatio = (float)atof(value);
+
+	if (ProgressiveBaseRatio <= 0.0f || ProgressiveBaseRatio >= 1.0f)
+	{
+		Log::LogT("warning: ProgressiveBaseRatio must be between 0 and 1, using 0.05");
+		ProgressiveBaseRatio = 0.05f;
+	}
+
+	sprintf(defaultValue, "%f", PropertyKeyTolerance);
+	GetPrivateProfileStringA(Section, "PropertyKeyTolerance", defaultValue, value, sizeof(value), fileName.c_str());
+	PropertyKeyTolerance = (float)atof(value);
+
+	if (PropertyKeyTolerance < 0.0f)
+	{
+		Log::LogT("warning: PropertyKeyTolerance can't be negative, using 0");
+		PropertyKeyTolerance = 0.0f;
+	}
+
+	sprintf(defaultValue, "%f", PropertySampleRate);
+	GetPrivateProfileStringA(Section, "PropertySampleRate", defaultValue, value, sizeof(value), fileName.c_str());
+	PropertySampleRate = (float)atof(value);
+
+	if (PropertySampleRate < 0.0f)
+	{
+		Log::LogT("warning: PropertySampleRate can't be negative, using 0");
+		PropertySampleRate = 0.0f;
+	}
+
+	Log::LogT("settings: profile '%s', max index bits %d", Profile.c_str(), MaxIndexBits);
+	Log::LogT("settings: out of core from %d faces, window %d faces, %d MB, temp dir '%s'",
+		OutOfCoreFaceThreshold, OutOfCoreWindowFaces, OutOfCoreMemoryMB, TempDir.c_str());
+	Log::LogT("settings: write patch %d", WritePatch);
+	Log::LogT("settings: sector mode '%s', size %f, max meshes %d", SectorMode.c_str(), SectorSize, SectorMaxMeshes);
+	Log::LogT("settings: wire edges %d, feature angle %f", WireEdges, WireFeatureAngle);
+	Log::LogT("settings: sdf bake %d, resolution %d, range %f", SdfBake, SdfResolution, SdfRange);
+	Log::LogT("settings: ao bake %d, samples %d, distance %f", AoBake, AoSamples, AoDistance);
+	Log::LogT("settings: bvh mode '%s'", BvhMode.c_str());
+	Log::LogT("settings: occluder resolution %d, max boxes %d", OccluderResolution, OccluderMaxBoxes);
+	Log::LogT("settings: sample density %f, seed %d, max count %d", SampleDensity, SampleSeed, SampleMaxCount);
+	Log::LogT("settings: normal map bake %d, size %d, distance %f", NormalMapBake, NormalMapSize, NormalMapDistance);
+	Log::LogT("settings: progressive parts %d, min triangles %d, base ratio %f", ProgressiveParts, ProgressiveMinTriangles, ProgressiveBaseRatio);
+	Log::LogT("settings: property key tolerance %f, sample rate %f", PropertyKeyTolerance, PropertySampleRate);
+}
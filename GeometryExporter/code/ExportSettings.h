@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+
+// Exporter options read from GeometryExporter.ini in the 3ds Max plugin
+// configuration folder. Every value has a default, so the file is optional.
+class ExportSettings
+{
+public:
+	// name of the target platform profile, "desktop" or "mobile"
+	std::string Profile;
+
+	// largest index width the target platform can draw with, 16 or 32 bits.
+	// Parts that need more than 16 bits get split when this is 16, out of
+	// core parts can't be split and fail the mesh.
+	int MaxIndexBits;
+
+	// meshes with at least that many faces are converted out of core,
+	// through temporary files, 0 turns it off
+	int OutOfCoreFaceThreshold;
+
+	// faces extracted from 3ds Max at once by the out of core conversion
+	int OutOfCoreWindowFaces;
+
+	// peak memory used by the out of core conversion on top of the window, in megabytes, 1 to 4095
+	int OutOfCoreMemoryMB;
+
+	// folder for temporary files, system temp folder when empty
+	std::string TempDir;
+
+	// when not 0, a manifest is saved next to the .geo and a .patch against
+	// the previous export is created if its manifest is there
+	int WritePatch;
+
+	// "none" keeps every mesh in one file. "grid" and "adaptive" move static
+	// meshes to per sector files and write a sector index next to the .geo
+	std::string SectorMode;
+
+	// edge of a grid sector in world units
+	float SectorSize;
+
+	// adaptive sectors are split until they hold at most that many meshes
+	int SectorMaxMeshes;
+
+	// when not 0, parts with use_wire materials get a line list with their
+	// unique edges, for the wireframe pass
+	int WireEdges;
+
+	// in degrees, wire edges between faces meeting at a smaller angle are
+	// dropped, 0 keeps every unique edge
+	float WireFeatureAngle;
+
+	// when not 0, static meshes get a signed distance field baked into an "SDF " chunk
+	int SdfBake;
+
+	// voxels along the longest side of a mesh's bounds
+	int SdfResolution;
+
+	// distances are clamped at that many voxels from the surface
+	float SdfRange;
+
+	// when not 0, ambient occlusion of static meshes is baked per vertex into
+	// "AO  " chunks, after all files of the export are saved
+	int AoBake;
+
+	// rays per vertex
+	int AoSamples;
+
+	// only hits closer than that occlude, 0 picks a tenth of the scene's size
+	float AoDistance;
+
+	// "none" saves no bounding volume hierarchy, "mesh" adds a "BVH " chunk
+	// to every static mesh, "level" saves one over all static meshes to a
+	// .bvh next to the .geo
+	std::string BvhMode;
+
+	// meshes with the occluder property get an inner occluder made of boxes
+	// of that many voxels along their longest side
+	int OccluderResolution;
+
+	// largest boxes kept in an occluder
+	int OccluderMaxBoxes;
+
+	// Poisson disk samples per square unit written to an "SMPL" chunk, for
+	// meshes without their own sample_density property. 0 samples only those
+	float SampleDensity;
+
+	// same seed, same samples
+	int SampleSeed;
+
+	// density of a mesh is lowered so it gets at most about that many samples
+	int SampleMaxCount;
+
+	// when not 0, every "<name>_high" mesh gets baked into a tangent space
+	// normal map of "<name>_low", saved as <name>_normal.tga next to the .geo.
+	// Baked high meshes are removed from the .geo afterwards
+	int NormalMapBake;
+
+	// width and height of the normal maps
+	int NormalMapSize;
+
+	// how far from the low mesh the high one is searched, 0 picks 5% of the low mesh's size
+	float NormalMapDistance;
+
+	// when not 0, parts are saved as a coarse base mesh followed by vertex
+	// splits ordered by error, so they can be drawn while still loading
+	int ProgressiveParts;
+
+	// parts with fewer triangles stay indexed
+	int ProgressiveMinTriangles;
+
+	// part of the triangles kept in the base mesh
+	float ProgressiveBaseRatio;
+
+	// keys of animated properties are dropped when the keys left reproduce
+	// the track within this difference, 0 keeps every key. Tcb tracks are
+	// compared with their controller's curve
+	float PropertyKeyTolerance;
+
+	// when not 0, linear and tcb float and vector properties are saved as
+	// samples at least this many per second, looked up without a search.
+	// Tcb tracks are sampled from their controller, with the tension,
+	// continuity, bias and ease of the keys
+	float PropertySampleRate;
+
+	ExportSettings();
+
+	void Load(const std::string &fileName);
+
+private:
+	static const char *Section;
+};
@@ -0,0 +1,205 @@
+#include "GeoAoBaker.h"
+#include "scene3d/AoBaker.h"
+
+#include <IO/BinaryWriter.h>
+#include <Utils/Log.h>
+
+#include <algorithm>
+#include <sstream>
+#include <math.h>
+
+GeoAoBaker::GeoAoBaker() :
+	m_meshesCount(0),
+	m_samplesCount(0),
+	m_distance(0.0f),
+	m_bias(0.0f)
+{
+}
+
+void GeoAoBaker::AddOccluders(const GeoFile *file, const std::set<int> *meshIds)
+{
+	for (unsigned i = 0; i < file->meshes.size(); i++)
+	{
+		const GeoFile::Mesh *mesh = file->meshes[i];
+		if (!IsSelected(mesh, meshIds))
+			continue;
+
+		m_meshesCount++;
+
+		for (unsigned j = 0; j < mesh->parts.size(); j++)
+		{
+			const GeoFile::Part *part = mesh->parts[j];
+			int stride = part->GetFloatsPerVertex();
+
+			for (unsigned k = 0; k < part->indices.size(); k++)
+			{
+				const float *position = &part->vertices[part->indices[k] * stride];
+				m_triangles.push_back(sm::Vec3(position[0], position[1], position[2]));
+			}
+		}
+	}
+}
+
+bool GeoAoBaker::BuildOccluders(int samplesCount, float distance)
+{
+	if (m_triangles.size() == 0)
+	{
+		Log::LogT("no triangles to bake ambient occlusion of");
+		return false;
+	}
+
+	sm::Vec3 min = m_triangles[0];
+	sm::Vec3 max = m_triangles[0];
+
+	for (unsigned i = 1; i < m_triangles.size(); i++)
+	{
+		const sm::Vec3 &p = m_triangles[i];
+
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max.Set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	sm::Vec3 size = max - min;
+	float diagonal = sqrtf(sm::Vec3::Dot(size, size));
+
+	if (distance <= 0.0f)
+		distance = diagonal * 0.1f;
+
+	m_samplesCount = samplesCount;
+	m_distance = distance;
+
+	// keeps rays from hitting the triangles they start on
+	m_bias = std::max(diagonal * 0.0001f, 0.00001f);
+
+	Log::LogT("ambient occlusion: %d meshes, %d triangles, %d samples, distance %f",
+		m_meshesCount, (int)m_triangles.size() / 3, samplesCount, distance);
+
+	// the bvh keeps its own copy of the triangles
+	m_bvh.Build(m_triangles);
+	std::vector<sm::Vec3>().swap(m_triangles);
+
+	return true;
+}
+
+int GeoAoBaker::BakeFile(GeoFile *file, const std::set<int> *meshIds) const
+{
+	int bakedCount = 0;
+
+	for (unsigned i = 0; i < file->meshes.size(); i++)
+	{
+		GeoFile::Mesh *mesh = file->meshes[i];
+		if (!IsSelected(mesh, meshIds))
+			continue;
+
+		std::stringstream data;
+		BinaryWriter bw(&data);
+
+		bw.Write((int)mesh->parts.size());
+
+		for (unsigned j = 0; j < mesh->parts.size(); j++)
+		{
+			const GeoFile::Part *part = mesh->parts[j];
+			int stride = part->GetFloatsPerVertex();
+
+			std::vector<sm::Vec3> positions(part->verticesCount);
+			for (int k = 0; k < part->verticesCount; k++)
+				positions[k].Set(part->vertices[k * stride + 0], part->vertices[k * stride + 1], part->vertices[k * stride + 2]);
+
+			std::vector<sm::Vec3> normals;
+			GetNormals(part, normals);
+
+			std::vector<uint8_t> visibility;
+			AoBaker::Bake(m_bvh, positions, normals, m_samplesCount, m_distance, m_bias, visibility);
+
+			bw.Write(part->verticesCount);
+			if (visibility.size() > 0)
+				bw.Write((const char*)&visibility[0], (uint32_t)visibility.size());
+		}
+
+		Scene3DMeshChunk *chunk = new Scene3DMeshChunk("AO  ");
+		chunk->data = data.str();
+		mesh->SetChunk(chunk);
+
+		bakedCount++;
+	}
+
+	return bakedCount;
+}
+
+bool GeoAoBaker::Bake(const std::vector<GeoFile*> &files, const std::set<int> *meshIds, int samplesCount, float distance)
+{
+	GeoAoBaker baker;
+
+	for (unsigned i = 0; i < files.size(); i++)
+		baker.AddOccluders(files[i], meshIds);
+
+	if (!baker.BuildOccluders(samplesCount, distance))
+		return true;
+
+	for (unsigned i = 0; i < files.size(); i++)
+		baker.BakeFile(files[i], meshIds);
+
+	return true;
+}
+
+bool GeoAoBaker::IsSelected(const GeoFile::Mesh *mesh, const std::set<int> *meshIds)
+{
+	return meshIds == NULL || meshIds->find(mesh->id) != meshIds->end();
+}
+
+void GeoAoBaker::GetNormals(const GeoFile::Part *part, std::vector<sm::Vec3> &normals)
+{
+	int stride = part->GetFloatsPerVertex();
+	int normalOffset = part->GetNormalOffset();
+
+	normals.resize(part->verticesCount);
+
+	if (normalOffset != -1)
+	{
+		for (int i = 0; i < part->verticesCount; i++)
+		{
+			const float *normal = &part->vertices[i * stride + normalOffset];
+
+			normals[i].Set(normal[0], normal[1], normal[2]);
+			Normalize(normals[i]);
+		}
+
+		return;
+	}
+
+	// the cross product is twice the face's area long, so larger faces weigh more
+	for (unsigned i = 0; i + 2 < part->indices.size(); i += 3)
+	{
+		const float *a = &part->vertices[part->indices[i + 0] * stride];
+		const float *b = &part->vertices[part->indices[i + 1] * stride];
+		const float *c = &part->vertices[part->indices[i + 2] * stride];
+
+		sm::Vec3 ab(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+		sm::Vec3 ac(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+
+		sm::Vec3 faceNormal(
+			ab.y * ac.z - ab.z * ac.y,
+			ab.z * ac.x - ab.x * ac.z,
+			ab.x * ac.y - ab.y * ac.x);
+
+		for (int j = 0; j < 3; j++)
+			normals[part->indices[i + j]] = normals[part->indices[i + j]] + faceNormal;
+	}
+
+	for (int i = 0; i < part->verticesCount; i++)
+		Normalize(normals[i]);
+}
+
+void GeoAoBaker::Normalize(sm::Vec3 &v)
+{
+	float length = sqrtf(sm::Vec3::Dot(v, v));
+
+	// a vertex of degenerate faces only, any direction does
+	if (length <= 0.0f)
+	{
+		v.Set(0.0f, 1.0f, 0.0f);
+		return;
+	}
+
+	v = v * (1.0f / length);
+}
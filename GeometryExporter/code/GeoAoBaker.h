@@ -0,0 +1,50 @@
+#pragma once
+
+#include "GeoFile.h"
+#include "scene3d/Bvh.h"
+
+#include <Math/Vec3.h>
+
+#include <set>
+#include <vector>
+
+// Bakes per vertex ambient occlusion of exported meshes into "AO  " chunks.
+// The given files are one scene, meshes occlude each other across files.
+// Positions in .geo files are in world space, so no transforms are needed.
+// Occluders are gathered one file at a time and only their positions are
+// kept, so files of a big scene don't have to be loaded together.
+class GeoAoBaker
+{
+public:
+	GeoAoBaker();
+
+	// meshIds selects the meshes that occlude and get baked, NULL selects all
+	void AddOccluders(const GeoFile *file, const std::set<int> *meshIds);
+
+	// Builds the bvh of the added occluders, false when there are none.
+	// distance 0 picks a tenth of the occluders' bounds diagonal
+	bool BuildOccluders(int samplesCount, float distance);
+
+	// bakes the selected meshes of the file against all the occluders,
+	// returns how many there were
+	int BakeFile(GeoFile *file, const std::set<int> *meshIds) const;
+
+	// all of the above for files that are loaded together
+	static bool Bake(const std::vector<GeoFile*> &files, const std::set<int> *meshIds, int samplesCount, float distance);
+
+private:
+	std::vector<sm::Vec3> m_triangles;
+	int m_meshesCount;
+
+	Bvh m_bvh;
+	int m_samplesCount;
+	float m_distance;
+	float m_bias;
+
+	static bool IsSelected(const GeoFile::Mesh *mesh, const std::set<int> *meshIds);
+
+	// part's normals, or area weighted face normals when it has none
+	static void GetNormals(const GeoFile::Part *part, std::vector<sm::Vec3> &normals);
+
+	static void Normalize(sm::Vec3 &v);
+};
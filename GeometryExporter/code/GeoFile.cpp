@@ -0,0 +1,594 @@
+#include "GeoFile.h"
+
+#include <Graphics/VertexInformation.h>
+#include <Utils/Log.h>
+
+#include <fstream>
+#include <string.h>
+
+// has to match the version written by SGMExporter::SaveGeoFile
+const unsigned short GeoFile::Version = (1 << 8) | 8;
+
+GeoFile::Part::Part() :
+	progressive(NULL)
+{
+}
+
+GeoFile::Part::~Part()
+{
+	if (progressive != NULL)
+		delete progressive;
+}
+
+int GeoFile::Part::GetFloatsPerVertex() const
+{
+	int floats = 3;
+
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords1))
+		floats += 2;
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords2))
+		floats += 2;
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords3))
+		floats += 2;
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Normal))
+		floats += 3;
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Tangent))
+		floats += 3;
+
+	return floats;
+}
+
+int GeoFile::Part::GetCoords1Offset() const
+{
+	return VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords1) ? 3 : -1;
+}
+
+int GeoFile::Part::GetNormalOffset() const
+{
+	if (!VertexInformation::HasAttrib(vertexType, VertexAttrib::Normal))
+		return -1;
+
+	int offset = 3;
+
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords1))
+		offset += 2;
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords2))
+		offset += 2;
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords3))
+		offset += 2;
+
+	return offset;
+}
+
+int GeoFile::Part::GetTangentOffset() const
+{
+	if (!VertexInformation::HasAttrib(vertexType, VertexAttrib::Tangent))
+		return -1;
+
+	// tangent is the last attribute
+	return GetFloatsPerVertex() - 3;
+}
+
+GeoFile::Mesh::Mesh() :
+	propertiesCount(0),
+	offset(0),
+	size(0)
+{
+}
+
+GeoFile::Mesh::~Mesh()
+{
+	for (unsigned i = 0; i < parts.size(); i++)
+		delete parts[i];
+
+	for (unsigned i = 0; i < chunks.size(); i++)
+		delete chunks[i];
+}
+
+Scene3DMeshChunk* GeoFile::Mesh::FindChunk(const char *tag) const
+{
+	for (unsigned i = 0; i < chunks.size(); i++)
+		if (memcmp(chunks[i]->tag, tag, 4) == 0)
+			return chunks[i];
+
+	return NULL;
+}
+
+void GeoFile::Mesh::SetChunk(Scene3DMeshChunk *chunk)
+{
+	for (unsigned i = 0; i < chunks.size(); i++)
+	{
+		if (memcmp(chunks[i]->tag, chunk->tag, 4) == 0)
+		{
+			delete chunks[i];
+			chunks[i] = chunk;
+			return;
+		}
+	}
+
+	chunks.push_back(chunk);
+}
+
+GeoFile::GeoFile() :
+	headerSize(0)
+{
+}
+
+GeoFile::~GeoFile()
+{
+	Clear();
+}
+
+GeoFile::Mesh* GeoFile::FindMesh(const std::string &name) const
+{
+	for (unsigned i = 0; i < meshes.size(); i++)
+		if (meshes[i]->name == name)
+			return meshes[i];
+
+	return NULL;
+}
+
+void GeoFile::Clear()
+{
+	for (unsigned i = 0; i < meshes.size(); i++)
+		delete meshes[i];
+
+	meshes.clear();
+}
+
+// Reads the loaded file front to back and fails instead of reading past its
+// end, a broken file can't make Load read outside of the data.
+class GeoFile::Reader
+{
+public:
+	Reader(const uint8_t *data, uint64_t size) :
+		m_data(data),
+		m_size(size),
+		m_position(0)
+	{
+	}
+
+	uint64_t GetRemaining() const
+	{
+		return m_size - m_position;
+	}
+
+	template <typename T>
+	bool Read(T &value)
+	{
+		if (GetRemaining() < sizeof(T))
+			return false;
+
+		memcpy(&value, m_data + m_position, sizeof(T));
+		m_position += sizeof(T);
+
+		return true;
+	}
+
+	// int length and the characters, the way BinaryWriter writes strings
+	bool ReadString(std::string &value)
+	{
+		int length;
+		if (!Read(length) || length < 0)
+			return false;
+
+		return ReadBytes((uint64_t)length, value);
+	}
+
+	bool ReadBytes(uint64_t size, std::string &value)
+	{
+		if (GetRemaining() < size)
+			return false;
+
+		value.assign((const char*)m_data + m_position, (size_t)size);
+		m_position += size;
+
+		return true;
+	}
+
+private:
+	const uint8_t *m_data;
+	uint64_t m_size;
+	uint64_t m_position;
+};
+
+bool GeoFile::Load(const std::string &fileName)
+{
+	Clear();
+
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::LogT("error: couldn't open '%s'", fileName.c_str());
+		return false;
+	}
+
+	file.seekg(0, std::ios::end);
+	uint64_t fileSize = (uint64_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	std::vector<uint8_t> data((size_t)fileSize + 1);
+	file.read((char*)&data[0], (std::streamsize)fileSize);
+
+	if (file.fail() || fileSize < 12 || memcmp(&data[0], "FTSMDL", 6) != 0)
+	{
+		Log::LogT("error: '%s' is not a .geo file", fileName.c_str());
+		return false;
+	}
+
+	Reader reader(&data[6], fileSize - 6);
+
+	unsigned short version;
+	reader.Read(version);
+	if (version != Version)
+	{
+		Log::LogT("error: '%s' has version %d.%d, only %d.%d is supported",
+			fileName.c_str(), version >> 8, version & 0xff, Version >> 8, Version & 0xff);
+		return false;
+	}
+
+	int meshesCount;
+	reader.Read(meshesCount);
+	headerSize = 12;
+
+	// every count is checked against the bytes left after it, each mesh takes more than a byte
+	if (meshesCount < 0 || (uint64_t)meshesCount > reader.GetRemaining())
+	{
+		Log::LogT("error: '%s' is broken", fileName.c_str());
+		return false;
+	}
+
+	for (int i = 0; i < meshesCount; i++)
+	{
+		Mesh *mesh = new Mesh();
+		meshes.push_back(mesh);
+
+		mesh->offset = 0;
+		mesh->size = 0;
+
+		if (!LoadMesh(reader, mesh))
+		{
+			if (mesh->name.empty())
+				Log::LogT("error: mesh %d in '%s' is broken", i, fileName.c_str());
+			else
+				Log::LogT("error: mesh '%s' in '%s' is broken", mesh->name.c_str(), fileName.c_str());
+
+			Clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool GeoFile::LoadMesh(Reader &reader, Mesh *mesh)
+{
+	if (!reader.Read(mesh->id) || !reader.ReadString(mesh->name))
+		return false;
+
+	for (int j = 0; j < 16; j++)
+		if (!reader.Read(mesh->worldInverseMatrix[j]))
+			return false;
+
+	int partsCount;
+	if (!reader.Read(partsCount) || partsCount < 0 || (uint64_t)partsCount > reader.GetRemaining())
+		return false;
+
+	for (int j = 0; j < partsCount; j++)
+	{
+		Part *part = new Part();
+		mesh->parts.push_back(part);
+
+		uint8_t encoding;
+		if (!reader.ReadString(part->materialName) || !reader.Read(part->vertexType) || !reader.Read(encoding))
+			return false;
+
+		bool loaded = false;
+		if (encoding == 0)
+			loaded = LoadIndexed(reader, part);
+		else if (encoding == 1)
+			loaded = LoadProgressive(reader, part);
+
+		if (!loaded)
+			return false;
+	}
+
+	uint32_t propertiesSize;
+	if (!reader.Read(mesh->propertiesCount) || !reader.Read(propertiesSize) ||
+		mesh->propertiesCount < 0 || !reader.ReadBytes(propertiesSize, mesh->properties))
+		return false;
+
+	int chunksCount;
+	if (!reader.Read(chunksCount) || chunksCount < 0 || (uint64_t)chunksCount > reader.GetRemaining())
+		return false;
+
+	for (int j = 0; j < chunksCount; j++)
+	{
+		char tag[4];
+		uint32_t size;
+		if (!reader.Read(tag) || !reader.Read(size))
+			return false;
+
+		Scene3DMeshChunk *chunk = new Scene3DMeshChunk(tag);
+		mesh->chunks.push_back(chunk);
+
+		if (!reader.ReadBytes(size, chunk->data))
+			return false;
+	}
+
+	return true;
+}
+
+bool GeoFile::Save(const std::string &fileName)
+{
+	std::ofstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::LogT("error: couldn't create '%s'", fileName.c_str());
+		return false;
+	}
+
+	BinaryWriter bw(&file);
+
+	bw.Write("FTSMDL", 6);
+	bw.Write(Version);
+	bw.Write((int)meshes.size());
+
+	headerSize = (uint64_t)file.tellp();
+
+	for (unsigned i = 0; i < meshes.size(); i++)
+	{
+		Mesh *mesh = meshes[i];
+
+		mesh->offset = (uint64_t)file.tellp();
+
+		bw.Write(mesh->id);
+		bw.Write(mesh->name);
+
+		for (int j = 0; j < 16; j++)
+			bw.Write(mesh->worldInverseMatrix[j]);
+
+		bw.Write((int)mesh->parts.size());
+
+		for (unsigned j = 0; j < mesh->parts.size(); j++)
+		{
+			Part *part = mesh->parts[j];
+
+			bw.Write(part->materialName);
+			bw.Write(part->vertexType);
+			if (part->progressive != NULL)
+			{
+				bw.Write((uint8_t)1); // progressive
+				SaveProgressive(bw, part);
+			}
+			else
+			{
+				bw.Write((uint8_t)0); // indexed
+				SaveIndexed(bw, part);
+			}
+		}
+
+		bw.Write(mesh->propertiesCount);
+		bw.Write((uint32_t)mesh->properties.size());
+		bw.Write(mesh->properties.c_str(), (uint32_t)mesh->properties.size());
+
+		bw.Write((int)mesh->chunks.size());
+
+		for (unsigned j = 0; j < mesh->chunks.size(); j++)
+		{
+			bw.Write(mesh->chunks[j]->tag, 4);
+			bw.Write((uint32_t)mesh->chunks[j]->data.size());
+			bw.Write(mesh->chunks[j]->data.c_str(), (uint32_t)mesh->chunks[j]->data.size());
+		}
+
+		mesh->size = (uint64_t)file.tellp() - mesh->offset;
+	}
+
+	file.close();
+
+	if (file.fail())
+	{
+		Log::LogT("error: couldn't write '%s'", fileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool GeoFile::LoadIndexed(Reader &reader, Part *part)
+{
+	if (!reader.Read(part->verticesCount) || part->verticesCount < 0)
+		return false;
+
+	uint64_t floatsCount = (uint64_t)part->verticesCount * part->GetFloatsPerVertex();
+	if (!ReadFloats(reader, floatsCount, part->vertices))
+		return false;
+
+	int indicesCount;
+	if (!reader.Read(part->indexSize) || !reader.Read(indicesCount) ||
+		(part->indexSize != 2 && part->indexSize != 4))
+		return false;
+
+	return ReadIndices(reader, part->indexSize, indicesCount, part->indices);
+}
+
+bool GeoFile::LoadProgressive(Reader &reader, Part *part)
+{
+	int indicesCount;
+	if (!reader.Read(part->verticesCount) || !reader.Read(part->indexSize) || !reader.Read(indicesCount))
+		return false;
+
+	int floatsPerVertex = part->GetFloatsPerVertex();
+	uint64_t floatsCount = (uint64_t)part->verticesCount * floatsPerVertex;
+
+	// all vertices and indices are stored further on, in the base mesh and the splits
+	if (part->verticesCount < 0 || floatsCount * 4 > reader.GetRemaining() ||
+		(part->indexSize != 2 && part->indexSize != 4) ||
+		indicesCount < 0 || (uint64_t)indicesCount * part->indexSize > reader.GetRemaining())
+		return false;
+
+	ProgressiveMesh *progressive = new ProgressiveMesh();
+	part->progressive = progressive;
+
+	part->vertices.resize((size_t)floatsCount);
+
+	int baseVerticesCount;
+	if (!reader.Read(baseVerticesCount) || baseVerticesCount < 0 || baseVerticesCount > part->verticesCount)
+		return false;
+
+	progressive->baseVerticesCount = baseVerticesCount;
+
+	for (int i = 0; i < baseVerticesCount * floatsPerVertex; i++)
+		if (!reader.Read(part->vertices[i]))
+			return false;
+
+	int baseIndicesCount;
+	if (!reader.Read(baseIndicesCount) || baseIndicesCount > indicesCount ||
+		!ReadIndices(reader, part->indexSize, baseIndicesCount, progressive->baseIndices))
+		return false;
+
+	int splitsCount;
+	if (!reader.Read(splitsCount) || splitsCount != part->verticesCount - baseVerticesCount)
+		return false;
+
+	progressive->splits.resize(splitsCount);
+	part->indices = progressive->baseIndices;
+
+	// refines to full detail the way a reader at run time would
+	for (int i = 0; i < splitsCount; i++)
+	{
+		ProgressiveMesh::VertexSplit &split = progressive->splits[i];
+		int vertex = baseVerticesCount + i;
+
+		if (!reader.Read(split.error))
+			return false;
+
+		for (int j = 0; j < floatsPerVertex; j++)
+			if (!reader.Read(part->vertices[vertex * floatsPerVertex + j]))
+				return false;
+
+		int trianglesCount;
+		if (!reader.Read(trianglesCount) || trianglesCount < 0 ||
+			(uint64_t)part->indices.size() + (uint64_t)trianglesCount * 3 > (uint64_t)indicesCount ||
+			!ReadIndices(reader, part->indexSize, trianglesCount * 3, split.triangles))
+			return false;
+
+		part->indices.insert(part->indices.end(), split.triangles.begin(), split.triangles.end());
+
+		int cornersCount;
+		if (!reader.Read(cornersCount) || cornersCount < 0 ||
+			(uint64_t)cornersCount > part->indices.size() ||
+			(uint64_t)cornersCount * 4 > reader.GetRemaining())
+			return false;
+
+		split.corners.resize(cornersCount);
+
+		for (int j = 0; j < cornersCount; j++)
+		{
+			reader.Read(split.corners[j]);
+			if (split.corners[j] >= part->indices.size())
+				return false;
+
+			part->indices[split.corners[j]] = vertex;
+		}
+	}
+
+	return part->indices.size() == (size_t)indicesCount;
+}
+
+void GeoFile::SaveIndexed(BinaryWriter &bw, const Part *part)
+{
+	bw.Write(part->verticesCount);
+
+	for (size_t i = 0; i < part->vertices.size(); i++)
+		bw.Write(part->vertices[i]);
+
+	bw.Write(part->indexSize);
+	bw.Write((int)part->indices.size());
+	WriteIndices(bw, part->indexSize, part->indices);
+}
+
+void GeoFile::SaveProgressive(BinaryWriter &bw, const Part *part)
+{
+	const ProgressiveMesh *progressive = part->progressive;
+	int floatsPerVertex = part->GetFloatsPerVertex();
+
+	bw.Write(part->verticesCount);
+	bw.Write(part->indexSize);
+	bw.Write((int)part->indices.size());
+
+	bw.Write((int)progressive->baseVerticesCount);
+	for (uint32_t i = 0; i < progressive->baseVerticesCount * floatsPerVertex; i++)
+		bw.Write(part->vertices[i]);
+
+	bw.Write((int)progressive->baseIndices.size());
+	WriteIndices(bw, part->indexSize, progressive->baseIndices);
+
+	bw.Write((int)progressive->splits.size());
+
+	for (unsigned i = 0; i < progressive->splits.size(); i++)
+	{
+		const ProgressiveMesh::VertexSplit &split = progressive->splits[i];
+		uint32_t vertex = progressive->baseVerticesCount + i;
+
+		bw.Write(split.error);
+
+		for (int j = 0; j < floatsPerVertex; j++)
+			bw.Write(part->vertices[vertex * floatsPerVertex + j]);
+
+		bw.Write((int)split.triangles.size() / 3);
+		WriteIndices(bw, part->indexSize, split.triangles);
+
+		bw.Write((int)split.corners.size());
+		for (unsigned j = 0; j < split.corners.size(); j++)
+			bw.Write(split.corners[j]);
+	}
+}
+
+bool GeoFile::ReadFloats(Reader &reader, uint64_t count, std::vector<float> &floats)
+{
+	if (count * 4 > reader.GetRemaining())
+		return false;
+
+	floats.resize((size_t)count);
+	for (size_t i = 0; i < floats.size(); i++)
+		reader.Read(floats[i]);
+
+	return true;
+}
+
+bool GeoFile::ReadIndices(Reader &reader, uint8_t indexSize, int count, std::vector<uint32_t> &indices)
+{
+	if (count < 0 || (uint64_t)count * indexSize > reader.GetRemaining())
+		return false;
+
+	indices.resize(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (indexSize == 2)
+		{
+			uint16_t index;
+			reader.Read(index);
+			indices[i] = index;
+		}
+		else
+			reader.Read(indices[i]);
+	}
+
+	return true;
+}
+
+void GeoFile::WriteIndices(BinaryWriter &bw, uint8_t indexSize, const std::vector<uint32_t> &indices)
+{
+	if (indexSize == 2)
+	{
+		for (size_t i = 0; i < indices.size(); i++)
+			bw.Write((uint16_t)indices[i]);
+	}
+	else
+	{
+		for (size_t i = 0; i < indices.size(); i++)
+			bw.Write((uint32_t)indices[i]);
+	}
+}
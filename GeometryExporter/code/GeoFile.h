@@ -0,0 +1,106 @@
+#pragma once
+
+#include "scene3d/Scene3DMeshChunk.h"
+#include "scene3d/ProgressiveMesh.h"
+
+#include <IO/BinaryWriter.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// .geo file loaded as it was saved by GeoSaver, for the steps that run on
+// exported files, outside of 3ds Max. Vertices stay in their packed layout.
+// Progressive parts are refined to full detail on load and keep their base
+// mesh and splits to be saved again. Only the current version is read.
+class GeoFile
+{
+public:
+	class Part
+	{
+	public:
+		std::string materialName;
+		uint8_t vertexType;
+		int verticesCount;
+
+		// vertex attributes in the saved order, GetFloatsPerVertex() per vertex
+		std::vector<float> vertices;
+
+		uint8_t indexSize;
+
+		// full detail triangle list, also of progressive parts
+		std::vector<uint32_t> indices;
+
+		// base mesh and splits of a progressive part, NULL when it's indexed
+		ProgressiveMesh *progressive;
+
+		Part();
+		~Part();
+
+		int GetFloatsPerVertex() const;
+
+		// offsets of attributes in a vertex, in floats, -1 when there's none
+		int GetCoords1Offset() const;
+		int GetNormalOffset() const;
+		int GetTangentOffset() const;
+	};
+
+	class Mesh
+	{
+	public:
+		int id;
+		std::string name;
+		float worldInverseMatrix[16];
+
+		std::vector<Part*> parts;
+
+		// property block as it was saved, it isn't needed here
+		int propertiesCount;
+		std::string properties;
+
+		std::vector<Scene3DMeshChunk*> chunks;
+
+		// place of the mesh in the file, set by Save
+		uint64_t offset;
+		uint64_t size;
+
+		Mesh();
+		~Mesh();
+
+		Scene3DMeshChunk* FindChunk(const char *tag) const;
+
+		// takes the chunk and replaces the one with the same tag
+		void SetChunk(Scene3DMeshChunk *chunk);
+	};
+
+	static const unsigned short Version;
+
+	uint64_t headerSize;
+	std::vector<Mesh*> meshes;
+
+	GeoFile();
+	~GeoFile();
+
+	// NULL when there's no mesh of the name
+	Mesh* FindMesh(const std::string &name) const;
+
+	bool Load(const std::string &fileName);
+	bool Save(const std::string &fileName);
+
+private:
+	class Reader;
+
+	void Clear();
+
+	// read the mesh or the part's data following its encoding, false when it's broken
+	static bool LoadMesh(Reader &reader, Mesh *mesh);
+	static bool LoadIndexed(Reader &reader, Part *part);
+	static bool LoadProgressive(Reader &reader, Part *part);
+
+	static void SaveIndexed(BinaryWriter &bw, const Part *part);
+	static void SaveProgressive(BinaryWriter &bw, const Part *part);
+
+	static bool ReadFloats(Reader &reader, uint64_t count, std::vector<float> &floats);
+	static bool ReadIndices(Reader &reader, uint8_t indexSize, int count, std::vector<uint32_t> &indices);
+	static void WriteIndices(BinaryWriter &bw, uint8_t indexSize, const std::vector<uint32_t> &indices);
+};
@@ -0,0 +1,456 @@
+#include "GeoPatch.h"
+#include <Utils/Log.h>
+
+#include <map>
+#include <algorithm>
+
+namespace
+{
+	const char *ManifestMagic = "GEOMAN";
+	const char *PatchMagic = "GEOPCH";
+	const unsigned short FormatVersion = (1 << 8) | 0;
+
+	const unsigned CopyBufferSize = 1024 * 1024;
+
+	void WriteUInt64(BinaryWriter &bw, uint64_t value)
+	{
+		bw.Write((const char*)&value, (uint32_t)sizeof(uint64_t));
+	}
+
+	template <typename T>
+	bool Read(std::istream &is, T &value)
+	{
+		is.read((char*)&value, sizeof(T));
+		return !is.fail();
+	}
+
+	bool ReadMagic(std::istream &is, const char *magic)
+	{
+		char data[6];
+		unsigned short version;
+
+		is.read(data, 6);
+		if (is.fail() || !Read(is, version))
+			return false;
+
+		return std::equal(data, data + 6, magic) && version == FormatVersion;
+	}
+
+	// Reads size bytes and folds them into both hashes. When os is set, the bytes are also written to it.
+	bool Transfer(std::istream &is, std::ostream *os, uint64_t size, uint64_t &hash, uint64_t &fileHash)
+	{
+		std::vector<char> buffer((size_t)std::min<uint64_t>(size, CopyBufferSize));
+
+		while (size > 0)
+		{
+			unsigned count = (unsigned)std::min<uint64_t>(size, CopyBufferSize);
+
+			is.read(&buffer[0], count);
+			if (is.fail())
+				return false;
+
+			hash = GeoPatch::Hash(&buffer[0], count, hash);
+			fileHash = GeoPatch::Hash(&buffer[0], count, fileHash);
+
+			if (os != NULL)
+				os->write(&buffer[0], count);
+
+			size -= count;
+		}
+
+		return true;
+	}
+}
+
+uint64_t GeoPatch::Hash(const char *data, uint64_t size, uint64_t hash)
+{
+	for (uint64_t i = 0; i < size; i++)
+	{
+		hash ^= (uint8_t)data[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+GeoManifest::GeoManifest() :
+	headerSize(0),
+	fileSize(0),
+	fileHash(GeoPatch::HashOffset)
+{
+}
+
+bool GeoManifest::Build(const std::string &geoFileName)
+{
+	std::ifstream file(geoFileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::LogT("error: couldn't open '%s' to build its manifest", geoFileName.c_str());
+		return false;
+	}
+
+	file.seekg(0, std::ios::end);
+	fileSize = (uint64_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	fileHash = GeoPatch::HashOffset;
+
+	uint64_t headerHash = GeoPatch::HashOffset;
+	uint64_t offset = headerSize;
+
+	if (!Transfer(file, NULL, headerSize, headerHash, fileHash))
+	{
+		Log::LogT("error: couldn't read the header of '%s'", geoFileName.c_str());
+		return false;
+	}
+
+	for (unsigned i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].offset != offset)
+		{
+			Log::LogT("error: chunk of node %d doesn't follow the previous one", chunks[i].nodeId);
+			return false;
+		}
+
+		chunks[i].hash = GeoPatch::HashOffset;
+
+		if (!Transfer(file, NULL, chunks[i].size, chunks[i].hash, fileHash))
+		{
+			Log::LogT("error: couldn't read the chunk of node %d from '%s'", chunks[i].nodeId, geoFileName.c_str());
+			return false;
+		}
+
+		offset += chunks[i].size;
+	}
+
+	if (offset != fileSize)
+	{
+		Log::LogT("error: chunks of '%s' don't cover the whole file", geoFileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool GeoManifest::Save(const std::string &fileName) const
+{
+	std::ofstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::LogT("error: couldn't create manifest '%s'", fileName.c_str());
+		return false;
+	}
+
+	BinaryWriter bw(&file);
+
+	bw.Write(ManifestMagic, 6);
+	bw.Write(FormatVersion);
+
+	WriteUInt64(bw, headerSize);
+	WriteUInt64(bw, fileSize);
+	WriteUInt64(bw, fileHash);
+
+	bw.Write((int)chunks.size());
+
+	for (unsigned i = 0; i < chunks.size(); i++)
+	{
+		bw.Write(chunks[i].nodeId);
+		WriteUInt64(bw, chunks[i].offset);
+		WriteUInt64(bw, chunks[i].size);
+		WriteUInt64(bw, chunks[i].hash);
+	}
+
+	file.close();
+
+	return true;
+}
+
+bool GeoManifest::Load(const std::string &fileName)
+{
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	if (!ReadMagic(file, ManifestMagic))
+	{
+		Log::LogT("warning: '%s' is not a manifest of a supported version", fileName.c_str());
+		return false;
+	}
+
+	int chunksCount;
+
+	if (!Read(file, headerSize) || !Read(file, fileSize) || !Read(file, fileHash) || !Read(file, chunksCount))
+		return false;
+
+	chunks.resize(chunksCount);
+
+	for (int i = 0; i < chunksCount; i++)
+	{
+		if (!Read(file, chunks[i].nodeId) ||
+			!Read(file, chunks[i].offset) ||
+			!Read(file, chunks[i].size) ||
+			!Read(file, chunks[i].hash))
+		{
+			Log::LogT("error: manifest '%s' is truncated", fileName.c_str());
+			chunks.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool GeoPatch::Create(
+	const GeoManifest &baseManifest,
+	const GeoManifest &manifest,
+	const std::string &geoFileName,
+	const std::string &patchFileName)
+{
+	std::ifstream geoFile(geoFileName.c_str(), std::ios::binary);
+	if (!geoFile.is_open())
+	{
+		Log::LogT("error: couldn't open '%s' to create a patch", geoFileName.c_str());
+		return false;
+	}
+
+	std::ofstream patchFile(patchFileName.c_str(), std::ios::binary);
+	if (!patchFile.is_open())
+	{
+		Log::LogT("error: couldn't create patch '%s'", patchFileName.c_str());
+		return false;
+	}
+
+	std::map<int, const GeoManifest::Chunk*> baseChunks;
+	for (unsigned i = 0; i < baseManifest.chunks.size(); i++)
+		baseChunks[baseManifest.chunks[i].nodeId] = &baseManifest.chunks[i];
+
+	std::map<int, const GeoManifest::Chunk*> chunks;
+	for (unsigned i = 0; i < manifest.chunks.size(); i++)
+		chunks[manifest.chunks[i].nodeId] = &manifest.chunks[i];
+
+	std::vector<int> removedNodes;
+	for (unsigned i = 0; i < baseManifest.chunks.size(); i++)
+		if (chunks.find(baseManifest.chunks[i].nodeId) == chunks.end())
+			removedNodes.push_back(baseManifest.chunks[i].nodeId);
+
+	BinaryWriter bw(&patchFile);
+
+	bw.Write(PatchMagic, 6);
+	bw.Write(FormatVersion);
+
+	WriteUInt64(bw, baseManifest.fileSize);
+	WriteUInt64(bw, baseManifest.fileHash);
+	WriteUInt64(bw, manifest.fileSize);
+	WriteUInt64(bw, manifest.fileHash);
+
+	// header is small and holds the meshes count, it is always stored
+	uint64_t hash = HashOffset;
+	uint64_t fileHash = HashOffset;
+
+	WriteUInt64(bw, manifest.headerSize);
+	if (!Transfer(geoFile, &patchFile, manifest.headerSize, hash, fileHash))
+	{
+		Log::LogT("error: couldn't read the header of '%s'", geoFileName.c_str());
+		return false;
+	}
+
+	bw.Write((int)(manifest.chunks.size() + removedNodes.size()));
+
+	int kept = 0;
+	int added = 0;
+	int replaced = 0;
+
+	for (unsigned i = 0; i < manifest.chunks.size(); i++)
+	{
+		const GeoManifest::Chunk &chunk = manifest.chunks[i];
+
+		std::map<int, const GeoManifest::Chunk*>::const_iterator baseChunk = baseChunks.find(chunk.nodeId);
+
+		if (baseChunk != baseChunks.end() && baseChunk->second->hash == chunk.hash && baseChunk->second->size == chunk.size)
+		{
+			bw.Write((uint8_t)Operation_Keep);
+			bw.Write(chunk.nodeId);
+			WriteUInt64(bw, chunk.hash);
+			WriteUInt64(bw, baseChunk->second->offset);
+			WriteUInt64(bw, chunk.size);
+
+			kept++;
+			continue;
+		}
+
+		bool isReplaced = baseChunk != baseChunks.end();
+
+		bw.Write((uint8_t)(isReplaced ? Operation_Replace : Operation_Add));
+		bw.Write(chunk.nodeId);
+		WriteUInt64(bw, chunk.hash);
+		WriteUInt64(bw, chunk.size);
+
+		geoFile.seekg(chunk.offset, std::ios::beg);
+
+		hash = HashOffset;
+		if (!Transfer(geoFile, &patchFile, chunk.size, hash, fileHash))
+		{
+			Log::LogT("error: couldn't read the chunk of node %d from '%s'", chunk.nodeId, geoFileName.c_str());
+			return false;
+		}
+
+		if (isReplaced)
+			replaced++;
+		else
+			added++;
+	}
+
+	for (unsigned i = 0; i < removedNodes.size(); i++)
+	{
+		bw.Write((uint8_t)Operation_Remove);
+		bw.Write(removedNodes[i]);
+		WriteUInt64(bw, (uint64_t)0);
+	}
+
+	uint64_t patchSize = (uint64_t)patchFile.tellp();
+	patchFile.close();
+
+	Log::LogT("patch '%s': %d kept, %d added, %d replaced, %d removed, %d bytes instead of %d",
+		patchFileName.c_str(), kept, added, replaced, (int)removedNodes.size(), (int)patchSize, (int)manifest.fileSize);
+
+	return true;
+}
+
+bool GeoPatch::Apply(
+	const std::string &baseFileName,
+	const std::string &patchFileName,
+	const std::string &outputFileName)
+{
+	std::ifstream patchFile(patchFileName.c_str(), std::ios::binary);
+	if (!patchFile.is_open())
+	{
+		Log::LogT("error: couldn't open patch '%s'", patchFileName.c_str());
+		return false;
+	}
+
+	if (!ReadMagic(patchFile, PatchMagic))
+	{
+		Log::LogT("error: '%s' is not a patch of a supported version", patchFileName.c_str());
+		return false;
+	}
+
+	uint64_t baseSize;
+	uint64_t baseHash;
+	uint64_t resultSize;
+	uint64_t resultHash;
+	uint64_t headerSize;
+
+	if (!Read(patchFile, baseSize) ||
+		!Read(patchFile, baseHash) ||
+		!Read(patchFile, resultSize) ||
+		!Read(patchFile, resultHash) ||
+		!Read(patchFile, headerSize))
+	{
+		Log::LogT("error: patch '%s' is truncated", patchFileName.c_str());
+		return false;
+	}
+
+	std::ifstream baseFile(baseFileName.c_str(), std::ios::binary);
+	if (!baseFile.is_open())
+	{
+		Log::LogT("error: couldn't open base file '%s'", baseFileName.c_str());
+		return false;
+	}
+
+	baseFile.seekg(0, std::ios::end);
+	uint64_t size = (uint64_t)baseFile.tellg();
+	baseFile.seekg(0, std::ios::beg);
+
+	uint64_t hash = HashOffset;
+	uint64_t fileHash = HashOffset;
+
+	if (size != baseSize || !Transfer(baseFile, NULL, size, hash, fileHash) || fileHash != baseHash)
+	{
+		Log::LogT("error: '%s' is not the file the patch was created against", baseFileName.c_str());
+		return false;
+	}
+
+	std::ofstream outputFile(outputFileName.c_str(), std::ios::binary);
+	if (!outputFile.is_open())
+	{
+		Log::LogT("error: couldn't create '%s'", outputFileName.c_str());
+		return false;
+	}
+
+	fileHash = HashOffset;
+
+	if (!Transfer(patchFile, &outputFile, headerSize, hash, fileHash))
+	{
+		Log::LogT("error: patch '%s' is truncated", patchFileName.c_str());
+		return false;
+	}
+
+	int operationsCount;
+	if (!Read(patchFile, operationsCount))
+	{
+		Log::LogT("error: patch '%s' is truncated", patchFileName.c_str());
+		return false;
+	}
+
+	for (int i = 0; i < operationsCount; i++)
+	{
+		uint8_t operation;
+		int nodeId;
+		uint64_t chunkHash;
+
+		if (!Read(patchFile, operation) || !Read(patchFile, nodeId) || !Read(patchFile, chunkHash))
+		{
+			Log::LogT("error: patch '%s' is truncated", patchFileName.c_str());
+			return false;
+		}
+
+		if (operation == Operation_Remove)
+			continue;
+
+		bool result = false;
+		hash = HashOffset;
+
+		if (operation == Operation_Keep)
+		{
+			uint64_t offset;
+			uint64_t chunkSize;
+
+			if (Read(patchFile, offset) && Read(patchFile, chunkSize))
+			{
+				baseFile.clear();
+				baseFile.seekg(offset, std::ios::beg);
+				result = Transfer(baseFile, &outputFile, chunkSize, hash, fileHash);
+			}
+		}
+		else if (operation == Operation_Add || operation == Operation_Replace)
+		{
+			uint64_t chunkSize;
+
+			if (Read(patchFile, chunkSize))
+				result = Transfer(patchFile, &outputFile, chunkSize, hash, fileHash);
+		}
+		else
+		{
+			Log::LogT("error: unknown patch operation %d", (int)operation);
+			return false;
+		}
+
+		if (!result || hash != chunkHash)
+		{
+			Log::LogT("error: chunk of node %d is damaged", nodeId);
+			return false;
+		}
+	}
+
+	outputFile.close();
+
+	if (fileHash != resultHash)
+	{
+		Log::LogT("error: patched file '%s' doesn't match the exported one", outputFileName.c_str());
+		return false;
+	}
+
+	Log::LogT("patched '%s' into '%s' (%d bytes)", baseFileName.c_str(), outputFileName.c_str(), (int)resultSize);
+
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <IO\BinaryWriter.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+// Layout of an exported .geo file: the header followed by one chunk per mesh.
+// Saved next to the .geo, so the next export can be diffed against it without
+// keeping the previous file around.
+class GeoManifest
+{
+public:
+	class Chunk
+	{
+	public:
+		int nodeId;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t hash;
+	};
+
+	uint64_t headerSize;
+	uint64_t fileSize;
+	uint64_t fileHash;
+
+	std::vector<Chunk> chunks;
+
+	GeoManifest();
+
+	// Reads the .geo once and hashes the file and every chunk.
+	// Node ids, offsets and sizes of chunks have to be set before.
+	bool Build(const std::string &geoFileName);
+
+	bool Save(const std::string &fileName) const;
+	bool Load(const std::string &fileName);
+};
+
+// Chunk level patch between two exports of the same .geo. Chunks are keyed
+// by mesh node id and content hash: unchanged chunks are copied from the base
+// file, changed and new ones are stored in the patch.
+class GeoPatch
+{
+public:
+	enum Operation
+	{
+		Operation_Keep = 0,
+		Operation_Add,
+		Operation_Replace,
+		Operation_Remove
+	};
+
+	// FNV-1a 64
+	static const uint64_t HashOffset = 14695981039346656037ULL;
+	static uint64_t Hash(const char *data, uint64_t size, uint64_t hash);
+
+	static bool Create(
+		const GeoManifest &baseManifest,
+		const GeoManifest &manifest,
+		const std::string &geoFileName,
+		const std::string &patchFileName);
+
+	// Checks that the base file is the one the patch was made against
+	// and that the output hashes to the exported file.
+	static bool Apply(
+		const std::string &baseFileName,
+		const std::string &patchFileName,
+		const std::string &outputFileName);
+};
@@ -0,0 +1,206 @@
+#include "KeyReducer.h"
+
+#include <utility>
+#include <math.h>
+
+unsigned KeyReducer::Reduce(Property *prop, float tolerance, const PropertyCurve *curve)
+{
+	if (!prop->IsAnimatable() || prop->GetKeysCount() < 3)
+		return 0;
+
+	unsigned keysCount = prop->GetKeysCount();
+
+	std::vector<bool> keep(keysCount, false);
+	keep[0] = true;
+	keep[keysCount - 1] = true;
+
+	switch (prop->GetAnimationType())
+	{
+	case Property::AnimationType_State:
+		ReduceState(prop, keep);
+		break;
+
+	case Property::AnimationType_Linear:
+		ReduceLinear(prop, tolerance, keep);
+		break;
+
+	case Property::AnimationType_TCB:
+		ReduceTcb(prop, tolerance, curve, keep);
+		break;
+
+	default:
+		return 0;
+	}
+
+	const std::vector<float> &keyTimes = prop->GetKeyTimes();
+	const std::vector<Property::Value> &keyValues = prop->GetKeyValues();
+
+	std::vector<float> times;
+	std::vector<Property::Value> values;
+
+	for (unsigned i = 0; i < keysCount; i++)
+	{
+		if (keep[i])
+		{
+			times.push_back(keyTimes[i]);
+			values.push_back(keyValues[i]);
+		}
+	}
+
+	unsigned removed = keysCount - (unsigned)times.size();
+	if (removed > 0)
+		prop->SetKeys(times, values);
+
+	return removed;
+}
+
+void KeyReducer::ReduceLinear(const Property *prop, float tolerance, std::vector<bool> &keep)
+{
+	const std::vector<float> &times = prop->GetKeyTimes();
+	const std::vector<Property::Value> &values = prop->GetKeyValues();
+
+	// spans between two kept keys still to check, a stack instead of
+	// recursion, long auto keyed tracks could go deep
+	std::vector<std::pair<unsigned, unsigned> > spans;
+	spans.push_back(std::make_pair(0u, (unsigned)times.size() - 1));
+
+	while (spans.size() > 0)
+	{
+		unsigned first = spans.back().first;
+		unsigned last = spans.back().second;
+		spans.pop_back();
+
+		if (last - first < 2)
+			continue;
+
+		float duration = times[last] - times[first];
+
+		unsigned worstKey = first;
+		float worstError = 0.0f;
+
+		// the track is linear between keys, so it's furthest from the line
+		// at one of them
+		for (unsigned i = first + 1; i < last; i++)
+		{
+			float s = duration > 0.0f ? (times[i] - times[first]) / duration : 0.0f;
+
+			for (unsigned j = 0; j < prop->GetComponentsCount(); j++)
+			{
+				float a = prop->GetComponent(values[first], j);
+				float b = prop->GetComponent(values[last], j);
+
+				float error = fabsf(a + (b - a) * s - prop->GetComponent(values[i], j));
+				if (error > worstError)
+				{
+					worstError = error;
+					worstKey = i;
+				}
+			}
+		}
+
+		if (worstError > tolerance)
+		{
+			keep[worstKey] = true;
+			spans.push_back(std::make_pair(first, worstKey));
+			spans.push_back(std::make_pair(worstKey, last));
+		}
+	}
+}
+
+void KeyReducer::ReduceTcb(const Property *prop, float tolerance, const PropertyCurve *curve, std::vector<bool> &keep)
+{
+	const std::vector<float> &times = prop->GetKeyTimes();
+	const std::vector<Property::Value> &values = prop->GetKeyValues();
+
+	unsigned keysCount = (unsigned)times.size();
+
+	// Removing a key changes the tangents of the kept keys on both sides of
+	// it, so the curve changes from the second kept key before it to the
+	// second key after it. Those tangents in turn depend on one more key on
+	// each side, a spline of these few keys is the reduced curve in the span.
+	std::vector<unsigned> kept;
+	kept.push_back(0);
+
+	for (unsigned i = 1; i < keysCount - 1; i++)
+	{
+		unsigned windowFirst = (unsigned)(kept.size() > 3 ? kept.size() - 3 : 0);
+		unsigned windowLast = i + 3 < keysCount ? i + 3 : keysCount - 1;
+
+		std::vector<float> windowTimes;
+		std::vector<Property::Value> windowValues;
+
+		for (unsigned j = windowFirst; j < kept.size(); j++)
+		{
+			windowTimes.push_back(times[kept[j]]);
+			windowValues.push_back(values[kept[j]]);
+		}
+
+		for (unsigned j = i + 1; j <= windowLast; j++)
+		{
+			windowTimes.push_back(times[j]);
+			windowValues.push_back(values[j]);
+		}
+
+		Property reduced(prop->GetName(), prop->GetPropertyType(), Property::AnimationType_TCB);
+		reduced.SetKeys(windowTimes, windowValues);
+
+		unsigned spanFirst = kept[kept.size() > 1 ? kept.size() - 2 : 0];
+		unsigned spanLast = i + 2 < keysCount ? i + 2 : keysCount - 1;
+
+		// compared at the keys and between them, where the spline bends away.
+		// Where even all keys miss the authored curve by more than the
+		// tolerance, nothing fits and the keys there are kept
+		bool fits = true;
+
+		for (unsigned j = spanFirst; j < spanLast && fits; j++)
+		{
+			for (unsigned k = 0; k < 4 && fits; k++)
+			{
+				float time = times[j] + (times[j + 1] - times[j]) * (float)k / 4.0f;
+				Property::Value value = curve != NULL ? curve->Evaluate(time) : prop->Evaluate(time);
+
+				if (GetError(prop, value, reduced.Evaluate(time)) > tolerance)
+					fits = false;
+			}
+		}
+
+		if (fits)
+			keep[i] = false;
+		else
+		{
+			keep[i] = true;
+			kept.push_back(i);
+		}
+	}
+}
+
+void KeyReducer::ReduceState(const Property *prop, std::vector<bool> &keep)
+{
+	const std::vector<Property::Value> &values = prop->GetKeyValues();
+
+	// a state holds until the next key, a key repeating it changes nothing
+	unsigned lastKept = 0;
+
+	for (unsigned i = 1; i < values.size() - 1; i++)
+	{
+		if (GetError(prop, values[i], values[lastKept]) > 0.0f)
+		{
+			keep[i] = true;
+			lastKept = i;
+		}
+	}
+}
+
+float KeyReducer::GetError(const Property *prop, const Property::Value &a, const Property::Value &b)
+{
+	float error = 0.0f;
+
+	for (unsigned i = 0; i < prop->GetComponentsCount(); i++)
+	{
+		float difference = fabsf(prop->GetComponent(a, i) - prop->GetComponent(b, i));
+		if (difference > error)
+			error = difference;
+	}
+
+	return error;
+}
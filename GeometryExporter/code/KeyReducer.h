@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Property.h"
+#include "PropertyCurve.h"
+
+#include <vector>
+
+// Drops keys of an animated property that the keys left around them
+// reproduce within a tolerance. Auto key puts a key on every frame, most of
+// them on straight or smooth stretches that the interpolation gets anyway.
+// Linear tracks are reduced by line fitting (Douglas-Peucker), tcb tracks by
+// removing keys one by one while the refitted spline stays within the
+// tolerance, and state tracks keep only the keys where the value changes.
+// The first and the last key always stay, so the track's range is kept.
+// A tcb track is checked against its controller's curve when one is given,
+// keys are dropped only where the reduced spline stays within the tolerance
+// of the authored curve, not just of the spline of all keys.
+class KeyReducer
+{
+public:
+	// Tolerance is the largest difference of any component allowed at any
+	// time, in the property's units. Returns the number of keys removed.
+	// curve is the track as authored, NULL when its keys describe it fully.
+	static unsigned Reduce(Property *prop, float tolerance, const PropertyCurve *curve);
+
+private:
+	static void ReduceLinear(const Property *prop, float tolerance, std::vector<bool> &keep);
+
+	static void ReduceTcb(const Property *prop, float tolerance, const PropertyCurve *curve, std::vector<bool> &keep);
+
+	static void ReduceState(const Property *prop, std::vector<bool> &keep);
+
+	// largest difference of the values' components
+	static float GetError(const Property *prop, const Property::Value &a, const Property::Value &b);
+};
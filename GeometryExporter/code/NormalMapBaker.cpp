@@ -0,0 +1,475 @@
+#include "NormalMapBaker.h"
+#include "ParallelFor.h"
+#include "scene3d/Bvh.h"
+
+#include <IO/BinaryWriter.h>
+#include <Utils/Log.h>
+
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+const int NormalMapBaker::TileSize = 32;
+const int NormalMapBaker::DilationTexels = 4;
+
+bool NormalMap::SaveTga(const std::string &fileName) const
+{
+	std::ofstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::LogT("error: couldn't create '%s'", fileName.c_str());
+		return false;
+	}
+
+	BinaryWriter bw(&file);
+
+	bw.Write((uint8_t)0); // id length
+	bw.Write((uint8_t)0); // no color map
+	bw.Write((uint8_t)2); // uncompressed true color
+	for (int i = 0; i < 5; i++)
+		bw.Write((uint8_t)0); // color map specification
+	bw.Write((uint16_t)0); // x origin
+	bw.Write((uint16_t)0); // y origin
+	bw.Write((uint16_t)width);
+	bw.Write((uint16_t)height);
+	bw.Write((uint8_t)24); // bits per pixel
+	bw.Write((uint8_t)0); // bottom up rows, no alpha
+
+	// TGA keeps pixels as BGR
+	std::vector<uint8_t> row(width * 3);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const uint8_t *pixel = &pixels[(y * width + x) * 3];
+
+			row[x * 3 + 0] = pixel[2];
+			row[x * 3 + 1] = pixel[1];
+			row[x * 3 + 2] = pixel[0];
+		}
+
+		bw.Write((const char*)&row[0], (uint32_t)row.size());
+	}
+
+	file.close();
+
+	return !file.fail();
+}
+
+class NormalMapBaker::Corner
+{
+public:
+	float u;
+	float v;
+	sm::Vec3 position;
+	sm::Vec3 normal;
+	sm::Vec3 tangent;
+	float tangentSign;
+};
+
+class NormalMapBaker::TileBaker
+{
+public:
+	TileBaker(
+		const Bvh &bvh,
+		const std::vector<sm::Vec3> &highVertices,
+		const std::vector<sm::Vec3> &highNormals,
+		const std::vector<Corner> &lowCorners,
+		const std::vector<std::vector<int> > &tileTriangles,
+		int tilesX,
+		float maxDistance,
+		NormalMap &normalMap,
+		std::vector<uint8_t> &coverage) :
+		m_bvh(bvh),
+		m_highVertices(highVertices),
+		m_highNormals(highNormals),
+		m_lowCorners(lowCorners),
+		m_tileTriangles(tileTriangles),
+		m_tilesX(tilesX),
+		m_maxDistance(maxDistance),
+		m_normalMap(normalMap),
+		m_coverage(coverage)
+	{
+	}
+
+	void operator()(int tile)
+	{
+		const std::vector<int> &triangles = m_tileTriangles[tile];
+		if (triangles.size() == 0)
+			return;
+
+		int firstX = (tile % m_tilesX) * TileSize;
+		int firstY = (tile / m_tilesX) * TileSize;
+		int lastX = std::min(firstX + TileSize, m_normalMap.width);
+		int lastY = std::min(firstY + TileSize, m_normalMap.height);
+
+		for (int y = firstY; y < lastY; y++)
+		{
+			for (int x = firstX; x < lastX; x++)
+			{
+				float u = (x + 0.5f) / m_normalMap.width;
+				float v = (y + 0.5f) / m_normalMap.height;
+
+				for (unsigned i = 0; i < triangles.size(); i++)
+				{
+					if (BakeTexel(triangles[i], u, v, &m_normalMap.pixels[(y * m_normalMap.width + x) * 3]))
+					{
+						m_coverage[y * m_normalMap.width + x] = 1;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+private:
+	const Bvh &m_bvh;
+	const std::vector<sm::Vec3> &m_highVertices;
+	const std::vector<sm::Vec3> &m_highNormals;
+	const std::vector<Corner> &m_lowCorners;
+	const std::vector<std::vector<int> > &m_tileTriangles;
+	int m_tilesX;
+	float m_maxDistance;
+	NormalMap &m_normalMap;
+	std::vector<uint8_t> &m_coverage;
+
+	bool BakeTexel(int triangle, float u, float v, uint8_t *pixel)
+	{
+		const Corner &a = m_lowCorners[triangle * 3 + 0];
+		const Corner &b = m_lowCorners[triangle * 3 + 1];
+		const Corner &c = m_lowCorners[triangle * 3 + 2];
+
+		// barycentric coordinates of the texel center in the uv triangle
+		float area = (b.u - a.u) * (c.v - a.v) - (c.u - a.u) * (b.v - a.v);
+		if (area == 0.0f)
+			return false;
+
+		float wb = ((u - a.u) * (c.v - a.v) - (c.u - a.u) * (v - a.v)) / area;
+		float wc = ((b.u - a.u) * (v - a.v) - (u - a.u) * (b.v - a.v)) / area;
+		float wa = 1.0f - wb - wc;
+
+		if (wa < 0.0f || wb < 0.0f || wc < 0.0f)
+			return false;
+
+		sm::Vec3 position = a.position * wa + b.position * wb + c.position * wc;
+		sm::Vec3 normal = a.normal * wa + b.normal * wb + c.normal * wc;
+		sm::Vec3 tangent = a.tangent * wa + b.tangent * wb + c.tangent * wc;
+
+		Normalize(normal);
+		tangent = tangent - normal * sm::Vec3::Dot(normal, tangent);
+		Normalize(tangent);
+
+		// corners of one triangle share the sign unless it spans a uv seam
+		float tangentSign = a.tangentSign * wa + b.tangentSign * wb + c.tangentSign * wc;
+		sm::Vec3 bitangent = Cross(normal, tangent) * (tangentSign < 0.0f ? -1.0f : 1.0f);
+
+		// from a cage above the surface down through it, the first hit is
+		// the high surface closest to the outside
+		sm::Vec3 origin = position + normal * m_maxDistance;
+
+		float distance;
+		int hit = m_bvh.FindHit(origin, normal * -1.0f, m_maxDistance * 2.0f, distance);
+
+		sm::Vec3 highNormal = normal;
+
+		if (hit != -1)
+		{
+			const sm::Vec3 &ha = m_highVertices[hit * 3 + 0];
+			const sm::Vec3 &hb = m_highVertices[hit * 3 + 1];
+			const sm::Vec3 &hc = m_highVertices[hit * 3 + 2];
+
+			sm::Vec3 point = origin - normal * distance;
+
+			// barycentric coordinates of the hit from the sub triangle areas
+			sm::Vec3 faceNormal = Cross(hb - ha, hc - ha);
+			float faceArea = sm::Vec3::Dot(faceNormal, faceNormal);
+
+			if (faceArea > 0.0f)
+			{
+				float hwb = sm::Vec3::Dot(Cross(point - ha, hc - ha), faceNormal) / faceArea;
+				float hwc = sm::Vec3::Dot(Cross(hb - ha, point - ha), faceNormal) / faceArea;
+				float hwa = 1.0f - hwb - hwc;
+
+				highNormal =
+					m_highNormals[hit * 3 + 0] * hwa +
+					m_highNormals[hit * 3 + 1] * hwb +
+					m_highNormals[hit * 3 + 2] * hwc;
+				Normalize(highNormal);
+			}
+		}
+
+		float tangentSpace[3] =
+		{
+			sm::Vec3::Dot(highNormal, tangent),
+			sm::Vec3::Dot(highNormal, bitangent),
+			sm::Vec3::Dot(highNormal, normal)
+		};
+
+		for (int i = 0; i < 3; i++)
+		{
+			float value = std::min(std::max(tangentSpace[i], -1.0f), 1.0f);
+			pixel[i] = (uint8_t)((value * 0.5f + 0.5f) * 255.0f + 0.5f);
+		}
+
+		return true;
+	}
+};
+
+bool NormalMapBaker::Bake(const GeoFile::Mesh *lowMesh, const GeoFile::Mesh *highMesh, int size, float maxDistance, NormalMap &normalMap)
+{
+	// high mesh triangles with their normals, face normals when the part has none
+	std::vector<sm::Vec3> highVertices;
+	std::vector<sm::Vec3> highNormals;
+
+	for (unsigned i = 0; i < highMesh->parts.size(); i++)
+	{
+		const GeoFile::Part *part = highMesh->parts[i];
+		int stride = part->GetFloatsPerVertex();
+		int normalOffset = part->GetNormalOffset();
+
+		for (unsigned j = 0; j + 2 < part->indices.size(); j += 3)
+		{
+			sm::Vec3 corners[3];
+			for (int k = 0; k < 3; k++)
+			{
+				const float *vertex = &part->vertices[part->indices[j + k] * stride];
+				corners[k].Set(vertex[0], vertex[1], vertex[2]);
+				highVertices.push_back(corners[k]);
+			}
+
+			sm::Vec3 faceNormal = Cross(corners[1] - corners[0], corners[2] - corners[0]);
+			Normalize(faceNormal);
+
+			for (int k = 0; k < 3; k++)
+			{
+				if (normalOffset == -1)
+				{
+					highNormals.push_back(faceNormal);
+					continue;
+				}
+
+				const float *normal = &part->vertices[part->indices[j + k] * stride + normalOffset];
+				highNormals.push_back(sm::Vec3(normal[0], normal[1], normal[2]));
+			}
+		}
+	}
+
+	// per part tangent signs of the low mesh, empty for a part means all positive
+	std::vector<std::vector<int8_t> > lowSigns;
+	if (!ReadTangentSigns(lowMesh, lowSigns))
+		Log::LogT("warning: '%s' has no tangent signs, mirrored uvs bake with a flipped bitangent", lowMesh->name.c_str());
+
+	// low mesh triangle corners, parts without uv1, normals or tangents are skipped
+	std::vector<Corner> lowCorners;
+	sm::Vec3 lowMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	sm::Vec3 lowMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (unsigned i = 0; i < lowMesh->parts.size(); i++)
+	{
+		const GeoFile::Part *part = lowMesh->parts[i];
+		int stride = part->GetFloatsPerVertex();
+		int coordsOffset = part->GetCoords1Offset();
+		int normalOffset = part->GetNormalOffset();
+		int tangentOffset = part->GetTangentOffset();
+
+		if (coordsOffset == -1 || normalOffset == -1 || tangentOffset == -1)
+		{
+			Log::LogT("warning: part %d of '%s' has no uv, normals or tangents, not baked", i, lowMesh->name.c_str());
+			continue;
+		}
+
+		const std::vector<int8_t> *signs = NULL;
+		if (i < lowSigns.size() && lowSigns[i].size() > 0)
+		{
+			if (lowSigns[i].size() * stride == part->vertices.size())
+				signs = &lowSigns[i];
+			else
+				Log::LogT("warning: tangent signs of part %d of '%s' don't match its vertices, ignored", i, lowMesh->name.c_str());
+		}
+
+		for (unsigned j = 0; j + 2 < part->indices.size(); j += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t index = part->indices[j + k];
+				const float *vertex = &part->vertices[index * stride];
+
+				Corner corner;
+				corner.u = vertex[coordsOffset + 0];
+				corner.v = vertex[coordsOffset + 1];
+				corner.position.Set(vertex[0], vertex[1], vertex[2]);
+				corner.normal.Set(vertex[normalOffset + 0], vertex[normalOffset + 1], vertex[normalOffset + 2]);
+				corner.tangent.Set(vertex[tangentOffset + 0], vertex[tangentOffset + 1], vertex[tangentOffset + 2]);
+				corner.tangentSign = (signs != NULL && (*signs)[index] < 0) ? -1.0f : 1.0f;
+				lowCorners.push_back(corner);
+
+				const sm::Vec3 &p = corner.position;
+				lowMin.Set(std::min(lowMin.x, p.x), std::min(lowMin.y, p.y), std::min(lowMin.z, p.z));
+				lowMax.Set(std::max(lowMax.x, p.x), std::max(lowMax.y, p.y), std::max(lowMax.z, p.z));
+			}
+		}
+	}
+
+	if (highVertices.size() == 0 || lowCorners.size() == 0 || size <= 0)
+		return false;
+
+	if (maxDistance <= 0.0f)
+	{
+		sm::Vec3 lowSize = lowMax - lowMin;
+		maxDistance = sqrtf(sm::Vec3::Dot(lowSize, lowSize)) * 0.05f;
+	}
+
+	normalMap.width = size;
+	normalMap.height = size;
+	normalMap.pixels.resize(size * size * 3);
+
+	// background is the flat normal
+	for (int i = 0; i < size * size; i++)
+	{
+		normalMap.pixels[i * 3 + 0] = 128;
+		normalMap.pixels[i * 3 + 1] = 128;
+		normalMap.pixels[i * 3 + 2] = 255;
+	}
+
+	int tilesX = (size + TileSize - 1) / TileSize;
+	int tilesY = tilesX;
+
+	// triangles go to every tile their uv bounds overlap, uv outside of [0, 1) isn't baked
+	std::vector<std::vector<int> > tileTriangles(tilesX * tilesY);
+
+	for (int i = 0; i < (int)lowCorners.size() / 3; i++)
+	{
+		float minU = FLT_MAX;
+		float minV = FLT_MAX;
+		float maxU = -FLT_MAX;
+		float maxV = -FLT_MAX;
+
+		for (int j = 0; j < 3; j++)
+		{
+			minU = std::min(minU, lowCorners[i * 3 + j].u);
+			minV = std::min(minV, lowCorners[i * 3 + j].v);
+			maxU = std::max(maxU, lowCorners[i * 3 + j].u);
+			maxV = std::max(maxV, lowCorners[i * 3 + j].v);
+		}
+
+		int firstTileX = std::max((int)floorf(minU * size) / TileSize, 0);
+		int firstTileY = std::max((int)floorf(minV * size) / TileSize, 0);
+		int lastTileX = std::min((int)floorf(maxU * size) / TileSize, tilesX - 1);
+		int lastTileY = std::min((int)floorf(maxV * size) / TileSize, tilesY - 1);
+
+		for (int y = firstTileY; y <= lastTileY; y++)
+			for (int x = firstTileX; x <= lastTileX; x++)
+				tileTriangles[y * tilesX + x].push_back(i);
+	}
+
+	Bvh bvh;
+	bvh.Build(highVertices);
+
+	std::vector<uint8_t> coverage(size * size);
+
+	TileBaker tileBaker(bvh, highVertices, highNormals, lowCorners, tileTriangles, tilesX, maxDistance, normalMap, coverage);
+	ParallelFor::Run(tilesX * tilesY, tileBaker);
+
+	Dilate(normalMap, coverage);
+
+	return true;
+}
+
+// Reads the "TSGN" chunk the exporter saves with meshes that have tangents,
+// false when there isn't one or it's cut short.
+bool NormalMapBaker::ReadTangentSigns(const GeoFile::Mesh *mesh, std::vector<std::vector<int8_t> > &partSigns)
+{
+	const Scene3DMeshChunk *chunk = mesh->FindChunk("TSGN");
+	if (chunk == NULL)
+		return false;
+
+	const std::string &data = chunk->data;
+	size_t offset = 0;
+
+	int partsCount;
+	if (data.size() < sizeof(int))
+		return false;
+	memcpy(&partsCount, data.data(), sizeof(int));
+	offset += sizeof(int);
+
+	if (partsCount < 0)
+		return false;
+
+	partSigns.clear();
+	partSigns.resize(partsCount);
+
+	for (int i = 0; i < partsCount; i++)
+	{
+		int count;
+		if (data.size() - offset < sizeof(int))
+			return false;
+		memcpy(&count, data.data() + offset, sizeof(int));
+		offset += sizeof(int);
+
+		if (count < 0 || data.size() - offset < (size_t)count)
+			return false;
+
+		partSigns[i].assign((const int8_t*)data.data() + offset, (const int8_t*)data.data() + offset + count);
+		offset += count;
+	}
+
+	return true;
+}
+
+void NormalMapBaker::Dilate(NormalMap &normalMap, std::vector<uint8_t> &coverage)
+{
+	static const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+	int width = normalMap.width;
+	int height = normalMap.height;
+
+	for (int pass = 0; pass < DilationTexels; pass++)
+	{
+		std::vector<uint8_t> grown = coverage;
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				if (coverage[y * width + x])
+					continue;
+
+				for (int i = 0; i < 4; i++)
+				{
+					int nx = x + offsets[i][0];
+					int ny = y + offsets[i][1];
+
+					if (nx < 0 || ny < 0 || nx >= width || ny >= height || !coverage[ny * width + nx])
+						continue;
+
+					for (int j = 0; j < 3; j++)
+						normalMap.pixels[(y * width + x) * 3 + j] = normalMap.pixels[(ny * width + nx) * 3 + j];
+
+					grown[y * width + x] = 1;
+					break;
+				}
+			}
+		}
+
+		coverage.swap(grown);
+	}
+}
+
+void NormalMapBaker::Normalize(sm::Vec3 &v)
+{
+	float length = sqrtf(sm::Vec3::Dot(v, v));
+
+	if (length > 0.0f)
+		v = v * (1.0f / length);
+}
+
+sm::Vec3 NormalMapBaker::Cross(const sm::Vec3 &a, const sm::Vec3 &b)
+{
+	return sm::Vec3(
+		a.y * b.z - a.z * b.y,
+		a.z * b.x - a.x * b.z,
+		a.x * b.y - a.y * b.x);
+}
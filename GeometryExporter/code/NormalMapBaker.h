@@ -0,0 +1,49 @@
+#pragma once
+
+#include "GeoFile.h"
+
+#include <Math/Vec3.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// RGB image, rows go up from v = 0 like the uv layout. Saved as an
+// uncompressed 24 bit TGA, which stores rows bottom up too.
+class NormalMap
+{
+public:
+	int width;
+	int height;
+	std::vector<uint8_t> pixels;
+
+	bool SaveTga(const std::string &fileName) const;
+};
+
+// Bakes the normals of a high poly mesh into the uv1 layout of a low poly
+// one. Normals are stored in the tangent space the exporter saves with the
+// low mesh: its normal, its tangent made orthogonal to it and the bitangent
+// cross(normal, tangent) flipped by the sign in the low mesh's "TSGN"
+// chunk, each component mapped from [-1, 1] to [0, 255].
+class NormalMapBaker
+{
+public:
+	// rays search the high mesh up to maxDistance above and below the low
+	// surface, 0 picks 5% of the low mesh's bounds diagonal
+	static bool Bake(const GeoFile::Mesh *lowMesh, const GeoFile::Mesh *highMesh, int size, float maxDistance, NormalMap &normalMap);
+
+private:
+	// texels baked by one ParallelFor item
+	static const int TileSize;
+
+	// texels the baked texels are grown by, so filtering doesn't pull in the background
+	static const int DilationTexels;
+
+	class Corner;
+	class TileBaker;
+
+	static bool ReadTangentSigns(const GeoFile::Mesh *mesh, std::vector<std::vector<int8_t> > &partSigns);
+	static void Dilate(NormalMap &normalMap, std::vector<uint8_t> &coverage);
+	static void Normalize(sm::Vec3 &v);
+	static sm::Vec3 Cross(const sm::Vec3 &a, const sm::Vec3 &b);
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <thread>
+#include <atomic>
+#endif
+
+#include <vector>
+
+// Calls body(i) for every i in [0, count) on all processors. Indices are
+// handed out one by one, so uneven work gets balanced. Body must be safe to
+// call from many threads at once. Outside of Windows, std::thread is used,
+// so the bake tools build on other platforms too.
+class ParallelFor
+{
+public:
+	template <typename Body>
+	static void Run(int count, Body &body)
+	{
+		if (count <= 0)
+			return;
+
+		Context<Body> context;
+		context.body = &body;
+		context.count = count;
+		context.next = 0;
+
+		int threadsCount = GetProcessorsCount();
+		if (threadsCount > count)
+			threadsCount = count;
+
+#ifdef _WIN32
+		std::vector<HANDLE> threads;
+
+		for (int i = 0; i < threadsCount; i++)
+		{
+			DWORD threadId;
+			HANDLE hThread = CreateThread(NULL, 0, Thread<Body>, &context, 0, &threadId);
+
+			if (hThread != NULL)
+				threads.push_back(hThread);
+		}
+
+		// no thread could be started, do the work here
+		if (threads.size() == 0)
+			Thread<Body>(&context);
+
+		for (unsigned i = 0; i < threads.size(); i++)
+		{
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+#else
+		std::vector<std::thread> threads;
+
+		for (int i = 0; i < threadsCount; i++)
+			threads.push_back(std::thread(Thread<Body>, &context));
+
+		for (unsigned i = 0; i < threads.size(); i++)
+			threads[i].join();
+#endif
+	}
+
+	static int GetProcessorsCount()
+	{
+#ifdef _WIN32
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+
+		int processorsCount = (int)systemInfo.dwNumberOfProcessors;
+#else
+		int processorsCount = (int)std::thread::hardware_concurrency();
+#endif
+
+		return processorsCount > 0 ? processorsCount : 1;
+	}
+
+private:
+	template <typename Body>
+	class Context
+	{
+	public:
+		Body *body;
+		int count;
+
+#ifdef _WIN32
+		volatile LONG next;
+#else
+		std::atomic<int> next;
+#endif
+	};
+
+#ifdef _WIN32
+	template <typename Body>
+	static DWORD WINAPI Thread(LPVOID param)
+#else
+	template <typename Body>
+	static void Thread(Context<Body> *param)
+#endif
+	{
+		Context<Body> *context = (Context<Body>*)param;
+
+		while (true)
+		{
+#ifdef _WIN32
+			int index = (int)InterlockedIncrement(&context->next) - 1;
+#else
+			int index = context->next++;
+#endif
+			if (index >= context->count)
+				break;
+
+			(*context->body)(index);
+		}
+
+#ifdef _WIN32
+		return 0;
+#endif
+	}
+};
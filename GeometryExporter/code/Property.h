@@ -1,15 +1,18 @@
 #pragma once
 
-#include "D:\stuff\Infected Bunnies\code\ssg02\HerdBunniesSimulator\Framework\Graphics\Interpolators\StateInterpolator.h"
-#include "D:\stuff\Infected Bunnies\code\ssg02\HerdBunniesSimulator\Framework\Graphics\Interpolators\TCBInterpolator.h"
-#include "D:\stuff\Infected Bunnies\code\ssg02\HerdBunniesSimulator\Framework\Graphics\Interpolators\LinearInterpolator.h"
-
 #include <Math/Vec3.h>
 
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
 
+// Value of a mesh property, static or keyed. The value sits in a tagged
+// union and keys in contiguous arrays, so a static property allocates
+// nothing and keys are read without going through interpolator objects.
 class Property
 {
 public:
@@ -27,26 +30,35 @@ public:
 		AnimationType_None,		// no animation
 		AnimationType_State,	// state animation, no interpolation between keyframes
 		AnimationType_Linear,	// linear animation for floats and vectors
-		AnimationType_TCB		// KochanekBartels spline interpolation for floats and vectors
+		AnimationType_TCB,		// Kochanek-Bartels spline interpolation for floats and vectors
+		AnimationType_Sampled	// linear between samples at a fixed rate, for floats and vectors
+	};
+
+	// strings don't fit in, they are kept aside
+	union Value
+	{
+		bool boolValue;
+		int intValue;
+		float floatValue;
+		float vector3Value[3];
 	};
 
 	Property(
 		const std::string &name,
 		PropertyType propType,
 		AnimationType animType) :
-		
+
 		m_name(name),
 		m_propType(propType),
 		m_animType(animType),
-		m_value(NULL)
+		m_sampleStart(0.0f),
+		m_sampleStep(0.0f)
 	{
-		InitProperty();
-	}
+		assert(animType == AnimationType_None || propType != PropertyType_String);
+		assert(animType == AnimationType_None || animType == AnimationType_State || propType != PropertyType_Boolean);
+		assert(animType != AnimationType_Sampled || propType == PropertyType_Float || propType == PropertyType_Vector3);
 
-	~Property()
-	{
-		if (m_value != NULL)
-			delete m_value;
+		memset(&m_value, 0, sizeof(Value));
 	}
 
 	bool IsAnimatable() const
@@ -58,17 +70,65 @@ public:
 	{
 		assert(m_animType != AnimationType_None);
 
-		return ((IKeysContainer*)m_value)->GetKeysCount();
+		return (unsigned int)m_keyTimes.size();
 	}
 
-	template <typename Type>
-	IInterpolator<Type> *GetInterpolator()
+	// keys in the order they were set, times in seconds
+	const std::vector<float>& GetKeyTimes() const
 	{
-		assert(m_animType != AnimationType_None);
+		return m_keyTimes;
+	}
+
+	const std::vector<Value>& GetKeyValues() const
+	{
+		return m_keyValues;
+	}
+
+	// replaces all keys, times and values have to be of the same size
+	void SetKeys(const std::vector<float> &times, const std::vector<Value> &values)
+	{
+		assert(m_animType != AnimationType_None && m_animType != AnimationType_Sampled && times.size() == values.size());
 
-		return (IInterpolator<Type>*)m_value;
+		m_keyTimes = times;
+		m_keyValues = values;
 	}
 
+	// Replaces the keys with samples taken every step seconds from start,
+	// the value at a time is then found by index, not by searching keys.
+	// Key times are kept too, so samples read like keys.
+	void SetSamples(float start, float step, const std::vector<Value> &values)
+	{
+		assert(m_animType == AnimationType_Sampled && step > 0.0f);
+
+		m_sampleStart = start;
+		m_sampleStep = step;
+		m_keyValues = values;
+
+		m_keyTimes.resize(values.size());
+		for (unsigned i = 0; i < values.size(); i++)
+			m_keyTimes[i] = start + step * (float)i;
+	}
+
+	float GetSampleStart() const
+	{
+		return m_sampleStart;
+	}
+
+	float GetSampleStep() const
+	{
+		return m_sampleStep;
+	}
+
+	// floats a value of the property's type takes, 0 for strings
+	unsigned int GetComponentsCount() const
+	{
+		switch (m_propType)
+		{
+		case PropertyType_Vector3: return 3;
+		case PropertyType_String: return 0;
+		default: return 1;
+		}
+	}
 
 	std::string GetName() const
 	{
@@ -85,176 +145,238 @@ public:
 		return m_animType;
 	}
 
-	void SetValue(bool value)
+	void SetValue(bool value, float time = 0)
 	{
 		assert(m_propType == PropertyType_Boolean);
-		memcpy(m_value, &value, sizeof(bool));
+
+		Value key;
+		key.boolValue = value;
+		Store(key, time);
 	}
 
 	void SetValue(int value, float time = 0)
 	{
 		assert(m_propType == PropertyType_Int);
-		
-		if (m_animType == AnimationType_None)
-			memcpy(m_value, &value, sizeof(int));
-		else
-		{
-			((Interpolator<int>*)m_value)->AddKeyframe(time, value, false);
-		}
+
+		Value key;
+		key.intValue = value;
+		Store(key, time);
 	}
 
 	void SetValue(float value, float time = 0)
 	{
 		assert(m_propType == PropertyType_Float);
 
-		if (m_animType == AnimationType_None)
-			memcpy(m_value, &value, sizeof(float));
-		else
-		{
-			((Interpolator<float>*)m_value)->AddKeyframe(time, value, false);
-		}
+		Value key;
+		key.floatValue = value;
+		Store(key, time);
 	}
 
-	void SetValue(sm::Vec3 value)
+	void SetValue(sm::Vec3 value, float time = 0)
 	{
 		assert(m_propType == PropertyType_Vector3);
-		memcpy(m_value, &value, sizeof(sm::Vec3));
+
+		Value key;
+		key.vector3Value[0] = value.x;
+		key.vector3Value[1] = value.y;
+		key.vector3Value[2] = value.z;
+		Store(key, time);
 	}
 
 	void SetValue(const wchar_t *value)
 	{
 		assert(m_propType == PropertyType_String);
-		*((std::wstring*)m_value) = value;
+		m_stringValue = value;
 	}
 
-	bool GetBoolValue()
+	bool GetBoolValue(float time = 0.0f) const
 	{
 		assert(m_propType == PropertyType_Boolean);
-		bool value;
-		memcpy(&value, m_value, sizeof(bool));
-		return value;
+		return Evaluate(time).boolValue;
 	}
 
-	int GetIntValue(float time = 0.0f)
+	int GetIntValue(float time = 0.0f) const
 	{
 		assert(m_propType == PropertyType_Int);
+		return Evaluate(time).intValue;
+	}
 
-		int value;
+	float GetFloatValue(float time = 0.0f) const
+	{
+		assert(m_propType == PropertyType_Float);
+		return Evaluate(time).floatValue;
+	}
 
-		if (!IsAnimatable())
-		{
-			memcpy(&value, m_value, sizeof(int));
-		}
-		else
-		{
-			((IInterpolator<int>*)m_value)->GetValue(time, value);
-		}
+	sm::Vec3 GetVector3Value(float time = 0.0f) const
+	{
+		assert(m_propType == PropertyType_Vector3);
 
-		return value;
+		Value value = Evaluate(time);
+		return sm::Vec3(value.vector3Value[0], value.vector3Value[1], value.vector3Value[2]);
 	}
 
-	float GetFloatValue(float time = 0.0f)
+	const wchar_t* GetStringValue() const
 	{
-		assert(m_propType == PropertyType_Float);
+		assert(m_propType == PropertyType_String);
+		return m_stringValue.c_str();
+	}
 
-		float value;
+	// Value at the time, the static one when the property isn't animated.
+	// Before the first and after the last key the value holds still.
+	Value Evaluate(float time) const
+	{
+		if (m_animType == AnimationType_None || m_keyTimes.size() == 0)
+			return m_value;
 
-		if (!IsAnimatable())
-		{
-			memcpy(&value, m_value, sizeof(float));
-		}
-		else
+		if (m_animType == AnimationType_Sampled)
+			return EvaluateSampled(time);
+
+		unsigned next = (unsigned)(std::upper_bound(m_keyTimes.begin(), m_keyTimes.end(), time) - m_keyTimes.begin());
+
+		if (next == 0)
+			return m_keyValues[0];
+
+		if (next == m_keyTimes.size() || m_animType == AnimationType_State)
+			return m_keyValues[next - 1];
+
+		unsigned prev = next - 1;
+
+		float duration = m_keyTimes[next] - m_keyTimes[prev];
+		float s = duration > 0.0f ? (time - m_keyTimes[prev]) / duration : 0.0f;
+
+		Value value;
+		memset(&value, 0, sizeof(Value));
+
+		for (unsigned i = 0; i < GetComponentsCount(); i++)
 		{
-			((IInterpolator<float>*)m_value)->GetValue(time, value);
+			float a = GetComponent(m_keyValues[prev], i);
+			float b = GetComponent(m_keyValues[next], i);
+			float result;
+
+			if (m_animType == AnimationType_Linear)
+				result = a + (b - a) * s;
+			else
+			{
+				// Kochanek-Bartels with zero tension, continuity and bias: Catmull-Rom
+				// tangents, scaled to the segment, so uneven keys don't overshoot
+				float tangentA = GetTangent(prev, i) * duration;
+				float tangentB = GetTangent(next, i) * duration;
+
+				float s2 = s * s;
+				float s3 = s2 * s;
+
+				result =
+					a * (2.0f * s3 - 3.0f * s2 + 1.0f) +
+					tangentA * (s3 - 2.0f * s2 + s) +
+					b * (-2.0f * s3 + 3.0f * s2) +
+					tangentB * (s3 - s2);
+			}
+
+			SetComponent(value, i, result);
 		}
 
 		return value;
 	}
 
-	sm::Vec3 GetVector3Value()
+	float GetComponent(const Value &value, unsigned index) const
 	{
-		assert(m_propType == PropertyType_Vector3);
-		sm::Vec3 value;
-		memcpy(&value, m_value, sizeof(sm::Vec3));
-		return value;
+		switch (m_propType)
+		{
+		case PropertyType_Boolean: return value.boolValue ? 1.0f : 0.0f;
+		case PropertyType_Int: return (float)value.intValue;
+		case PropertyType_Float: return value.floatValue;
+		case PropertyType_Vector3: return value.vector3Value[index];
+		default: return 0.0f;
+		}
 	}
 
-	const wchar_t* GetStringValue()
+	void SetComponent(Value &value, unsigned index, float component) const
 	{
-		assert(m_propType == PropertyType_String);
-		return ((std::wstring*)m_value) ->c_str();
+		switch (m_propType)
+		{
+		case PropertyType_Boolean: value.boolValue = component >= 0.5f; break;
+		case PropertyType_Int: value.intValue = (int)floorf(component + 0.5f); break;
+		case PropertyType_Float: value.floatValue = component; break;
+		case PropertyType_Vector3: value.vector3Value[index] = component; break;
+		default: break;
+		}
 	}
 
 private:
 	std::string m_name;
 	PropertyType m_propType;
 	AnimationType m_animType;
-	void *m_value;
 
-	// this initialization sux and sould be rewritten
-	void InitProperty()
+	Value m_value;
+	std::wstring m_stringValue;
+
+	std::vector<float> m_keyTimes;
+	std::vector<Value> m_keyValues;
+
+	float m_sampleStart;
+	float m_sampleStep;
+
+	void Store(const Value &value, float time)
 	{
-		if (!IsAnimatable())
+		if (m_animType == AnimationType_None)
 		{
-			switch (m_propType)
-			{
-			case PropertyType_Boolean: m_value = new bool(); break;
-			case PropertyType_Int: m_value = new int(); break;
-			case PropertyType_Float: m_value = new float(); break;
-			case PropertyType_Vector3: m_value = new sm::Vec3(); break;
-			case PropertyType_String: m_value = new std::wstring(); break;
-			}
+			m_value = value;
+			return;
 		}
-		else
+
+		assert(m_animType != AnimationType_Sampled);
+
+		// keys come sorted from max, a key at the time of the last one replaces it
+		if (m_keyTimes.size() > 0 && m_keyTimes.back() == time)
 		{
-			//InterpolatorFactory::InterpolationFunction interMethod;
+			m_keyValues.back() = value;
+			return;
+		}
 
-			/*switch (m_animType)
-			{
-			case AnimationType_State: interMethod = InterpolatorFactory::InterpolationMethod_State;
-			case AnimationType_Linear: interMethod = InterpolatorFactory::InterpolationMethod_Linear;
-			case AnimationType_TCB: interMethod = InterpolatorFactory::InterpolationMethod_TCB;
-			}*/
+		assert(m_keyTimes.size() == 0 || m_keyTimes.back() < time);
 
-			switch (m_animType)
-			{
-			case AnimationType_State:
-				switch (m_propType)
-				{
-				case PropertyType_Boolean: m_value = new StateInterpolator<bool>(); break;
-				case PropertyType_Int: m_value = new StateInterpolator<int>(); break;
-				case PropertyType_Float: m_value = new StateInterpolator<float>(); break;
-				case PropertyType_Vector3: m_value = new StateInterpolator<sm::Vec3>(); break;
-				case PropertyType_String: m_value = new StateInterpolator<std::wstring>(); break;
-				}
-
-				break;
-
-			case AnimationType_Linear:
-				switch (m_propType)
-				{
-				case PropertyType_Boolean: assert(0); break;
-				case PropertyType_Int: m_value = new LinearInterpolator<int>(); break;
-				case PropertyType_Float: m_value = new LinearInterpolator<float>(); break;
-				case PropertyType_Vector3: m_value = new LinearInterpolator<sm::Vec3>(); break;
-				case PropertyType_String: assert(0); break;
-				}
-
-				break;
-
-			case AnimationType_TCB:
-				switch (m_propType)
-				{
-				case PropertyType_Boolean: assert(0); break;
-				case PropertyType_Int: m_value = new TCBInterpolator<int>(); break;
-				case PropertyType_Float: m_value = new TCBInterpolator<float>(); break;
-				case PropertyType_Vector3: m_value = new TCBInterpolator<sm::Vec3>(); break;
-				case PropertyType_String: assert(0); break;
-				}
-
-				break;
-			}
+		m_keyTimes.push_back(time);
+		m_keyValues.push_back(value);
+	}
+
+	Value EvaluateSampled(float time) const
+	{
+		unsigned last = (unsigned)m_keyValues.size() - 1;
+		float position = (time - m_sampleStart) / m_sampleStep;
+
+		if (position <= 0.0f)
+			return m_keyValues[0];
+
+		if (position >= (float)last)
+			return m_keyValues[last];
+
+		unsigned prev = (unsigned)position;
+		float s = position - (float)prev;
+
+		Value value;
+		memset(&value, 0, sizeof(Value));
+
+		for (unsigned i = 0; i < GetComponentsCount(); i++)
+		{
+			float a = GetComponent(m_keyValues[prev], i);
+			float b = GetComponent(m_keyValues[prev + 1], i);
+
+			SetComponent(value, i, a + (b - a) * s);
 		}
+
+		return value;
 	}
-};
 
+	// slope of the component at the key, in value per second
+	float GetTangent(unsigned key, unsigned index) const
+	{
+		unsigned prev = key > 0 ? key - 1 : key;
+		unsigned next = key + 1 < m_keyTimes.size() ? key + 1 : key;
+
+		float duration = m_keyTimes[next] - m_keyTimes[prev];
+		if (duration <= 0.0f)
+			return 0.0f;
+
+		return (GetComponent(m_keyValues[next], index) - GetComponent(m_keyValues[prev], index)) / duration;
+	}
+};
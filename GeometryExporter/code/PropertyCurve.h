@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Property.h"
+
+// Values of an animated property at any time, as the controller that
+// authored it gives them. Property::Evaluate reads tcb keys as a Catmull-Rom
+// spline, a 3ds Max tcb controller also has tension, continuity, bias and
+// ease per key, so steps that bake or check a track against its curve take
+// the values from here when the controller is at hand.
+class PropertyCurve
+{
+public:
+	virtual ~PropertyCurve() {}
+
+	virtual Property::Value Evaluate(float time) const = 0;
+};
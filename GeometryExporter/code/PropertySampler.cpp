@@ -0,0 +1,52 @@
+#include "PropertySampler.h"
+
+#include <Utils/Log.h>
+
+#include <vector>
+#include <math.h>
+
+const unsigned PropertySampler::MaxSamplesCount = 65536;
+
+Property* PropertySampler::Resample(const Property *prop, float rate, const PropertyCurve *curve)
+{
+	if (prop->GetPropertyType() != Property::PropertyType_Float &&
+		prop->GetPropertyType() != Property::PropertyType_Vector3)
+		return NULL;
+
+	if (prop->GetAnimationType() != Property::AnimationType_Linear &&
+		prop->GetAnimationType() != Property::AnimationType_TCB)
+		return NULL;
+
+	if (prop->GetKeysCount() < 2 || rate <= 0.0f)
+		return NULL;
+
+	float start = prop->GetKeyTimes().front();
+	float duration = prop->GetKeyTimes().back() - start;
+
+	if (duration <= 0.0f)
+		return NULL;
+
+	// the step is shortened a bit, so the last sample lands on the last key
+	// counted in floats, a long track at a high rate doesn't fit an unsigned
+	float samplesCountF = ceilf(duration * rate) + 1.0f;
+	unsigned samplesCount = MaxSamplesCount;
+
+	if (samplesCountF > (float)MaxSamplesCount)
+	{
+		Log::LogT("warning: property %s needs %.0f samples, only %u are taken",
+			prop->GetName().c_str(), samplesCountF, MaxSamplesCount);
+	}
+	else
+		samplesCount = (unsigned)samplesCountF;
+
+	float step = duration / (float)(samplesCount - 1);
+
+	std::vector<Property::Value> samples(samplesCount);
+	for (unsigned i = 0; i < samplesCount; i++)
+		samples[i] = curve != NULL ? curve->Evaluate(start + step * (float)i) : prop->Evaluate(start + step * (float)i);
+
+	Property *sampled = new Property(prop->GetName(), prop->GetPropertyType(), Property::AnimationType_Sampled);
+	sampled->SetSamples(start, step, samples);
+
+	return sampled;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Property.h"
+#include "PropertyCurve.h"
+
+// Resamples linear and tcb tracks of floats and vectors at a fixed rate,
+// so evaluating them is an index and a lerp instead of a search through
+// the keys and a spline. Long tcb curves cost the most on slow platforms,
+// the samples trade that for size.
+class PropertySampler
+{
+public:
+	// Returns a sampled copy of the property, samples from its first to its
+	// last key at least rate per second, or NULL when it isn't a linear or
+	// tcb float or vector or has no time between its keys. Long tracks get
+	// at most MaxSamplesCount samples, at a lower rate. Samples are taken
+	// from curve when it isn't NULL, else from the property's keys.
+	static Property* Resample(const Property *prop, float rate, const PropertyCurve *curve);
+
+private:
+	static const unsigned MaxSamplesCount;
+};
@@ -0,0 +1,178 @@
+#include "PropertyTable.h"
+
+#include <algorithm>
+
+PropertyTable::PropertyTable() :
+	m_channelsCount(0)
+{
+}
+
+int PropertyTable::Add(const Property *prop)
+{
+	if (!prop->IsAnimatable() || prop->GetKeysCount() == 0 || prop->GetComponentsCount() == 0)
+		return -1;
+
+	Table *table = NULL;
+
+	switch (prop->GetAnimationType())
+	{
+	case Property::AnimationType_State: table = &m_state; break;
+	case Property::AnimationType_Linear:
+	case Property::AnimationType_Sampled: table = &m_linear; break;
+	case Property::AnimationType_TCB: table = &m_tcb; break;
+	default: return -1;
+	}
+
+	bool interpolated = table != &m_state;
+
+	std::vector<float> times = prop->GetKeyTimes();
+	std::vector<Property::Value> values = prop->GetKeyValues();
+
+	// a single key is held as a segment of length 0, so interpolating
+	// doesn't have to check for tracks without a next key
+	if (interpolated && times.size() == 1)
+	{
+		times.push_back(times[0]);
+		values.push_back(values[0]);
+	}
+
+	uint32_t track = (uint32_t)table->keyFirst.size();
+
+	table->keyFirst.push_back((uint32_t)table->times.size());
+	table->keysCount.push_back((uint32_t)times.size());
+	table->cursor.push_back(0);
+	table->segment.push_back(0);
+	table->weight.push_back(0.0f);
+	table->duration.push_back(0.0f);
+	table->times.insert(table->times.end(), times.begin(), times.end());
+
+	for (unsigned i = 0; i < prop->GetComponentsCount(); i++)
+	{
+		uint32_t valueFirst = (uint32_t)table->values.size();
+
+		table->channelTrack.push_back(track);
+		table->channelValueFirst.push_back(valueFirst);
+		table->channelOutput.push_back(m_channelsCount + i);
+
+		for (unsigned j = 0; j < values.size(); j++)
+			table->values.push_back(prop->GetComponent(values[j], i));
+
+		if (table != &m_tcb)
+			continue;
+
+		// the same Catmull-Rom tangents Property evaluates with
+		for (unsigned j = 0; j < values.size(); j++)
+		{
+			unsigned prev = j > 0 ? j - 1 : j;
+			unsigned next = j + 1 < values.size() ? j + 1 : j;
+
+			float keysDuration = times[next] - times[prev];
+			float tangent = 0.0f;
+
+			if (keysDuration > 0.0f)
+				tangent = (table->values[valueFirst + next] - table->values[valueFirst + prev]) / keysDuration;
+
+			table->tangents.push_back(tangent);
+		}
+	}
+
+	int firstChannel = (int)m_channelsCount;
+	m_channelsCount += prop->GetComponentsCount();
+
+	return firstChannel;
+}
+
+unsigned PropertyTable::GetChannelsCount() const
+{
+	return m_channelsCount;
+}
+
+void PropertyTable::Evaluate(float time, float *output)
+{
+	Locate(m_state, time, false);
+	Locate(m_linear, time, true);
+	Locate(m_tcb, time, true);
+
+	for (unsigned i = 0; i < m_state.channelTrack.size(); i++)
+	{
+		uint32_t track = m_state.channelTrack[i];
+
+		output[m_state.channelOutput[i]] = m_state.values[m_state.channelValueFirst[i] + m_state.segment[track]];
+	}
+
+	for (unsigned i = 0; i < m_linear.channelTrack.size(); i++)
+	{
+		uint32_t track = m_linear.channelTrack[i];
+		uint32_t key = m_linear.channelValueFirst[i] + m_linear.segment[track];
+
+		float a = m_linear.values[key];
+		float b = m_linear.values[key + 1];
+
+		output[m_linear.channelOutput[i]] = a + (b - a) * m_linear.weight[track];
+	}
+
+	for (unsigned i = 0; i < m_tcb.channelTrack.size(); i++)
+	{
+		uint32_t track = m_tcb.channelTrack[i];
+		uint32_t key = m_tcb.channelValueFirst[i] + m_tcb.segment[track];
+
+		float s = m_tcb.weight[track];
+		float s2 = s * s;
+		float s3 = s2 * s;
+
+		float tangentA = m_tcb.tangents[key] * m_tcb.duration[track];
+		float tangentB = m_tcb.tangents[key + 1] * m_tcb.duration[track];
+
+		output[m_tcb.channelOutput[i]] =
+			m_tcb.values[key] * (2.0f * s3 - 3.0f * s2 + 1.0f) +
+			tangentA * (s3 - 2.0f * s2 + s) +
+			m_tcb.values[key + 1] * (-2.0f * s3 + 3.0f * s2) +
+			tangentB * (s3 - s2);
+	}
+}
+
+void PropertyTable::Locate(Table &table, float time, bool interpolated)
+{
+	for (unsigned i = 0; i < table.keyFirst.size(); i++)
+	{
+		const float *keyTimes = &table.times[table.keyFirst[i]];
+		uint32_t keysCount = table.keysCount[i];
+		uint32_t key = table.cursor[i];
+
+		if (time < keyTimes[key])
+		{
+			// went back, search from the start
+			key = (uint32_t)(std::upper_bound(keyTimes, keyTimes + keysCount, time) - keyTimes);
+			key = key > 0 ? key - 1 : 0;
+		}
+		else
+		{
+			while (key + 1 < keysCount && keyTimes[key + 1] <= time)
+				key++;
+		}
+
+		table.cursor[i] = key;
+
+		if (!interpolated)
+		{
+			table.segment[i] = key;
+			continue;
+		}
+
+		// before the first and after the last key the value holds still
+		if (key + 1 == keysCount)
+		{
+			table.segment[i] = key - 1;
+			table.weight[i] = 1.0f;
+			table.duration[i] = keyTimes[key] - keyTimes[key - 1];
+		}
+		else
+		{
+			float duration = keyTimes[key + 1] - keyTimes[key];
+
+			table.segment[i] = key;
+			table.weight[i] = duration > 0.0f && time > keyTimes[key] ? (time - keyTimes[key]) / duration : 0.0f;
+			table.duration[i] = duration;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Property.h"
+
+#include <vector>
+#include <stdint.h>
+
+// Animated properties of a mesh or a whole scene compiled into one table
+// per interpolation type, for evaluating hundreds of them every frame.
+// Keys of all tracks sit in flat arrays, one float per component, so a
+// vector3 is three channels sharing their key times. Evaluate finds the key
+// of every track first and then interpolates all channels in one loop per
+// table, without a call or a binary search per property: tracks remember
+// the key they were at and, with time going forward, only step ahead.
+// Ints and booleans come out as floats, round them to get what Property
+// would give.
+class PropertyTable
+{
+public:
+	PropertyTable();
+
+	// Adds the property's keys, returns the output index of its first
+	// channel, or -1 when the property isn't animated or has no keys.
+	int Add(const Property *prop);
+
+	unsigned GetChannelsCount() const;
+
+	// writes GetChannelsCount() floats to output, times can go anywhere,
+	// only going forward is faster
+	void Evaluate(float time, float *output);
+
+private:
+	// tracks of one interpolation type
+	class Table
+	{
+	public:
+		// per track, keys are indices into times
+		std::vector<uint32_t> keyFirst;
+		std::vector<uint32_t> keysCount;
+
+		// last key at or before the time of the previous Evaluate
+		std::vector<uint32_t> cursor;
+
+		// per track, key the value is interpolated from, counted from
+		// the track's first one, how far towards the next one it is and
+		// the length of the segment in seconds
+		std::vector<uint32_t> segment;
+		std::vector<float> weight;
+		std::vector<float> duration;
+
+		std::vector<float> times;
+
+		// per channel
+		std::vector<uint32_t> channelTrack;
+		std::vector<uint32_t> channelValueFirst;
+		std::vector<uint32_t> channelOutput;
+
+		// per channel and key, keys of a channel one after another
+		std::vector<float> values;
+
+		// tcb only, slope at the key in value per second
+		std::vector<float> tangents;
+	};
+
+	Table m_state;
+	Table m_linear;
+	Table m_tcb;
+
+	unsigned m_channelsCount;
+
+	// finds segment, weight and duration of every track of the table
+	static void Locate(Table &table, float time, bool interpolated);
+};
@@ -1,5 +1,26 @@
 #include "sgmexporter.h"
 #include "scene3d/VertexChannel.h"
+#include "scene3d/MeshPartIndexer.h"
+#include "scene3d/MeshPartStats.h"
+#include "scene3d/WireEdges.h"
+#include "scene3d/SdfBaker.h"
+#include "scene3d/Bvh.h"
+#include "scene3d/FlatBvh.h"
+#include "scene3d/OccluderBaker.h"
+#include "scene3d/SurfaceSampler.h"
+#include "GeoAoBaker.h"
+#include "NormalMapBaker.h"
+#include "KeyReducer.h"
+#include "PropertySampler.h"
+#include "PropertyCurve.h"
+#include "Stopwatch.h"
+#include "XmlWriter.h"
+
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <stdio.h>
+#include <math.h>
 
 #include <Utils/StringUtils.h>
 #include <Utils/Log.h>
@@ -36,6 +57,49 @@ Property::PropertyType PropTypeConv(int propType)
 	return Property::PropertyType_Float;
 }
 
+namespace
+{
+	// tcb float or Point3 controller evaluated by 3ds Max, the curve its keys were authored on
+	class ControlCurve : public PropertyCurve
+	{
+	public:
+		ControlCurve(Control *control, Property::PropertyType propType) :
+			m_control(control),
+			m_propType(propType)
+		{
+		}
+
+		Property::Value Evaluate(float time) const
+		{
+			Property::Value value;
+			Interval valid = FOREVER;
+
+			if (m_propType == Property::PropertyType_Vector3)
+			{
+				Point3 point;
+				m_control->GetValue(SecToTicks(time), &point, valid);
+
+				value.vector3Value[0] = point.x;
+				value.vector3Value[1] = point.y;
+				value.vector3Value[2] = point.z;
+			}
+			else
+			{
+				float scalar;
+				m_control->GetValue(SecToTicks(time), &scalar, valid);
+
+				value.floatValue = scalar;
+			}
+
+			return value;
+		}
+
+	private:
+		Control *m_control;
+		Property::PropertyType m_propType;
+	};
+}
+
 //Property::PropertyType PropAnimTypeConv(int propType)
 //{
 //	switch (propType)
@@ -96,6 +160,9 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 
 		Property *prop = NULL; 
 
+		// tcb controller of an animated float or vector, the keys don't carry all of its curve
+		Control *tcbControl = NULL;
+
 		if (!gProp->IsPropAnimated())
 		{
 			Log::LogT("property %s has no animation", propName.c_str());
@@ -126,6 +193,22 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 					prop->SetValue(sm::Vec3(val.x, val.y, val.z));
 				}
 				break;
+
+			case IGAME_POINT4_PROP:
+				{
+					Point4 val;
+					gProp->GetPropertyValue(val);
+					prop->SetValue(sm::Vec3(val.x, val.y, val.z));
+				}
+				break;
+
+			case IGAME_STRING_PROP:
+				{
+					const MCHAR *val = NULL;
+					gProp->GetPropertyValue(val);
+					prop->SetValue(val != NULL ? val : L"");
+				}
+				break;
 			}
 		}
 		else
@@ -162,6 +245,7 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 						{
 							Log::LogT("%s float tcb scierwo", propName.c_str());
 							prop = new Property(propName, Property::PropertyType_Float, Property::AnimationType_TCB);
+							tcbControl = maxControl;
 							IGameKeyTab keys;
 							if (ctrl->GetTCBKeys(keys, IGAME_FLOAT))
 							{
@@ -208,7 +292,7 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 							{
 								for (int j = 0; j < keys.Count(); j++)
 								{
-									prop->SetValue((int)keys[j].linearKey.fval, TicksToSec(keys[j].t));
+									prop->SetValue((int)keys[j].tcbKey.fval, TicksToSec(keys[j].t));
 								}
 							}
 						}
@@ -218,6 +302,46 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 					}
 				}
 
+				break;
+
+			case IGAME_POINT3_PROP:
+				{
+					Control *maxControl = ctrl->GetMaxControl(IGAME_POINT3);
+					if (maxControl != NULL && maxControl->IsAnimated())
+					{
+						if (maxControl->ClassID() == Class_ID(LININTERP_POSITION_CLASS_ID, 0))
+						{
+							prop = new Property(propName, Property::PropertyType_Vector3, Property::AnimationType_Linear);
+							IGameKeyTab keys;
+							if (ctrl->GetLinearKeys(keys, IGAME_POINT3))
+							{
+								for (int j = 0; j < keys.Count(); j++)
+								{
+									Point3 val = keys[j].linearKey.pval;
+									prop->SetValue(sm::Vec3(val.x, val.y, val.z), TicksToSec(keys[j].t));
+								}
+							}
+						}
+						if (maxControl->ClassID() == Class_ID(TCBINTERP_POINT3_CLASS_ID, 0))
+						{
+							prop = new Property(propName, Property::PropertyType_Vector3, Property::AnimationType_TCB);
+							tcbControl = maxControl;
+							IGameKeyTab keys;
+							if (ctrl->GetTCBKeys(keys, IGAME_POINT3))
+							{
+								for (int j = 0; j < keys.Count(); j++)
+								{
+									Point3 val = keys[j].tcbKey.pval;
+									prop->SetValue(sm::Vec3(val.x, val.y, val.z), TicksToSec(keys[j].t));
+								}
+							}
+						}
+					}
+
+					if (prop == NULL)
+						Log::LogT("warning: property %s is animated by a controller that isn't linear or tcb, skipping it", propName.c_str());
+				}
+
 				break;
 			}
 
@@ -268,6 +392,45 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 			}*/
 		}
 
+		if (prop != NULL && prop->IsAnimatable() && settings.PropertySampleRate > 0.0f)
+		{
+			Property *sampled = NULL;
+
+			if (tcbControl != NULL)
+			{
+				ControlCurve curve(tcbControl, prop->GetPropertyType());
+				sampled = PropertySampler::Resample(prop, settings.PropertySampleRate, &curve);
+			}
+			else
+				sampled = PropertySampler::Resample(prop, settings.PropertySampleRate, NULL);
+			if (sampled != NULL)
+			{
+				Log::LogT("property %s: %d keys resampled to %d", propName.c_str(), prop->GetKeysCount(), sampled->GetKeysCount());
+
+				delete prop;
+				prop = sampled;
+			}
+		}
+
+		// sampled properties aren't reduced, they're looked up by index
+		if (prop != NULL && prop->IsAnimatable() && settings.PropertyKeyTolerance > 0.0f)
+		{
+			unsigned keysCount = prop->GetKeysCount();
+			unsigned removed = 0;
+
+			// a sampled property isn't tcb any more, its controller doesn't matter
+			if (tcbControl != NULL && prop->GetAnimationType() == Property::AnimationType_TCB)
+			{
+				ControlCurve curve(tcbControl, prop->GetPropertyType());
+				removed = KeyReducer::Reduce(prop, settings.PropertyKeyTolerance, &curve);
+			}
+			else
+				removed = KeyReducer::Reduce(prop, settings.PropertyKeyTolerance, NULL);
+
+			if (removed > 0)
+				Log::LogT("property %s: %d of %d keys removed", propName.c_str(), removed, keysCount);
+		}
+
 		if (prop != NULL)
 			mesh->properties.push_back(prop);
 
@@ -311,10 +474,26 @@ Scene3DMesh* SGMExporter::ConvertMesh(IGameNode* meshNode)
 	mesh->id = meshNode->GetNodeID();
 	mesh->name = StringUtils::ToNarrow(meshNode->GetName());
 
+	Stopwatch propertiesTime;
 	CollectProperties(mesh, gMesh);
+	report.AddTime(ExportReport::Stage_Properties, propertiesTime.GetSeconds());
 
 	IGameMaterial *mat = meshNode ->GetNodeMaterial();
 
+	bool outOfCore =
+		settings.OutOfCoreFaceThreshold > 0 &&
+		gMesh->GetNumberOfFaces() >= settings.OutOfCoreFaceThreshold;
+	bool outOfCoreFailed = false;
+
+	if (outOfCore)
+		Log::LogT("node %s has %d faces, converting out of core", meshNodeName.c_str(), gMesh->GetNumberOfFaces());
+
+	bool mirrored = IsMirrored(gMesh);
+
+	// read before the mesh object is released
+	bool occluder = IsOccluder(gMesh) && IsStatic(meshNode);
+	float sampleDensity = GetSampleDensity(gMesh);
+
 	std::string matName;
 	if (mat != NULL)
 		matName = StringUtils::ToNarrow(mat ->GetMaterialName());
@@ -323,6 +502,7 @@ Scene3DMesh* SGMExporter::ConvertMesh(IGameNode* meshNode)
 	{
 		Scene3DMeshPart *meshPart = new Scene3DMeshPart();
 		meshPart->m_vertexType = vertexType;
+		meshPart->useWire = UsesWire(mat);
 		mesh ->meshParts.push_back(meshPart);
 		if (mat != NULL)
 		{
@@ -332,8 +512,16 @@ Scene3DMesh* SGMExporter::ConvertMesh(IGameNode* meshNode)
 		else
 			Log::LogT("no material found for %s", meshNodeName.c_str());
 
-		for (int i = 0; i < gMesh ->GetNumberOfFaces(); i++)
-			ExtractVertices(gMesh ->GetFace(i), gMesh, meshPart ->vertices, vertexType);
+		if (outOfCore)
+		{
+			if (!ExtractPartOutOfCore(meshPart, gMesh, mirrored, NULL))
+				outOfCoreFailed = true;
+		}
+		else
+		{
+			for (int i = 0; i < gMesh ->GetNumberOfFaces(); i++)
+				ExtractVertices(gMesh ->GetFace(i), gMesh, mirrored, meshPart ->vertices, vertexType);
+		}
 	}
 	else
 	{
@@ -352,223 +540,1109 @@ Scene3DMesh* SGMExporter::ConvertMesh(IGameNode* meshNode)
 			if (subMat != NULL)
 				meshPart ->materialName = StringUtils::ToNarrow(subMat ->GetMaterialName());
 
+			meshPart->useWire = UsesWire(subMat);
+
 			Tab<FaceEx*> gFaces = gMesh ->GetFacesFromMatID(matIds[i]);
 			//log ->AddLog(sb() + "for matid " + matIds[i] + " found " + gFaces.Count() + " faces");
 			
+			if (outOfCore)
+			{
+				if (!ExtractPartOutOfCore(meshPart, gMesh, mirrored, &gFaces))
+					outOfCoreFailed = true;
+
+				continue;
+			}
+
 			for (int j = 0; j < gFaces.Count(); j++)
 			{
-				ExtractVertices(gFaces[j], gMesh, meshPart ->vertices, vertexType);
+				ExtractVertices(gFaces[j], gMesh, mirrored, meshPart ->vertices, vertexType);
 			}
 		}
 	}
 
 	meshNode ->ReleaseIGameObject();
 
-	return mesh;
-}
+	if (outOfCoreFailed)
+	{
+		Log::LogT("error: out of core conversion of '%s' failed, skipping node", meshNodeName.c_str());
+		delete mesh;
+		return NULL;
+	}
 
-void SGMExporter::ExtractVertices(FaceEx *gFace, IGameMesh *gMesh, std::vector<Scene3DVertex*> &vertices, uint8_t vertexType)
-{
-	GMatrix objectTM = gMesh ->GetIGameObjectTM();
-	/*log ->AddLog(sb() + "[" + objectTM.GetRow(0).x + "] [" + objectTM.GetRow(0).y + "] [" + objectTM.GetRow(0).z + "] [" + objectTM.GetRow(0).w + "]");
-	log ->AddLog(sb() + "[" + objectTM.GetRow(1).x + "] [" + objectTM.GetRow(1).y + "] [" + objectTM.GetRow(1).z + "] [" + objectTM.GetRow(1).w + "]");
-	log ->AddLog(sb() + "[" + objectTM.GetRow(2).x + "] [" + objectTM.GetRow(2).y + "] [" + objectTM.GetRow(2).z + "] [" + objectTM.GetRow(2).w + "]");
-	log ->AddLog(sb() + "[" + objectTM.GetRow(3).x + "] [" + objectTM.GetRow(3).y + "] [" + objectTM.GetRow(3).z + "] [" + objectTM.GetRow(3).w + "]");*/
+	if (!IndexMeshParts(mesh))
+	{
+		delete mesh;
+		return NULL;
+	}
 
-	int faceIndex = gFace ->meshFaceIndex;
+	// reorders vertices, so it goes before anything refers to them
+	if (settings.ProgressiveParts)
+		BuildProgressiveParts(mesh);
 
-	for (int i = 0; i < 3; i++)
-	{
-		Scene3DVertex *vert = new Scene3DVertex();
+	if (settings.WireEdges)
+		BuildWireChunk(mesh);
 
-		vert ->position.Set(
-			gMesh ->GetVertex(gFace ->vert[i]).x,
-			gMesh ->GetVertex(gFace ->vert[i]).y,
-			gMesh ->GetVertex(gFace ->vert[i]).z);
+	BuildTangentSignChunk(mesh);
 
-		if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords1))
-		{
-			Point3 uv = gMesh->GetMapVertex(1, gMesh->GetFaceTextureVertex(gFace->meshFaceIndex, i, 1)); 
+	if (settings.SdfBake && IsStatic(meshNode))
+		BakeSdfChunk(mesh);
 
-			vert ->coords1.Set(uv.x, uv.y);
-		}
+	if (settings.BvhMode == "mesh" && IsStatic(meshNode))
+		BuildBvhChunk(mesh);
 
-		if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords2))
-		{
-			Point3 uv = gMesh->GetMapVertex(2, gMesh->GetFaceTextureVertex(gFace->meshFaceIndex, i, 2)); 
+	if (occluder)
+		BuildOccluderChunk(mesh);
 
-			vert ->coords2.Set(uv.x, uv.y);
-		}
+	if (sampleDensity > 0.0f)
+		BuildSamplesChunk(mesh, sampleDensity);
+
+	return mesh;
+}
 
-		Point3 normal = gMesh->GetNormal(faceIndex, i);
+void SGMExporter::BakeSdfChunk(Scene3DMesh *mesh)
+{
+	// positions are in world space already
+	std::vector<sm::Vec3> vertices;
 
-		Point3 a(objectTM.GetRow(0).x, objectTM.GetRow(0).y, objectTM.GetRow(0).z);
-		Point3 b(objectTM.GetRow(1).x, objectTM.GetRow(1).y, objectTM.GetRow(1).z);
-		Point3 c(objectTM.GetRow(2).x, objectTM.GetRow(2).y, objectTM.GetRow(2).z);
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
+	{
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
 
-		Point3 p1 = CrossProd(a, b);
-		if (DotProd(p1, c) < 0)
-			normal = -normal;
+		if (meshPart->outOfCore != NULL)
+		{
+			Log::LogT("warning: mesh '%s' was converted out of core, no distance field", mesh->name.c_str());
+			return;
+		}
 
-		vert ->normal.Set(
-			normal.x,
-			normal.y,
-			normal.z);
+		for (unsigned j = 0; j < meshPart->indices.size(); j++)
+			vertices.push_back(meshPart->vertices[meshPart->indices[j]]->position);
+	}
 
-		int tangentIndex = gMesh ->GetFaceVertexTangentBinormal(gFace ->meshFaceIndex, i);
-		vert ->tangent.Set(
-			gMesh ->GetTangent(tangentIndex).x,
-			gMesh ->GetTangent(tangentIndex).y,
-			gMesh ->GetTangent(tangentIndex).z);
+	Stopwatch bakeTime;
 
-		vertices.push_back(vert);
+	SdfVolume volume;
+	if (!SdfBaker::Bake(vertices, settings.SdfResolution, settings.SdfRange, volume))
+	{
+		Log::LogT("warning: mesh '%s' is flat or empty, no distance field", mesh->name.c_str());
+		return;
 	}
+
+	Log::LogT("distance field of '%s': %dx%dx%d voxels of %f, baked in %f s",
+		mesh->name.c_str(), volume.sizeX, volume.sizeY, volume.sizeZ, volume.voxelSize, bakeTime.GetSeconds());
+
+	std::stringstream data;
+	BinaryWriter bw(&data);
+
+	bw.Write(volume.sizeX);
+	bw.Write(volume.sizeY);
+	bw.Write(volume.sizeZ);
+	bw.Write(volume.origin.x);
+	bw.Write(volume.origin.y);
+	bw.Write(volume.origin.z);
+	bw.Write(volume.voxelSize);
+	bw.Write(volume.maxDistance);
+	bw.Write((const char*)&volume.values[0], (uint32_t)volume.values.size());
+
+	Scene3DMeshChunk *chunk = new Scene3DMeshChunk("SDF ");
+	chunk->data = data.str();
+	mesh->chunks.push_back(chunk);
 }
 
-uint8_t SGMExporter::GetVertexType(IGameMaterial *material, IGameMesh *gMesh)
+void SGMExporter::BuildBvhChunk(Scene3DMesh *mesh)
 {
-	bool diff = false;
-	bool norm = false;
-	bool light = gMesh->GetNumberOfMapVerts(2) > 0;
+	// triangles are numbered through all parts, in the order of their indices
+	std::vector<sm::Vec3> vertices;
 
-	if (material != NULL)
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
 	{
-		for (int32_t i = 0; i < material->GetNumberOfTextureMaps(); i++)
-		{
-			IGameTextureMap *tex = material->GetIGameTextureMap(i);
-			if (tex == NULL)
-				continue;
-
-			int texSlot = tex->GetStdMapSlot();
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
 
-			switch (texSlot)
-			{
-			case ID_DI: diff = true; break;
-			case ID_BU: norm = true; break;
-			case ID_SI: light = true; break;
-			}
+		if (meshPart->outOfCore != NULL)
+		{
+			Log::LogT("warning: mesh '%s' was converted out of core, no bvh", mesh->name.c_str());
+			return;
 		}
+
+		for (unsigned j = 0; j < meshPart->indices.size(); j++)
+			vertices.push_back(meshPart->vertices[meshPart->indices[j]]->position);
 	}
 
-	if (!diff && !norm && !light)
-		return VertexType::PN;
-	else if (diff && !norm && !light)
-		return VertexType::PCN;
-	else if (diff && norm && !light)
-		return VertexType::PCNT;
-	else if (diff && !norm && light)
-		return VertexType::PC2N;
-	else if (diff && norm && light)
-		return VertexType::PC2NT;
+	if (vertices.size() == 0)
+		return;
 
-	return VertexType::PN;
+	Bvh bvh;
+	bvh.Build(vertices);
+
+	FlatBvh flatBvh;
+	flatBvh.Build(bvh);
+
+	std::stringstream data;
+	BinaryWriter bw(&data);
+	flatBvh.Save(bw);
+
+	Scene3DMeshChunk *chunk = new Scene3DMeshChunk("BVH ");
+	chunk->data = data.str();
+	mesh->chunks.push_back(chunk);
 }
 
-bool SGMExporter::GetMeshes(std::vector<Scene3DMesh*> &meshes, BinaryWriter *bw)
+bool SGMExporter::UsesWire(IGameMaterial *material)
 {
-	scene = GetIGameInterface();
-	assert(scene != NULL);
+	// same default as the scene materials
+	if (material == NULL)
+		return true;
 
-	scene ->SetStaticFrame(0);
+	IPropertyContainer* propertyContainer = material->GetIPropertyContainer();
+	if (propertyContainer == NULL)
+		return true;
 
-	IGameConversionManager *cm = GetConversionManager();
-	assert(cm != NULL);
+	int iValue;
+	IGameProperty* prop = propertyContainer->QueryProperty(L"use_wire");
+	if (prop != NULL && prop->GetPropertyValue(iValue))
+		return iValue != 0;
 
-	cm ->SetCoordSystem(IGameConversionManager::IGAME_OGL);
+	return true;
+}
 
-	if (!scene ->InitialiseIGame(false))
-	{
-		Log::LogT("error: couldnt initialize scene");
+bool SGMExporter::IsOccluder(IGameMesh *gMesh)
+{
+	IPropertyContainer* propertyContainer = gMesh->GetIPropertyContainer();
+	if (propertyContainer == NULL)
 		return false;
-	}
 
-	// get only mesh nodes
-	std::vector<IGameNode*> meshNodes;
-	for (int i = 0; i < scene ->GetTopLevelNodeCount(); i++)
-		FilterMeshNodes(scene ->GetTopLevelNode(i), meshNodes);
+	int iValue;
+	IGameProperty* prop = propertyContainer->QueryProperty(L"occluder");
+	if (prop != NULL && prop->GetPropertyValue(iValue))
+		return iValue != 0;
 
-	SetProgressSteps((int)meshNodes.size());
+	return false;
+}
 
-	for (int i = 0; i < (int)meshNodes.size(); i++)
+void SGMExporter::BuildOccluderChunk(Scene3DMesh *mesh)
+{
+	std::vector<sm::Vec3> vertices;
+
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
 	{
-		Scene3DMesh *mesh = ConvertMesh(meshNodes[i]);
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
 
-		if (mesh != NULL)
+		if (meshPart->outOfCore != NULL)
 		{
-			GMatrix m = meshNodes[i]->GetWorldTM().Inverse();
+			Log::LogT("warning: mesh '%s' was converted out of core, no occluder", mesh->name.c_str());
+			return;
+		}
 
-			mesh->m_worldInverseMatrix.a[0] = m.GetRow(0).x;
-			mesh->m_worldInverseMatrix.a[1] = m.GetRow(0).y;
-			mesh->m_worldInverseMatrix.a[2] = m.GetRow(0).z;
-			mesh->m_worldInverseMatrix.a[3] = m.GetRow(0).w;
+		for (unsigned j = 0; j < meshPart->indices.size(); j++)
+			vertices.push_back(meshPart->vertices[meshPart->indices[j]]->position);
+	}
 
-			mesh->m_worldInverseMatrix.a[4] = m.GetRow(1).x;
-			mesh->m_worldInverseMatrix.a[5] = m.GetRow(1).y;
-			mesh->m_worldInverseMatrix.a[6] = m.GetRow(1).z;
-			mesh->m_worldInverseMatrix.a[7] = m.GetRow(1).w;
+	std::vector<OccluderBaker::Box> boxes;
+	OccluderBaker::Bake(vertices, settings.OccluderResolution, settings.OccluderMaxBoxes, boxes);
 
-			mesh->m_worldInverseMatrix.a[8] = m.GetRow(2).x;
-			mesh->m_worldInverseMatrix.a[9] = m.GetRow(2).y;
-			mesh->m_worldInverseMatrix.a[10] = m.GetRow(2).z;
-			mesh->m_worldInverseMatrix.a[11] = m.GetRow(2).w;
+	if (boxes.size() == 0)
+	{
+		Log::LogT("warning: mesh '%s' is too thin or not closed, no occluder", mesh->name.c_str());
+		return;
+	}
 
-			mesh->m_worldInverseMatrix.a[12] = m.GetRow(3).x;
-			mesh->m_worldInverseMatrix.a[13] = m.GetRow(3).y;
-			mesh->m_worldInverseMatrix.a[14] = m.GetRow(3).z;
-			mesh->m_worldInverseMatrix.a[15] = m.GetRow(3).w;
+	std::vector<sm::Vec3> positions;
+	std::vector<uint32_t> indices;
+	OccluderBaker::BuildMesh(boxes, positions, indices);
 
-			meshesCount++;
-			GeoSaver::SaveMesh(mesh, *bw);
-			delete mesh;
-		}
-			//meshes.push_back(mesh);
+	Log::LogT("occluder of '%s': %d boxes", mesh->name.c_str(), (int)boxes.size());
 
-		StepProgress();
+	std::stringstream data;
+	BinaryWriter bw(&data);
+
+	bw.Write((int)positions.size());
+	for (unsigned i = 0; i < positions.size(); i++)
+	{
+		bw.Write(positions[i].x);
+		bw.Write(positions[i].y);
+		bw.Write(positions[i].z);
 	}
 
-	scene ->ReleaseIGame();
+	uint8_t indexSize = positions.size() <= MeshPartIndexer::MaxVertices16Bit ? 2 : 4;
 
-	return true;
+	bw.Write(indexSize);
+	bw.Write((int)indices.size());
+
+	for (unsigned i = 0; i < indices.size(); i++)
+	{
+		if (indexSize == 2)
+			bw.Write((uint16_t)indices[i]);
+		else
+			bw.Write(indices[i]);
+	}
+
+	Scene3DMeshChunk *chunk = new Scene3DMeshChunk("OCCL");
+	chunk->data = data.str();
+	mesh->chunks.push_back(chunk);
 }
 
-class AnimationRange
+float SGMExporter::GetSampleDensity(IGameMesh *gMesh)
 {
-public:
-	int startFrame;
-	int endFrame;
-	int fps;
-	bool loop;
-	const char *name;
+	IPropertyContainer* propertyContainer = gMesh->GetIPropertyContainer();
+	if (propertyContainer == NULL)
+		return settings.SampleDensity;
 
-	AnimationRange(int startFrame, int endFrame, int fps, const char *name, bool loop) :
-		name(name)
-	{
-		this ->startFrame = startFrame;
-		this ->endFrame = endFrame;
-		this ->fps = fps;
-		this ->loop = loop;
-	}
-};
+	float fValue;
+	IGameProperty* prop = propertyContainer->QueryProperty(L"sample_density");
+	if (prop != NULL && prop->GetPropertyValue(fValue))
+		return fValue;
 
-bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_interface)
+	return settings.SampleDensity;
+}
+
+void SGMExporter::BuildSamplesChunk(Scene3DMesh *mesh, float density)
 {
-	fileName = StringUtils::ToNarrow(name);
+	// triangles are numbered through all parts, in the order of their indices
+	std::vector<sm::Vec3> vertices;
+	float area = 0.0f;
 
-	Log::StartLog(true, false, false);
-	Log::LogT("=== exporting geometry to file '%s'", fileName.c_str());
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
+	{
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
 
-	/*std::vector<AnimationRange*> animRanges;
+		if (meshPart->outOfCore != NULL)
+		{
+			Log::LogT("warning: mesh '%s' was converted out of core, no surface samples", mesh->name.c_str());
+			return;
+		}
 
-	animRanges.push_back(new AnimationRange(1, 30, 30, "walk", true));
-	animRanges.push_back(new AnimationRange(33, 62, 30, "run", true));
-	animRanges.push_back(new AnimationRange(65, 84, 30, "attack01", false));
-	animRanges.push_back(new AnimationRange(87, 107, 30, "attack02", false));
-	animRanges.push_back(new AnimationRange(109, 139, 30, "stand", true));
-	animRanges.push_back(new AnimationRange(141, 170, 30, "attack03", false));
-	animRanges.push_back(new AnimationRange(173, 192, 30, "attack04", false));
-	animRanges.push_back(new AnimationRange(195, 214, 30, "attack05", false));
-	animRanges.push_back(new AnimationRange(260, 300, 30, "die01", false));
-	animRanges.push_back(new AnimationRange(302, 343, 30, "die02", false));*/
+		for (unsigned j = 0; j + 2 < meshPart->indices.size(); j += 3)
+		{
+			const sm::Vec3 &a = meshPart->vertices[meshPart->indices[j + 0]]->position;
+			const sm::Vec3 &b = meshPart->vertices[meshPart->indices[j + 1]]->position;
+			const sm::Vec3 &c = meshPart->vertices[meshPart->indices[j + 2]]->position;
+
+			sm::Vec3 ab = b - a;
+			sm::Vec3 ac = c - a;
+			sm::Vec3 cross(
+				ab.y * ac.z - ab.z * ac.y,
+				ab.z * ac.x - ab.x * ac.z,
+				ab.x * ac.y - ab.y * ac.x);
+
+			area += sqrtf(sm::Vec3::Dot(cross, cross)) * 0.5f;
+
+			vertices.push_back(a);
+			vertices.push_back(b);
+			vertices.push_back(c);
+		}
+	}
+
+	if (area * density > settings.SampleMaxCount)
+	{
+		float maxDensity = settings.SampleMaxCount / area;
+		Log::LogT("warning: mesh '%s' would get %d surface samples, density lowered from %f to %f",
+			mesh->name.c_str(), (int)(area * density), density, maxDensity);
+		density = maxDensity;
+	}
+
+	std::vector<SurfaceSampler::Sample> samples;
+	float radius = SurfaceSampler::Generate(vertices, density, (uint32_t)settings.SampleSeed ^ (uint32_t)mesh->id, samples);
+
+	if (samples.size() == 0)
+		return;
+
+	Log::LogT("surface samples of '%s': %d, %f apart", mesh->name.c_str(), (int)samples.size(), radius);
+
+	std::stringstream data;
+	BinaryWriter bw(&data);
+
+	bw.Write(radius);
+	bw.Write((int)samples.size());
+
+	for (unsigned i = 0; i < samples.size(); i++)
+	{
+		bw.Write(samples[i].position.x);
+		bw.Write(samples[i].position.y);
+		bw.Write(samples[i].position.z);
+		bw.Write(samples[i].normal.x);
+		bw.Write(samples[i].normal.y);
+		bw.Write(samples[i].normal.z);
+		bw.Write(samples[i].triangle);
+	}
+
+	Scene3DMeshChunk *chunk = new Scene3DMeshChunk("SMPL");
+	chunk->data = data.str();
+	mesh->chunks.push_back(chunk);
+}
+
+// Tangent space handedness of every vertex. Parts without tangents, and
+// parts converted out of core, which keep no per vertex data but the
+// attributes, have 0 vertices in it.
+void SGMExporter::BuildTangentSignChunk(Scene3DMesh *mesh)
+{
+	std::stringstream data;
+	BinaryWriter bw(&data);
+
+	bw.Write((int)mesh->meshParts.size());
+
+	int signsCount = 0;
+
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
+	{
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
+
+		if (meshPart->outOfCore != NULL || !VertexInformation::HasAttrib(meshPart->m_vertexType, VertexAttrib::Tangent))
+		{
+			bw.Write((int)0);
+			continue;
+		}
+
+		bw.Write((int)meshPart->vertices.size());
+
+		for (unsigned j = 0; j < meshPart->vertices.size(); j++)
+			bw.Write((int8_t)(meshPart->vertices[j]->tangentSign < 0.0f ? -1 : 1));
+
+		signsCount += (int)meshPart->vertices.size();
+	}
+
+	if (signsCount == 0)
+		return;
+
+	Scene3DMeshChunk *chunk = new Scene3DMeshChunk("TSGN");
+	chunk->data = data.str();
+	mesh->chunks.push_back(chunk);
+}
+
+void SGMExporter::BuildWireChunk(Scene3DMesh *mesh)
+{
+	std::stringstream data;
+	BinaryWriter bw(&data);
+
+	// one entry per mesh part, in the part order, empty for parts without wire
+	bw.Write((int)mesh->meshParts.size());
+
+	int linesCount = 0;
+
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
+	{
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
+
+		std::vector<uint32_t> lines;
+
+		if (meshPart->useWire && meshPart->outOfCore != NULL)
+		{
+			Log::LogT("warning: part '%s' of mesh '%s' was converted out of core, it gets no wire edges",
+				meshPart->materialName.c_str(), mesh->name.c_str());
+		}
+		else if (meshPart->useWire)
+			WireEdges::Build(meshPart, settings.WireFeatureAngle, lines);
+
+		uint8_t indexSize = meshPart->outOfCore == NULL ?
+			MeshPartIndexer::GetIndexSize(meshPart) :
+			meshPart->outOfCore->GetIndexSize();
+
+		bw.Write(indexSize);
+		bw.Write((int)lines.size());
+
+		if (indexSize == 2)
+		{
+			for (unsigned j = 0; j < lines.size(); j++)
+				bw.Write((uint16_t)lines[j]);
+		}
+		else
+		{
+			for (unsigned j = 0; j < lines.size(); j++)
+				bw.Write((uint32_t)lines[j]);
+		}
+
+		linesCount += (int)lines.size() / 2;
+	}
+
+	if (linesCount == 0)
+		return;
+
+	Scene3DMeshChunk *chunk = new Scene3DMeshChunk("WIRE");
+	chunk->data = data.str();
+	mesh->chunks.push_back(chunk);
+}
+
+bool SGMExporter::IndexMeshParts(Scene3DMesh *mesh)
+{
+	std::vector<Scene3DMeshPart*> meshParts;
+
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
+	{
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
+
+		if (meshPart->outOfCore != NULL)
+		{
+			// the welded vertices are only in temporary files, there is nothing to split
+			if (settings.MaxIndexBits == 16 && meshPart->outOfCore->GetVerticesCount() > MeshPartIndexer::MaxVertices16Bit)
+			{
+				Log::LogT("error: out of core part '%s' of mesh '%s' has %d vertices, more than 16-bit indices reach, "
+					"raise OutOfCoreFaceThreshold to convert and split it in memory, skipping node",
+					meshPart->materialName.c_str(), mesh->name.c_str(), meshPart->outOfCore->GetVerticesCount());
+
+				// the mesh gets every part back, so deleting it deletes each one once
+				meshParts.insert(meshParts.end(), mesh->meshParts.begin() + i, mesh->meshParts.end());
+				mesh->meshParts.swap(meshParts);
+
+				return false;
+			}
+
+			meshParts.push_back(meshPart);
+			continue;
+		}
+
+		MeshPartIndexer::Weld(meshPart);
+
+		if (settings.MaxIndexBits == 16 && meshPart->vertices.size() > MeshPartIndexer::MaxVertices16Bit)
+		{
+			Log::LogT("part '%s' of mesh '%s' has %d vertices, splitting for 16-bit indices",
+				meshPart->materialName.c_str(), mesh->name.c_str(), (int)meshPart->vertices.size());
+
+			MeshPartIndexer::Split(meshPart, MeshPartIndexer::MaxVertices16Bit, meshParts);
+			delete meshPart;
+		}
+		else
+			meshParts.push_back(meshPart);
+	}
+
+	mesh->meshParts.swap(meshParts);
+
+	return true;
+}
+
+void SGMExporter::BuildProgressiveParts(Scene3DMesh *mesh)
+{
+	for (unsigned i = 0; i < mesh->meshParts.size(); i++)
+	{
+		Scene3DMeshPart *meshPart = mesh->meshParts[i];
+
+		if (meshPart->outOfCore != NULL)
+		{
+			Log::LogT("warning: part '%s' of mesh '%s' was converted out of core, it stays indexed",
+				meshPart->materialName.c_str(), mesh->name.c_str());
+			continue;
+		}
+
+		int trianglesCount = (int)meshPart->indices.size() / 3;
+		if (trianglesCount < settings.ProgressiveMinTriangles)
+			continue;
+
+		meshPart->progressive = ProgressiveMesh::Build(meshPart, settings.ProgressiveBaseRatio);
+
+		if (meshPart->progressive == NULL)
+		{
+			Log::LogT("part '%s' of mesh '%s' can't be coarsened, it stays indexed",
+				meshPart->materialName.c_str(), mesh->name.c_str());
+			continue;
+		}
+
+		Log::LogT("part '%s' of mesh '%s' is progressive: %d of %d triangles in the base mesh, %d vertex splits",
+			meshPart->materialName.c_str(), mesh->name.c_str(),
+			(int)meshPart->progressive->baseIndices.size() / 3, trianglesCount, (int)meshPart->progressive->splits.size());
+	}
+}
+
+// A mirrored object has its normals the other way
+bool SGMExporter::IsMirrored(IGameMesh *gMesh)
+{
+	GMatrix objectTM = gMesh ->GetIGameObjectTM();
+
+	Point3 a(objectTM.GetRow(0).x, objectTM.GetRow(0).y, objectTM.GetRow(0).z);
+	Point3 b(objectTM.GetRow(1).x, objectTM.GetRow(1).y, objectTM.GetRow(1).z);
+	Point3 c(objectTM.GetRow(2).x, objectTM.GetRow(2).y, objectTM.GetRow(2).z);
+
+	return DotProd(CrossProd(a, b), c) < 0;
+}
+
+void SGMExporter::ExtractVertices(FaceEx *gFace, IGameMesh *gMesh, bool mirrored, std::vector<Scene3DVertex*> &vertices, uint8_t vertexType)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		Scene3DVertex *vert = new Scene3DVertex();
+		ExtractVertex(gFace, gMesh, mirrored, i, vertexType, *vert);
+		vertices.push_back(vert);
+	}
+}
+
+void SGMExporter::ExtractVertex(FaceEx *gFace, IGameMesh *gMesh, bool mirrored, int corner, uint8_t vertexType, Scene3DVertex &vert)
+{
+	int faceIndex = gFace ->meshFaceIndex;
+
+	vert.position.Set(
+		gMesh ->GetVertex(gFace ->vert[corner]).x,
+		gMesh ->GetVertex(gFace ->vert[corner]).y,
+		gMesh ->GetVertex(gFace ->vert[corner]).z);
+
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords1))
+	{
+		Point3 uv = gMesh->GetMapVertex(1, gMesh->GetFaceTextureVertex(gFace->meshFaceIndex, corner, 1)); 
+
+		vert.coords1.Set(uv.x, uv.y);
+	}
+
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords2))
+	{
+		Point3 uv = gMesh->GetMapVertex(2, gMesh->GetFaceTextureVertex(gFace->meshFaceIndex, corner, 2)); 
+
+		vert.coords2.Set(uv.x, uv.y);
+	}
+
+	Point3 normal = gMesh->GetNormal(faceIndex, corner);
+	if (mirrored)
+		normal = -normal;
+
+	vert.normal.Set(
+		normal.x,
+		normal.y,
+		normal.z);
+
+	int tangentIndex = gMesh ->GetFaceVertexTangentBinormal(gFace ->meshFaceIndex, corner);
+	Point3 tangent = gMesh ->GetTangent(tangentIndex);
+
+	vert.tangent.Set(
+		tangent.x,
+		tangent.y,
+		tangent.z);
+
+	vert.tangentSign = DotProd(CrossProd(normal, tangent), gMesh ->GetBinormal(tangentIndex)) < 0 ? -1.0f : 1.0f;
+}
+
+bool SGMExporter::ExtractPartOutOfCore(Scene3DMeshPart *meshPart, IGameMesh *gMesh, bool mirrored, Tab<FaceEx*> *gFaces)
+{
+	int facesCount = gFaces != NULL ? gFaces->Count() : gMesh->GetNumberOfFaces();
+
+	Log::LogT("extracting %d faces out of core", facesCount);
+
+	meshPart->outOfCore = new OutOfCorePart(
+		meshPart->m_vertexType,
+		facesCount * 3,
+		(unsigned)((uint64_t)settings.OutOfCoreMemoryMB * 1024 * 1024),
+		settings.TempDir);
+
+	if (!meshPart->outOfCore->Begin())
+		return false;
+
+	unsigned windowCorners = settings.OutOfCoreWindowFaces * 3;
+
+	std::vector<Scene3DVertex> window;
+	window.reserve(windowCorners);
+
+	for (int i = 0; i < facesCount; i++)
+	{
+		FaceEx *gFace = gFaces != NULL ? (*gFaces)[i] : gMesh->GetFace(i);
+
+		for (int j = 0; j < 3; j++)
+		{
+			window.push_back(Scene3DVertex());
+			ExtractVertex(gFace, gMesh, mirrored, j, meshPart->m_vertexType, window.back());
+		}
+
+		if (window.size() >= windowCorners)
+		{
+			meshPart->outOfCore->AddCorners(window);
+			window.clear();
+		}
+	}
+
+	meshPart->outOfCore->AddCorners(window);
+
+	return meshPart->outOfCore->Finish();
+}
+
+uint8_t SGMExporter::GetVertexType(IGameMaterial *material, IGameMesh *gMesh)
+{
+	bool diff = false;
+	bool norm = false;
+	bool light = gMesh->GetNumberOfMapVerts(2) > 0;
+
+	if (material != NULL)
+	{
+		for (int32_t i = 0; i < material->GetNumberOfTextureMaps(); i++)
+		{
+			IGameTextureMap *tex = material->GetIGameTextureMap(i);
+			if (tex == NULL)
+				continue;
+
+			int texSlot = tex->GetStdMapSlot();
+
+			switch (texSlot)
+			{
+			case ID_DI: diff = true; break;
+			case ID_BU: norm = true; break;
+			case ID_SI: light = true; break;
+			}
+		}
+	}
+
+	if (!diff && !norm && !light)
+		return VertexType::PN;
+	else if (diff && !norm && !light)
+		return VertexType::PCN;
+	else if (diff && norm && !light)
+		return VertexType::PCNT;
+	else if (diff && !norm && light)
+		return VertexType::PC2N;
+	else if (diff && norm && light)
+		return VertexType::PC2NT;
+
+	return VertexType::PN;
+}
+
+bool SGMExporter::InitializeScene()
+{
+	scene = GetIGameInterface();
+	assert(scene != NULL);
+
+	scene ->SetStaticFrame(0);
+
+	IGameConversionManager *cm = GetConversionManager();
+	assert(cm != NULL);
+
+	cm ->SetCoordSystem(IGameConversionManager::IGAME_OGL);
+
+	if (!scene ->InitialiseIGame(false))
+	{
+		Log::LogT("error: couldnt initialize scene");
+		return false;
+	}
+
+	return true;
+}
+
+bool SGMExporter::SaveGeoFile(const std::string &geoFileName, const std::vector<IGameNode*> &meshNodes)
+{
+	Log::LogT("saving %d mesh nodes to '%s'", (int)meshNodes.size(), geoFileName.c_str());
+
+	meshesCount = 0;
+
+	savedFiles.push_back(SavedFile());
+	SavedFile &savedFile = savedFiles.back();
+	savedFile.fileName = geoFileName;
+
+	// read before the export overwrites it
+	savedFile.hasBaseManifest = settings.WritePatch && savedFile.baseManifest.Load(geoFileName + ".manifest");
+
+	GeoManifest &manifest = savedFile.manifest;
+
+	std::ofstream fileStream(geoFileName.c_str(), std::ios::binary);
+	if (!fileStream.is_open())
+	{
+		Log::LogT("error: couldn't create '%s'", geoFileName.c_str());
+		return false;
+	}
+
+	BinaryWriter bw(&fileStream);
+
+	/*
+
+	1.2
+		- vertex channels in mesh part
+
+	1.3
+		- mesh parts are indexed, vertices are unique within a part
+		- index size (2 or 4 bytes) and index count follow the vertices
+
+	1.4
+		- tagged chunks after mesh properties: int count, then per chunk
+		  4 byte tag, uint32 payload size and the payload
+		- "WIRE" chunk: int parts count, per part uint8 index size, int index
+		  count and a line list indexing the part's vertices
+
+	chunks added later, without a version change as readers skip unknown tags
+
+		- "SDF " chunk: int size x, y, z, float3 origin, float voxel size, float
+		  max distance, then uint8 distances, x fastest, 0 is -max, 255 is +max
+		- "AO  " chunk: int parts count, per part int vertex count and uint8
+		  ambient visibility per vertex, 255 is fully open
+		- "BVH " chunk: int nodes count, int triangles count, 32 byte nodes in
+		  depth first order (float3 min, float3 max, uint32 right child or
+		  first triangle, uint16 triangles count, 0 for inner nodes, uint16
+		  split axis), then uint32 triangle indices, counted through all parts
+		- "OCCL" chunk: int vertex count, float3 positions, uint8 index size,
+		  int index count and a triangle list of boxes lying inside the mesh,
+		  counter clockwise from outside
+		- "SMPL" chunk: float minimal distance, int samples count, per sample
+		  float3 position, float3 face normal and uint32 triangle, counted
+		  through all parts
+		- "TSGN" chunk: int parts count, per part int vertex count, 0 when
+		  the part has no tangents, and int8 1 or -1 per vertex, the
+		  bitangent is that times cross(normal, tangent)
+
+	1.5
+		- uint8 encoding after the vertex type of a part. 0 is indexed, laid
+		  out as in 1.3. 1 is progressive: int vertex count, uint8 index size,
+		  int index count, all at full detail, int base vertex count and the
+		  base vertices, int base index count and the base triangle list, then
+		  int splits count and per split float error, the split's vertex, int
+		  triangles count and their indices, appended to the index buffer, int
+		  corners count and uint32 places in the index buffer set to the split's
+		  vertex. Errors don't grow, vertices and triangles of the full mesh
+		  are in the order the splits make them, chunks refer to that order
+
+	1.6
+		- mesh properties are a packed block: int properties count, uint32
+		  block size, then 20 byte records (uint32 name, uint8 type, uint8
+		  animation type, uint16 0, uint32 keys count, 0 for a single value,
+		  uint32 first key time, uint32 first value), uint32 size and a table
+		  of zero terminated names and string values, uint32 count and int
+		  values of booleans and ints, uint32 count and float values of floats
+		  and vectors, 3 per vector, uint32 count and float key times in
+		  seconds. Names and strings are offsets into the table
+
+	1.7
+		- property records are followed by a name index, 8 bytes per property:
+		  uint32 32-bit FNV-1a hash of the name and uint32 record, sorted by
+		  hash, so a property is found by binary search over the hashes
+
+	1.8
+		- animation type 4, sampled: floats and vectors linear between samples
+		  at a fixed rate. Keys count is the samples count and the first key
+		  time points at two floats, the first sample's time and the step, so
+		  the sample at a time is found by index
+
+	*/
+
+	bw.Write("FTSMDL", 6);
+	bw.Write((unsigned short)((1 << 8) | 8)); // version 1.8
+
+	bw.Write((int)0);
+
+	manifest.headerSize = (uint64_t)fileStream.tellp();
+
+	if (!SaveMeshes(meshNodes, &bw, &fileStream, manifest))
+		return false;
+
+	fileStream.seekp(8, std::ios::beg);
+	//fileStream.seekp(0, std::ios::beg);
+	bw.Write((int)meshesCount);
+	fileStream.close();
+
+	return true;
+}
+
+bool SGMExporter::SaveMeshes(const std::vector<IGameNode*> &meshNodes, BinaryWriter *bw, std::ostream *os, GeoManifest &manifest)
+{
+	for (int i = 0; i < (int)meshNodes.size(); i++)
+	{
+		report.BeginMesh(meshNodes[i]->GetNodeID(), StringUtils::ToNarrow(meshNodes[i]->GetName()));
+
+		Stopwatch convertTime;
+		Scene3DMesh *mesh = ConvertMesh(meshNodes[i]);
+		report.AddTime(ExportReport::Stage_ConvertMesh, convertTime.GetSeconds());
+
+		if (mesh != NULL)
+		{
+			GMatrix m = meshNodes[i]->GetWorldTM().Inverse();
+
+			mesh->m_worldInverseMatrix.a[0] = m.GetRow(0).x;
+			mesh->m_worldInverseMatrix.a[1] = m.GetRow(0).y;
+			mesh->m_worldInverseMatrix.a[2] = m.GetRow(0).z;
+			mesh->m_worldInverseMatrix.a[3] = m.GetRow(0).w;
+
+			mesh->m_worldInverseMatrix.a[4] = m.GetRow(1).x;
+			mesh->m_worldInverseMatrix.a[5] = m.GetRow(1).y;
+			mesh->m_worldInverseMatrix.a[6] = m.GetRow(1).z;
+			mesh->m_worldInverseMatrix.a[7] = m.GetRow(1).w;
+
+			mesh->m_worldInverseMatrix.a[8] = m.GetRow(2).x;
+			mesh->m_worldInverseMatrix.a[9] = m.GetRow(2).y;
+			mesh->m_worldInverseMatrix.a[10] = m.GetRow(2).z;
+			mesh->m_worldInverseMatrix.a[11] = m.GetRow(2).w;
+
+			mesh->m_worldInverseMatrix.a[12] = m.GetRow(3).x;
+			mesh->m_worldInverseMatrix.a[13] = m.GetRow(3).y;
+			mesh->m_worldInverseMatrix.a[14] = m.GetRow(3).z;
+			mesh->m_worldInverseMatrix.a[15] = m.GetRow(3).w;
+
+			for (unsigned j = 0; j < mesh->meshParts.size(); j++)
+			{
+				MeshPartStats partStats;
+				partStats.Collect(mesh->meshParts[j]);
+				report.AddPart(partStats);
+			}
+
+			meshesCount++;
+
+			GeoManifest::Chunk chunk;
+			chunk.nodeId = mesh->id;
+			chunk.offset = (uint64_t)os->tellp();
+
+			Stopwatch serializationTime;
+			GeoSaver::SaveMesh(mesh, *bw);
+			report.AddTime(ExportReport::Stage_Serialization, serializationTime.GetSeconds());
+
+			chunk.size = (uint64_t)os->tellp() - chunk.offset;
+			chunk.hash = 0;
+			manifest.chunks.push_back(chunk);
+
+			delete mesh;
+		}
+			//meshes.push_back(mesh);
+		else
+			report.SkipMesh();
+
+		StepProgress();
+	}
+
+	return true;
+}
+
+bool SGMExporter::SaveSectors(const std::vector<IGameNode*> &meshNodes)
+{
+	std::vector<IGameNode*> dynamicNodes;
+	std::vector<IGameNode*> staticNodes;
+	std::vector<SectorPartition::Item> items;
+
+	for (unsigned i = 0; i < meshNodes.size(); i++)
+	{
+		if (!IsStatic(meshNodes[i]))
+		{
+			dynamicNodes.push_back(meshNodes[i]);
+			continue;
+		}
+
+		SectorPartition::Item item;
+		GetWorldBounds(meshNodes[i], item.boundsMin, item.boundsMax);
+
+		staticNodes.push_back(meshNodes[i]);
+		items.push_back(item);
+	}
+
+	std::vector<SectorPartition::Sector> sectors;
+
+	if (settings.SectorMode == "grid")
+		SectorPartition::BuildGrid(items, settings.SectorSize, sectors);
+	else
+		SectorPartition::BuildAdaptive(items, settings.SectorMaxMeshes, sectors);
+
+	Log::LogT("%d static nodes in %d sectors, %d dynamic nodes stay in '%s'",
+		(int)staticNodes.size(), (int)sectors.size(), (int)dynamicNodes.size(), fileName.c_str());
+
+	// dynamic meshes are always loaded, they keep the original file name
+	if (!SaveGeoFile(fileName, dynamicNodes))
+		return false;
+
+	std::string baseName = GetSectorBaseName();
+
+	std::vector<std::string> sectorFileNames;
+
+	for (unsigned i = 0; i < sectors.size(); i++)
+	{
+		char suffix[64];
+		if (settings.SectorMode == "grid")
+			sprintf(suffix, "_x%d_z%d.geo", sectors[i].x, sectors[i].z);
+		else
+			sprintf(suffix, "_s%d.geo", i);
+
+		sectorFileNames.push_back(baseName + suffix);
+
+		std::vector<IGameNode*> sectorNodes;
+		for (unsigned j = 0; j < sectors[i].items.size(); j++)
+			sectorNodes.push_back(staticNodes[sectors[i].items[j]]);
+
+		if (!SaveGeoFile(sectorFileNames.back(), sectorNodes))
+			return false;
+	}
+
+	RemoveStaleSectorFiles(baseName + ".sectors.xml", sectorFileNames);
+
+	return SaveSectorIndex(baseName + ".sectors.xml", sectors, sectorFileNames);
+}
+
+// Sector files of the previous export that this one doesn't write would stay
+// next to the new index, with their manifests and patches. Only files the
+// previous index lists are removed, other scenes' files can have the same
+// names as sectors.
+void SGMExporter::RemoveStaleSectorFiles(const std::string &indexFileName, const std::vector<std::string> &sectorFileNames)
+{
+	std::ifstream indexStream(indexFileName.c_str());
+	if (!indexStream.is_open())
+		return;
+
+	std::stringstream index;
+	index << indexStream.rdbuf();
+	indexStream.close();
+
+	std::set<std::string> keptFiles;
+	for (unsigned i = 0; i < sectorFileNames.size(); i++)
+		keptFiles.insert(GetFileName(sectorFileNames[i]));
+
+	std::string directory = indexFileName.substr(0, indexFileName.size() - GetFileName(indexFileName).size());
+	std::string text = index.str();
+	const std::string attribute = " file=\"";
+
+	for (size_t start = text.find(attribute); start != std::string::npos; start = text.find(attribute, start))
+	{
+		start += attribute.size();
+
+		size_t end = text.find('"', start);
+		if (end == std::string::npos)
+			break;
+
+		std::string sectorFile = text.substr(start, end - start);
+		if (sectorFile.empty() || keptFiles.count(sectorFile) > 0)
+			continue;
+
+		Log::LogT("removing sector file '%s' of the previous export", sectorFile.c_str());
+
+		remove((directory + sectorFile).c_str());
+		remove((directory + sectorFile + ".manifest").c_str());
+		remove((directory + sectorFile + ".patch").c_str());
+	}
+}
+
+std::string SGMExporter::GetSectorBaseName()
+{
+	if (fileName.size() > 4 && fileName.substr(fileName.size() - 4) == ".geo")
+		return fileName.substr(0, fileName.size() - 4);
+
+	return fileName;
+}
+
+bool SGMExporter::SaveSectorIndex(
+	const std::string &indexFileName,
+	const std::vector<SectorPartition::Sector> &sectors,
+	const std::vector<std::string> &sectorFileNames)
+{
+	std::ofstream fileStream(indexFileName.c_str());
+	if (!fileStream.is_open())
+	{
+		Log::LogT("error: couldn't create sector index '%s'", indexFileName.c_str());
+		return false;
+	}
+
+	XmlWriter xml(&fileStream, 0);
+
+	xml.OpenElement("Sectors");
+	xml.WriteAttribute("mode", settings.SectorMode);
+	if (settings.SectorMode == "grid")
+		xml.WriteAttribute("size", settings.SectorSize);
+	xml.WriteAttribute("dynamic", GetFileName(fileName));
+
+	for (unsigned i = 0; i < sectors.size(); i++)
+	{
+		const SectorPartition::Sector &sector = sectors[i];
+
+		xml.OpenElement("Sector");
+		xml.WriteAttribute("id", i);
+		xml.WriteAttribute("file", GetFileName(sectorFileNames[i]));
+		xml.WriteAttribute("meshes", (int)sector.items.size());
+		if (settings.SectorMode == "grid")
+		{
+			xml.WriteAttribute("x", sector.x);
+			xml.WriteAttribute("z", sector.z);
+		}
+
+		xml.CreateElement("Cell", "min", ToString(sector.cellMin), "max", ToString(sector.cellMax));
+		xml.CreateElement("Bounds", "min", ToString(sector.boundsMin), "max", ToString(sector.boundsMax));
+
+		for (unsigned j = 0; j < sector.neighbors.size(); j++)
+			xml.CreateElement("Neighbor", "id", sector.neighbors[j]);
+
+		xml.CloseElement();
+	}
+
+	xml.CloseElement();
+
+	fileStream.close();
+
+	return true;
+}
+
+bool SGMExporter::IsStatic(IGameNode *node)
+{
+	// a node moves with any of its parents
+	for (; node != NULL; node = node->GetNodeParent())
+	{
+		IGameControl *gControl = node->GetIGameControl();
+
+		if (gControl != NULL &&
+			(gControl->IsAnimated(IGAME_POS) || gControl->IsAnimated(IGAME_ROT) || gControl->IsAnimated(IGAME_SCALE)))
+			return false;
+	}
+
+	return true;
+}
+
+void SGMExporter::GetWorldBounds(IGameNode *node, sm::Vec3 &min, sm::Vec3 &max)
+{
+	Box3 box;
+
+	IGameObject *gameObject = node->GetIGameObject();
+	gameObject->GetBoundingBox(box);
+	node->ReleaseIGameObject();
+
+	Matrix3 worldTM = node->GetWorldTM().ExtractMatrix3();
+
+	for (int i = 0; i < 8; i++)
+	{
+		Point3 corner = box[i] * worldTM;
+
+		if (i == 0)
+		{
+			min.Set(corner.x, corner.y, corner.z);
+			max = min;
+			continue;
+		}
+
+		min.Set(std::min(min.x, corner.x), std::min(min.y, corner.y), std::min(min.z, corner.z));
+		max.Set(std::max(max.x, corner.x), std::max(max.y, corner.y), std::max(max.z, corner.z));
+	}
+}
+
+std::string SGMExporter::GetFileName(const std::string &path)
+{
+	size_t separator = path.find_last_of("\\/");
+	if (separator == std::string::npos)
+		return path;
+
+	return path.substr(separator + 1);
+}
+
+std::string SGMExporter::ToString(const sm::Vec3 &v)
+{
+	std::stringstream ss;
+	ss << v.x << "," << v.y << "," << v.z;
+	return ss.str();
+}
+
+class AnimationRange
+{
+public:
+	int startFrame;
+	int endFrame;
+	int fps;
+	bool loop;
+	const char *name;
+
+	AnimationRange(int startFrame, int endFrame, int fps, const char *name, bool loop) :
+		name(name)
+	{
+		this ->startFrame = startFrame;
+		this ->endFrame = endFrame;
+		this ->fps = fps;
+		this ->loop = loop;
+	}
+};
+
+bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_interface)
+{
+	fileName = StringUtils::ToNarrow(name);
+
+	Log::StartLog(true, false, false);
+	Log::LogT("=== exporting geometry to file '%s'", fileName.c_str());
+
+	std::string settingsDir = StringUtils::ToNarrow(max_interface->GetDir(APP_PLUGCFG_DIR));
+	settings.Load(settingsDir + "\\GeometryExporter.ini");
+
+	/*std::vector<AnimationRange*> animRanges;
+
+	animRanges.push_back(new AnimationRange(1, 30, 30, "walk", true));
+	animRanges.push_back(new AnimationRange(33, 62, 30, "run", true));
+	animRanges.push_back(new AnimationRange(65, 84, 30, "attack01", false));
+	animRanges.push_back(new AnimationRange(87, 107, 30, "attack02", false));
+	animRanges.push_back(new AnimationRange(109, 139, 30, "stand", true));
+	animRanges.push_back(new AnimationRange(141, 170, 30, "attack03", false));
+	animRanges.push_back(new AnimationRange(173, 192, 30, "attack04", false));
+	animRanges.push_back(new AnimationRange(195, 214, 30, "attack05", false));
+	animRanges.push_back(new AnimationRange(260, 300, 30, "die01", false));
+	animRanges.push_back(new AnimationRange(302, 343, 30, "die02", false));*/
 
 	/*animRanges.push_back(new AnimationRange(1, 1, 30, "walk", true));
 	animRanges.push_back(new AnimationRange(33, 33, 30, "run", true));
@@ -610,32 +1684,404 @@ bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_i
 		fileStream.close();
 	}*/
 
-	meshesCount = 0;
+	report.Clear();
+	savedFiles.clear();
 
-	std::ofstream fileStream(fileName.c_str(), std::ios::binary);
-	BinaryWriter bw(&fileStream);
+	if (!InitializeScene())
+		return false;
+
+	// get only mesh nodes
+	std::vector<IGameNode*> meshNodes;
+	for (int i = 0; i < scene ->GetTopLevelNodeCount(); i++)
+		FilterMeshNodes(scene ->GetTopLevelNode(i), meshNodes);
+
+	SetProgressSteps((int)meshNodes.size());
+
+	// moving meshes would leave their occlusion behind
+	std::set<int> staticIds;
+	if (settings.AoBake || settings.BvhMode == "level")
+	{
+		for (unsigned i = 0; i < meshNodes.size(); i++)
+			if (IsStatic(meshNodes[i]))
+				staticIds.insert(meshNodes[i]->GetNodeID());
+	}
+
+	bool result;
+	if (settings.SectorMode == "none")
+	{
+		result = SaveGeoFile(fileName, meshNodes);
+
+		// everything is in the one file now, sectors of an earlier export would be loaded on top of it
+		if (result)
+		{
+			std::string indexFileName = GetSectorBaseName() + ".sectors.xml";
+
+			RemoveStaleSectorFiles(indexFileName, std::vector<std::string>());
+			remove(indexFileName.c_str());
+		}
+	}
+	else
+		result = SaveSectors(meshNodes);
+
+	scene ->ReleaseIGame();
+
+	if (!result)
+		return false;
+
+	// high poly meshes are gone after their bake, so they neither occlude nor land in the level bvh
+	if (settings.NormalMapBake && !BakeNormalMaps())
+		return false;
+
+	if (settings.AoBake && !BakeAmbientOcclusion(staticIds))
+		return false;
+
+	if (settings.BvhMode == "level" && !SaveLevelBvh(staticIds))
+		return false;
+
+	if (settings.WritePatch)
+	{
+		for (unsigned i = 0; i < savedFiles.size(); i++)
+			SavePatch(savedFiles[i].fileName, savedFiles[i].manifest, savedFiles[i].baseManifest, savedFiles[i].hasBaseManifest);
+	}
+
+	report.Save(fileName + ".stats.json", fileName);
+
+	return true;
+}
+
+void SGMExporter::SavePatch(
+	const std::string &geoFileName,
+	GeoManifest &manifest,
+	const GeoManifest &baseManifest,
+	bool hasBaseManifest)
+{
+	std::string patchFileName = geoFileName + ".patch";
+
+	// a patch left from an earlier export would apply to a different base
+	remove(patchFileName.c_str());
+
+	if (!manifest.Build(geoFileName))
+		return;
+
+	if (hasBaseManifest)
+		GeoPatch::Create(baseManifest, manifest, geoFileName, patchFileName);
+	else
+		Log::LogT("no manifest of a previous export of '%s', patch not created", geoFileName.c_str());
+
+	manifest.Save(geoFileName + ".manifest");
+}
+
+// NULL when the file can't be loaded, GeoFile::Load logs why
+GeoFile* SGMExporter::LoadSavedFile(unsigned index)
+{
+	GeoFile *file = new GeoFile();
+
+	if (!file->Load(savedFiles[index].fileName))
+	{
+		delete file;
+		return NULL;
+	}
+
+	return file;
+}
+
+bool SGMExporter::BakeAmbientOcclusion(const std::set<int> &meshIds)
+{
+	Stopwatch bakeTime;
+
+	// static meshes of all sectors occlude each other. Files are loaded one at
+	// a time, once to gather the occluders' positions and once to bake them
+	GeoAoBaker baker;
+	bool result = true;
+
+	for (unsigned i = 0; i < savedFiles.size() && result; i++)
+	{
+		GeoFile *file = LoadSavedFile(i);
+		result = file != NULL;
+
+		if (result)
+			baker.AddOccluders(file, &meshIds);
+
+		delete file;
+	}
+
+	if (result && !baker.BuildOccluders(settings.AoSamples, settings.AoDistance))
+		return true;
+
+	for (unsigned i = 0; i < savedFiles.size() && result; i++)
+	{
+		GeoFile *file = LoadSavedFile(i);
+		result = file != NULL;
+
+		if (result && baker.BakeFile(file, &meshIds) > 0)
+		{
+			// the manifest keeps describing the file as it was until the new one is saved
+			result = file->Save(savedFiles[i].fileName);
+			if (result)
+			{
+				// chunks moved, the manifest has to follow them
+				UpdateManifest(savedFiles[i].manifest, file);
+			}
+			else
+				Log::LogT("error: couldn't save '%s' with baked occlusion", savedFiles[i].fileName.c_str());
+		}
+
+		delete file;
+	}
+
+	if (!result)
+	{
+		Log::LogT("error: baking ambient occlusion failed");
+		return false;
+	}
+
+	Log::LogT("ambient occlusion of %d files baked in %f s", (int)savedFiles.size(), bakeTime.GetSeconds());
+
+	return true;
+}
+
+void SGMExporter::UpdateManifest(GeoManifest &manifest, const GeoFile *file)
+{
+	manifest.headerSize = file->headerSize;
+	manifest.chunks.clear();
+
+	for (unsigned i = 0; i < file->meshes.size(); i++)
+	{
+		GeoManifest::Chunk chunk;
+		chunk.nodeId = file->meshes[i]->id;
+		chunk.offset = file->meshes[i]->offset;
+		chunk.size = file->meshes[i]->size;
+		chunk.hash = 0;
+		manifest.chunks.push_back(chunk);
+	}
+}
+
+bool SGMExporter::SaveLevelBvh(const std::set<int> &meshIds)
+{
+	// triangles are numbered through all meshes, each mesh starts where the previous one ended
+	std::vector<sm::Vec3> vertices;
+	std::vector<int> levelMeshIds;
+	std::vector<uint32_t> firstTriangles;
+
+	// one file at a time, only the positions are kept
+	bool result = true;
+
+	for (unsigned i = 0; i < savedFiles.size() && result; i++)
+	{
+		GeoFile *file = LoadSavedFile(i);
+		result = file != NULL;
+
+		for (unsigned j = 0; result && j < file->meshes.size(); j++)
+		{
+			const GeoFile::Mesh *mesh = file->meshes[j];
+			if (meshIds.find(mesh->id) == meshIds.end())
+				continue;
+
+			levelMeshIds.push_back(mesh->id);
+			firstTriangles.push_back((uint32_t)(vertices.size() / 3));
+
+			for (unsigned k = 0; k < mesh->parts.size(); k++)
+			{
+				const GeoFile::Part *part = mesh->parts[k];
+				int stride = part->GetFloatsPerVertex();
+
+				for (unsigned l = 0; l < part->indices.size(); l++)
+				{
+					const float *position = &part->vertices[part->indices[l] * stride];
+					vertices.push_back(sm::Vec3(position[0], position[1], position[2]));
+				}
+			}
+		}
+
+		delete file;
+	}
+
+	if (!result)
+	{
+		Log::LogT("error: couldn't load the exported files to build the level bvh");
+		return false;
+	}
+
+	Bvh bvh;
+	bvh.Build(vertices);
+
+	FlatBvh flatBvh;
+	flatBvh.Build(bvh);
+
+	std::string bvhFileName = fileName;
+	if (bvhFileName.size() > 4 && bvhFileName.substr(bvhFileName.size() - 4) == ".geo")
+		bvhFileName = bvhFileName.substr(0, bvhFileName.size() - 4);
+	bvhFileName += ".bvh";
+
+	std::ofstream fileStream(bvhFileName.c_str(), std::ios::binary);
+	if (!fileStream.is_open())
+	{
+		Log::LogT("error: couldn't create '%s'", bvhFileName.c_str());
+		return false;
+	}
 
 	/*
 
-	1.2
-		- vertex channels in mesh part
+	1.0
+		- int meshes count, per mesh int node id and uint32 first triangle,
+		  then the bvh as in the "BVH " chunk of .geo. Triangle indices are
+		  counted through all listed meshes, in their order.
 
 	*/
 
-	bw.Write("FTSMDL", 6);
-	bw.Write((unsigned short)((1 << 8) | 2)); // version 1.2
+	BinaryWriter bw(&fileStream);
 
-	bw.Write((int)0);
+	bw.Write("FTSBVH", 6);
+	bw.Write((unsigned short)((1 << 8) | 0)); // version 1.0
 
-	std::vector<Scene3DMesh*> meshes;
-	if (!GetMeshes(meshes, &bw))
-		return false;
+	bw.Write((int)levelMeshIds.size());
+	for (unsigned i = 0; i < levelMeshIds.size(); i++)
+	{
+		bw.Write(levelMeshIds[i]);
+		bw.Write(firstTriangles[i]);
+	}
+
+	flatBvh.Save(bw);
 
-	fileStream.seekp(8, std::ios::beg);
-	//fileStream.seekp(0, std::ios::beg);
-	bw.Write((int)meshesCount);
 	fileStream.close();
 
+	Log::LogT("level bvh of %d meshes, %d triangles, %d nodes saved to '%s'",
+		(int)levelMeshIds.size(), (int)vertices.size() / 3, (int)flatBvh.nodes.size(), bvhFileName.c_str());
+
+	return true;
+}
+
+bool SGMExporter::BakeNormalMaps()
+{
+	// names are gathered first, then only the files of a pair are loaded for
+	// its bake, so the meshes of all files are never in memory together
+	std::map<std::string, unsigned> fileIndices;
+	bool result = true;
+
+	for (unsigned i = 0; i < savedFiles.size() && result; i++)
+	{
+		GeoFile *file = LoadSavedFile(i);
+		result = file != NULL;
+
+		for (unsigned j = 0; result && j < file->meshes.size(); j++)
+			fileIndices[file->meshes[j]->name] = i;
+
+		delete file;
+	}
+
+	// base names of the pairs by the files of their low and high meshes
+	std::map<std::pair<unsigned, unsigned>, std::vector<std::string> > pairsByFiles;
+
+	std::map<std::string, unsigned>::iterator it;
+	for (it = fileIndices.begin(); it != fileIndices.end() && result; it++)
+	{
+		const std::string &lowName = it->first;
+		if (lowName.size() <= 4 || lowName.substr(lowName.size() - 4) != "_low")
+			continue;
+
+		std::string baseName = lowName.substr(0, lowName.size() - 4);
+
+		std::map<std::string, unsigned>::iterator high = fileIndices.find(baseName + "_high");
+		if (high == fileIndices.end())
+		{
+			Log::LogT("warning: no '%s_high' for '%s', normal map not baked", baseName.c_str(), lowName.c_str());
+			continue;
+		}
+
+		pairsByFiles[std::make_pair(it->second, high->second)].push_back(baseName);
+	}
+
+	std::string directory = fileName.substr(0, fileName.size() - GetFileName(fileName).size());
+	int bakedCount = 0;
+
+	// high meshes only exist for the bake, they're left out of their files after it
+	std::vector<std::set<std::string> > bakedHighNames(savedFiles.size());
+
+	std::map<std::pair<unsigned, unsigned>, std::vector<std::string> >::iterator pairs;
+	for (pairs = pairsByFiles.begin(); pairs != pairsByFiles.end() && result; pairs++)
+	{
+		unsigned lowIndex = pairs->first.first;
+		unsigned highIndex = pairs->first.second;
+
+		GeoFile *lowFile = LoadSavedFile(lowIndex);
+		GeoFile *highFile = lowIndex == highIndex ? lowFile : (lowFile != NULL ? LoadSavedFile(highIndex) : NULL);
+		result = lowFile != NULL && highFile != NULL;
+
+		for (unsigned i = 0; i < pairs->second.size() && result; i++)
+		{
+			const std::string &baseName = pairs->second[i];
+			const GeoFile::Mesh *low = lowFile->FindMesh(baseName + "_low");
+			const GeoFile::Mesh *high = highFile->FindMesh(baseName + "_high");
+
+			Stopwatch bakeTime;
+
+			NormalMap normalMap;
+			if (!NormalMapBaker::Bake(low, high, settings.NormalMapSize, settings.NormalMapDistance, normalMap))
+			{
+				Log::LogT("warning: '%s' or '%s' has nothing to bake, normal map not baked", low->name.c_str(), high->name.c_str());
+				continue;
+			}
+
+			std::string mapFileName = directory + baseName + "_normal.tga";
+			result = normalMap.SaveTga(mapFileName);
+			if (!result)
+			{
+				Log::LogT("error: couldn't save '%s'", mapFileName.c_str());
+				break;
+			}
+
+			Log::LogT("normal map of '%s' baked to '%s' in %f s", baseName.c_str(), mapFileName.c_str(), bakeTime.GetSeconds());
+			bakedCount++;
+			bakedHighNames[highIndex].insert(high->name);
+		}
+
+		if (highFile != lowFile)
+			delete highFile;
+		delete lowFile;
+	}
+
+	for (unsigned i = 0; i < savedFiles.size() && result; i++)
+	{
+		if (bakedHighNames[i].size() == 0)
+			continue;
+
+		GeoFile *file = LoadSavedFile(i);
+		result = file != NULL;
+
+		if (result)
+		{
+			std::vector<GeoFile::Mesh*> &meshes = file->meshes;
+
+			for (unsigned j = 0; j < meshes.size(); )
+			{
+				if (bakedHighNames[i].find(meshes[j]->name) != bakedHighNames[i].end())
+				{
+					delete meshes[j];
+					meshes.erase(meshes.begin() + j);
+				}
+				else
+					j++;
+			}
+
+			// the manifest keeps describing the file as it was until the new one is saved
+			result = file->Save(savedFiles[i].fileName);
+			if (result)
+				UpdateManifest(savedFiles[i].manifest, file);
+			else
+				Log::LogT("error: couldn't save '%s' without its high poly meshes", savedFiles[i].fileName.c_str());
+		}
+
+		delete file;
+	}
+
+	if (!result)
+	{
+		Log::LogT("error: baking normal maps failed");
+		return false;
+	}
+
+	Log::LogT("%d normal maps baked", bakedCount);
+
 	return true;
 }
 
@@ -2,6 +2,7 @@
 
 #include <windows.h>
 #include <vector>
+#include <set>
 
 #include <IO\BinaryWriter.h>
 
@@ -13,23 +14,76 @@
 #include "..\..\CommonIncludes\IExportInterface.h"
 
 #include "scene3d\GeoSaver.h"
+#include "ExportSettings.h"
+#include "ExportReport.h"
+#include "GeoPatch.h"
+#include "GeoFile.h"
+#include "SectorPartition.h"
 
 class SGMExporter : public IExportInterface
 {
 private:
+	// .geo written by the export. Patches are made once all steps that
+	// rewrite saved files are done, so they are kept until then.
+	class SavedFile
+	{
+	public:
+		std::string fileName;
+		GeoManifest manifest;
+		GeoManifest baseManifest;
+		bool hasBaseManifest;
+	};
+
 	std::vector<IProgressObserver*> observers;
 	std::string fileName;
 
 	IGameScene *scene;
+	ExportSettings settings;
+	ExportReport report;
+	std::vector<SavedFile> savedFiles;
 
 	uint8_t GetVertexType(IGameMaterial *material, IGameMesh *gMesh);
 
-	bool GetMeshes(std::vector<Scene3DMesh*> &meshes, BinaryWriter *bw);
+	bool InitializeScene();
+	bool SaveGeoFile(const std::string &geoFileName, const std::vector<IGameNode*> &meshNodes);
+	bool SaveMeshes(const std::vector<IGameNode*> &meshNodes, BinaryWriter *bw, std::ostream *os, GeoManifest &manifest);
+	void SavePatch(const std::string &geoFileName, GeoManifest &manifest, const GeoManifest &baseManifest, bool hasBaseManifest);
+	GeoFile* LoadSavedFile(unsigned index);
+	bool BakeAmbientOcclusion(const std::set<int> &meshIds);
+	void UpdateManifest(GeoManifest &manifest, const GeoFile *file);
+	bool SaveLevelBvh(const std::set<int> &meshIds);
+	bool BakeNormalMaps();
+
+	bool SaveSectors(const std::vector<IGameNode*> &meshNodes);
+	bool SaveSectorIndex(
+		const std::string &indexFileName,
+		const std::vector<SectorPartition::Sector> &sectors,
+		const std::vector<std::string> &sectorFileNames);
+	void RemoveStaleSectorFiles(const std::string &indexFileName, const std::vector<std::string> &sectorFileNames);
+	std::string GetSectorBaseName();
+	bool IsStatic(IGameNode *node);
+	void GetWorldBounds(IGameNode *node, sm::Vec3 &min, sm::Vec3 &max);
+	static std::string GetFileName(const std::string &path);
+	static std::string ToString(const sm::Vec3 &v);
 	Scene3DMesh* ConvertMesh(IGameNode* meshNode);
-	void ExtractVertices(FaceEx *gFace, IGameMesh *gMesh, std::vector<Scene3DVertex*> &vertices, uint8_t vertexType);
+	bool IsMirrored(IGameMesh *gMesh);
+	void ExtractVertices(FaceEx *gFace, IGameMesh *gMesh, bool mirrored, std::vector<Scene3DVertex*> &vertices, uint8_t vertexType);
+	void ExtractVertex(FaceEx *gFace, IGameMesh *gMesh, bool mirrored, int corner, uint8_t vertexType, Scene3DVertex &vert);
+	bool ExtractPartOutOfCore(Scene3DMeshPart *meshPart, IGameMesh *gMesh, bool mirrored, Tab<FaceEx*> *gFaces);
 	IGameMaterial* SGMExporter::GetMaterialById( IGameMaterial *mat, int id );
 	void FilterMeshNodes(IGameNode *node, std::vector<IGameNode*> &meshNodes);
 	void CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh);
+	bool IndexMeshParts(Scene3DMesh *mesh);
+	void BuildProgressiveParts(Scene3DMesh *mesh);
+	bool UsesWire(IGameMaterial *material);
+	void BuildWireChunk(Scene3DMesh *mesh);
+	void BuildTangentSignChunk(Scene3DMesh *mesh);
+	void BakeSdfChunk(Scene3DMesh *mesh);
+	void BuildBvhChunk(Scene3DMesh *mesh);
+	bool IsOccluder(IGameMesh *gMesh);
+	void BuildOccluderChunk(Scene3DMesh *mesh);
+	float GetSampleDensity(IGameMesh *gMesh);
+	void BuildSamplesChunk(Scene3DMesh *mesh, float density);
 
 	void SetProgressSteps(int progressSteps);
 	void StepProgress();
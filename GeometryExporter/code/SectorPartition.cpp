@@ -0,0 +1,234 @@
+#include "SectorPartition.h"
+
+#include <map>
+#include <algorithm>
+#include <math.h>
+
+const float SectorPartition::MinCellSize = 1.0f;
+
+namespace
+{
+	class CenterOrder
+	{
+	public:
+		CenterOrder(const std::vector<sm::Vec3> &centers, int axis) :
+			m_centers(centers),
+			m_axis(axis)
+		{
+		}
+
+		bool operator()(unsigned a, unsigned b) const
+		{
+			float va = m_axis == 0 ? m_centers[a].x : m_centers[a].z;
+			float vb = m_axis == 0 ? m_centers[b].x : m_centers[b].z;
+
+			if (va != vb)
+				return va < vb;
+
+			return a < b;
+		}
+
+	private:
+		const std::vector<sm::Vec3> &m_centers;
+		int m_axis;
+	};
+}
+
+sm::Vec3 SectorPartition::GetCenter(const Item &item)
+{
+	return sm::Vec3(
+		(item.boundsMin.x + item.boundsMax.x) * 0.5f,
+		(item.boundsMin.y + item.boundsMax.y) * 0.5f,
+		(item.boundsMin.z + item.boundsMax.z) * 0.5f);
+}
+
+void SectorPartition::BuildGrid(const std::vector<Item> &items, float cellSize, std::vector<Sector> &sectors)
+{
+	std::map<std::pair<int, int>, unsigned> cells;
+
+	for (unsigned i = 0; i < items.size(); i++)
+	{
+		sm::Vec3 center = GetCenter(items[i]);
+
+		std::pair<int, int> cell(
+			(int)floorf(center.x / cellSize),
+			(int)floorf(center.z / cellSize));
+
+		std::map<std::pair<int, int>, unsigned>::iterator it = cells.find(cell);
+		if (it == cells.end())
+		{
+			Sector sector;
+			sector.x = cell.first;
+			sector.z = cell.second;
+
+			it = cells.insert(std::make_pair(cell, (unsigned)sectors.size())).first;
+			sectors.push_back(sector);
+		}
+
+		sectors[it->second].items.push_back(i);
+	}
+
+	for (unsigned i = 0; i < sectors.size(); i++)
+	{
+		Sector &sector = sectors[i];
+
+		UpdateBounds(items, sector);
+
+		sector.cellMin.Set(sector.x * cellSize, sector.boundsMin.y, sector.z * cellSize);
+		sector.cellMax.Set((sector.x + 1) * cellSize, sector.boundsMax.y, (sector.z + 1) * cellSize);
+	}
+
+	FindNeighbors(sectors);
+}
+
+void SectorPartition::BuildAdaptive(const std::vector<Item> &items, unsigned maxItems, std::vector<Sector> &sectors)
+{
+	if (items.size() == 0)
+		return;
+
+	std::vector<unsigned> indices(items.size());
+	for (unsigned i = 0; i < items.size(); i++)
+		indices[i] = i;
+
+	// the root cell covers every item, the same way the sectors' cells cover their items
+	Sector root;
+	root.items = indices;
+	UpdateBounds(items, root);
+
+	Split(items, indices, root.boundsMin, root.boundsMax, std::max(maxItems, 1u), sectors);
+
+	// a sector's height is the height of what it holds
+	for (unsigned i = 0; i < sectors.size(); i++)
+	{
+		sectors[i].cellMin.y = sectors[i].boundsMin.y;
+		sectors[i].cellMax.y = sectors[i].boundsMax.y;
+	}
+
+	FindNeighbors(sectors);
+}
+
+void SectorPartition::Split(
+	const std::vector<Item> &items,
+	std::vector<unsigned> &indices,
+	const sm::Vec3 &cellMin,
+	const sm::Vec3 &cellMax,
+	unsigned maxItems,
+	std::vector<Sector> &sectors)
+{
+	if (indices.size() == 0)
+		return;
+
+	float sizeX = cellMax.x - cellMin.x;
+	float sizeZ = cellMax.z - cellMin.z;
+
+	if (indices.size() <= maxItems || std::max(sizeX, sizeZ) < MinCellSize * 2.0f)
+	{
+		Sector sector;
+		sector.x = 0;
+		sector.z = 0;
+		sector.cellMin = cellMin;
+		sector.cellMax = cellMax;
+		sector.items = indices;
+
+		UpdateBounds(items, sector);
+		sectors.push_back(sector);
+		return;
+	}
+
+	int axis = sizeX >= sizeZ ? 0 : 2;
+
+	std::vector<sm::Vec3> centers(items.size());
+	for (unsigned i = 0; i < indices.size(); i++)
+		centers[indices[i]] = GetCenter(items[indices[i]]);
+
+	std::sort(indices.begin(), indices.end(), CenterOrder(centers, axis));
+
+	unsigned half = (unsigned)indices.size() / 2;
+	const sm::Vec3 &median = centers[indices[half]];
+
+	float low = axis == 0 ? cellMin.x : cellMin.z;
+	float high = axis == 0 ? cellMax.x : cellMax.z;
+	float split = axis == 0 ? median.x : median.z;
+
+	// keep both halves at least MinCellSize wide, items follow the split plane
+	split = std::min(std::max(split, low + MinCellSize), high - MinCellSize);
+
+	std::vector<unsigned> lowIndices;
+	std::vector<unsigned> highIndices;
+
+	for (unsigned i = 0; i < indices.size(); i++)
+	{
+		const sm::Vec3 &center = centers[indices[i]];
+
+		if ((axis == 0 ? center.x : center.z) < split)
+			lowIndices.push_back(indices[i]);
+		else
+			highIndices.push_back(indices[i]);
+	}
+
+	sm::Vec3 lowMax = cellMax;
+	sm::Vec3 highMin = cellMin;
+
+	if (axis == 0)
+	{
+		lowMax.x = split;
+		highMin.x = split;
+	}
+	else
+	{
+		lowMax.z = split;
+		highMin.z = split;
+	}
+
+	Split(items, lowIndices, cellMin, lowMax, maxItems, sectors);
+	Split(items, highIndices, highMin, cellMax, maxItems, sectors);
+}
+
+void SectorPartition::UpdateBounds(const std::vector<Item> &items, Sector &sector)
+{
+	sector.boundsMin.Set(0.0f, 0.0f, 0.0f);
+	sector.boundsMax.Set(0.0f, 0.0f, 0.0f);
+
+	for (unsigned i = 0; i < sector.items.size(); i++)
+	{
+		const Item &item = items[sector.items[i]];
+
+		if (i == 0)
+		{
+			sector.boundsMin = item.boundsMin;
+			sector.boundsMax = item.boundsMax;
+			continue;
+		}
+
+		sector.boundsMin.Set(
+			std::min(sector.boundsMin.x, item.boundsMin.x),
+			std::min(sector.boundsMin.y, item.boundsMin.y),
+			std::min(sector.boundsMin.z, item.boundsMin.z));
+		sector.boundsMax.Set(
+			std::max(sector.boundsMax.x, item.boundsMax.x),
+			std::max(sector.boundsMax.y, item.boundsMax.y),
+			std::max(sector.boundsMax.z, item.boundsMax.z));
+	}
+}
+
+void SectorPartition::FindNeighbors(std::vector<Sector> &sectors)
+{
+	// cells sharing an edge or a corner, tolerance covers float error of split planes
+	const float epsilon = 0.001f;
+
+	for (unsigned i = 0; i < sectors.size(); i++)
+	{
+		for (unsigned j = i + 1; j < sectors.size(); j++)
+		{
+			const Sector &a = sectors[i];
+			const Sector &b = sectors[j];
+
+			if (a.cellMin.x <= b.cellMax.x + epsilon && b.cellMin.x <= a.cellMax.x + epsilon &&
+				a.cellMin.z <= b.cellMax.z + epsilon && b.cellMin.z <= a.cellMax.z + epsilon)
+			{
+				sectors[i].neighbors.push_back(j);
+				sectors[j].neighbors.push_back(i);
+			}
+		}
+	}
+}
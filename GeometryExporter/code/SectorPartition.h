@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Math\Vec3.h>
+
+#include <string>
+#include <vector>
+
+// Splits static meshes into world sectors on the ground (x, z) plane, sectors
+// span the whole height. Every mesh goes to the sector containing the center
+// of its world bounds.
+class SectorPartition
+{
+public:
+	class Item
+	{
+	public:
+		sm::Vec3 boundsMin;
+		sm::Vec3 boundsMax;
+	};
+
+	class Sector
+	{
+	public:
+		// grid coordinates, only meaningful in grid mode
+		int x;
+		int z;
+
+		// area owned by the sector, cells of a partition never overlap
+		sm::Vec3 cellMin;
+		sm::Vec3 cellMax;
+
+		// union of world bounds of the sector's meshes, can stick out of the cell
+		sm::Vec3 boundsMin;
+		sm::Vec3 boundsMax;
+
+		std::vector<unsigned> items;
+		std::vector<unsigned> neighbors;
+	};
+
+	// regular cells of cellSize
+	static void BuildGrid(const std::vector<Item> &items, float cellSize, std::vector<Sector> &sectors);
+
+	// cells are split at the median of item centers until they hold at most maxItems
+	static void BuildAdaptive(const std::vector<Item> &items, unsigned maxItems, std::vector<Sector> &sectors);
+
+private:
+	// adaptive cells are not split below that size
+	static const float MinCellSize;
+
+	static sm::Vec3 GetCenter(const Item &item);
+	static void Split(
+		const std::vector<Item> &items,
+		std::vector<unsigned> &indices,
+		const sm::Vec3 &cellMin,
+		const sm::Vec3 &cellMax,
+		unsigned maxItems,
+		std::vector<Sector> &sectors);
+
+	static void UpdateBounds(const std::vector<Item> &items, Sector &sector);
+	static void FindNeighbors(std::vector<Sector> &sectors);
+};
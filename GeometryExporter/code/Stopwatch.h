@@ -0,0 +1,31 @@
+#pragma once
+
+#include <windows.h>
+
+class Stopwatch
+{
+private:
+	LARGE_INTEGER start;
+
+public:
+	Stopwatch()
+	{
+		Restart();
+	}
+
+	void Restart()
+	{
+		QueryPerformanceCounter(&start);
+	}
+
+	double GetSeconds() const
+	{
+		LARGE_INTEGER now;
+		LARGE_INTEGER frequency;
+
+		QueryPerformanceCounter(&now);
+		QueryPerformanceFrequency(&frequency);
+
+		return (double)(now.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+	}
+};
@@ -0,0 +1,150 @@
+#include "AoBaker.h"
+#include "Bvh.h"
+#include "../ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+
+const int AoBaker::BlockSize = 64;
+
+class AoBaker::BlockBaker
+{
+public:
+	BlockBaker(
+		const Bvh &bvh,
+		const std::vector<sm::Vec3> &positions,
+		const std::vector<sm::Vec3> &normals,
+		const std::vector<float> &samplesU,
+		const std::vector<float> &samplesV,
+		float maxDistance,
+		float bias,
+		std::vector<uint8_t> &visibility) :
+		m_bvh(bvh),
+		m_positions(positions),
+		m_normals(normals),
+		m_samplesU(samplesU),
+		m_samplesV(samplesV),
+		m_maxDistance(maxDistance),
+		m_bias(bias),
+		m_visibility(visibility)
+	{
+	}
+
+	void operator()(int block)
+	{
+		int first = block * BlockSize;
+		int last = std::min(first + BlockSize, (int)m_positions.size());
+
+		int samplesCount = (int)m_samplesU.size();
+
+		for (int i = first; i < last; i++)
+		{
+			const sm::Vec3 &normal = m_normals[i];
+
+			sm::Vec3 tangent;
+			sm::Vec3 bitangent;
+			GetBasis(normal, tangent, bitangent);
+
+			sm::Vec3 origin = m_positions[i] + normal * m_bias;
+
+			// Cranley-Patterson rotation of the sample set
+			float offsetU = (Hash((uint32_t)i) & 0xffffff) / 16777216.0f;
+			float offsetV = (Hash((uint32_t)i ^ 0x9e3779b9) & 0xffffff) / 16777216.0f;
+
+			int misses = 0;
+
+			for (int j = 0; j < samplesCount; j++)
+			{
+				float u = m_samplesU[j] + offsetU;
+				float v = m_samplesV[j] + offsetV;
+				if (u >= 1.0f) u -= 1.0f;
+				if (v >= 1.0f) v -= 1.0f;
+
+				// cosine weighted: uniform on the disk, projected up to the hemisphere
+				float radius = sqrtf(u);
+				float angle = 6.2831853f * v;
+				float height = sqrtf(std::max(1.0f - u, 0.0f));
+
+				sm::Vec3 direction =
+					tangent * (radius * cosf(angle)) +
+					bitangent * (radius * sinf(angle)) +
+					normal * height;
+
+				if (!m_bvh.Intersects(origin, direction, m_maxDistance))
+					misses++;
+			}
+
+			m_visibility[i] = (uint8_t)(misses * 255 / samplesCount);
+		}
+	}
+
+private:
+	const Bvh &m_bvh;
+	const std::vector<sm::Vec3> &m_positions;
+	const std::vector<sm::Vec3> &m_normals;
+	const std::vector<float> &m_samplesU;
+	const std::vector<float> &m_samplesV;
+	float m_maxDistance;
+	float m_bias;
+	std::vector<uint8_t> &m_visibility;
+};
+
+void AoBaker::Bake(
+	const Bvh &bvh,
+	const std::vector<sm::Vec3> &positions,
+	const std::vector<sm::Vec3> &normals,
+	int samplesCount,
+	float maxDistance,
+	float bias,
+	std::vector<uint8_t> &visibility)
+{
+	visibility.resize(positions.size());
+
+	if (positions.size() == 0 || samplesCount <= 0)
+		return;
+
+	std::vector<float> samplesU(samplesCount);
+	std::vector<float> samplesV(samplesCount);
+
+	for (int i = 0; i < samplesCount; i++)
+	{
+		samplesU[i] = (i + 0.5f) / samplesCount;
+		samplesV[i] = RadicalInverse((uint32_t)i);
+	}
+
+	BlockBaker blockBaker(bvh, positions, normals, samplesU, samplesV, maxDistance, bias, visibility);
+	ParallelFor::Run(((int)positions.size() + BlockSize - 1) / BlockSize, blockBaker);
+}
+
+float AoBaker::RadicalInverse(uint32_t bits)
+{
+	bits = (bits << 16) | (bits >> 16);
+	bits = ((bits & 0x55555555) << 1) | ((bits & 0xaaaaaaaa) >> 1);
+	bits = ((bits & 0x33333333) << 2) | ((bits & 0xcccccccc) >> 2);
+	bits = ((bits & 0x0f0f0f0f) << 4) | ((bits & 0xf0f0f0f0) >> 4);
+	bits = ((bits & 0x00ff00ff) << 8) | ((bits & 0xff00ff00) >> 8);
+
+	return (bits >> 8) / 16777216.0f;
+}
+
+uint32_t AoBaker::Hash(uint32_t value)
+{
+	value ^= value >> 16;
+	value *= 0x7feb352d;
+	value ^= value >> 15;
+	value *= 0x846ca68b;
+	value ^= value >> 16;
+
+	return value;
+}
+
+void AoBaker::GetBasis(const sm::Vec3 &normal, sm::Vec3 &tangent, sm::Vec3 &bitangent)
+{
+	// Duff et al., "Building an Orthonormal Basis, Revisited"
+	float sign = normal.z >= 0.0f ? 1.0f : -1.0f;
+	float a = -1.0f / (sign + normal.z);
+	float b = normal.x * normal.y * a;
+
+	tangent.Set(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+	bitangent.Set(b, sign + normal.y * normal.y * a, -normal.y);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Math/Vec3.h>
+
+#include <vector>
+#include <stdint.h>
+
+class Bvh;
+
+// Ambient occlusion at points on a surface, against the triangles of a Bvh.
+// Rays are cosine weighted over the hemisphere around the point's normal, so
+// the visible fraction of them is the cosine weighted visibility. Samples are
+// a Hammersley set rotated by a hash of the point index, so the result
+// doesn't depend on the threads count and neighbouring points don't band.
+class AoBaker
+{
+public:
+	// visibility gets 255 for a fully open point, 0 for a fully occluded one.
+	// Only hits closer than maxDistance occlude, rays start bias away from the surface.
+	static void Bake(
+		const Bvh &bvh,
+		const std::vector<sm::Vec3> &positions,
+		const std::vector<sm::Vec3> &normals,
+		int samplesCount,
+		float maxDistance,
+		float bias,
+		std::vector<uint8_t> &visibility);
+
+private:
+	// points handed to a thread at once
+	static const int BlockSize;
+
+	// bakes one block of points, run by ParallelFor
+	class BlockBaker;
+
+	static float RadicalInverse(uint32_t bits);
+	static uint32_t Hash(uint32_t value);
+
+	// tangent and bitangent for a unit normal, without branches on the normal's direction
+	static void GetBasis(const sm::Vec3 &normal, sm::Vec3 &tangent, sm::Vec3 &bitangent);
+};
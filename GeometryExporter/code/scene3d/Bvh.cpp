@@ -0,0 +1,650 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+const int Bvh::MaxLeafTriangles = 4;
+const int Bvh::BinsCount = 12;
+
+namespace
+{
+	float GetAxis(const sm::Vec3 &v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	void Grow(sm::Vec3 &min, sm::Vec3 &max, const sm::Vec3 &p)
+	{
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max.Set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	class Bin
+	{
+	public:
+		sm::Vec3 min;
+		sm::Vec3 max;
+		int count;
+
+		Bin() :
+			min(FLT_MAX, FLT_MAX, FLT_MAX),
+			max(-FLT_MAX, -FLT_MAX, -FLT_MAX),
+			count(0)
+		{
+		}
+	};
+
+	class BinIndex
+	{
+	public:
+		BinIndex(const std::vector<sm::Vec3> &centroids, int axis, float min, float scale, int binsCount) :
+			m_centroids(centroids),
+			m_axis(axis),
+			m_min(min),
+			m_scale(scale),
+			m_binsCount(binsCount)
+		{
+		}
+
+		int operator()(int triangle) const
+		{
+			int bin = (int)((GetAxis(m_centroids[triangle], m_axis) - m_min) * m_scale);
+			return std::min(std::max(bin, 0), m_binsCount - 1);
+		}
+
+	private:
+		const std::vector<sm::Vec3> &m_centroids;
+		int m_axis;
+		float m_min;
+		float m_scale;
+		int m_binsCount;
+	};
+
+	class BinBelow
+	{
+	public:
+		BinBelow(const BinIndex &binIndex, int split) :
+			m_binIndex(binIndex),
+			m_split(split)
+		{
+		}
+
+		bool operator()(int triangle) const
+		{
+			return m_binIndex(triangle) < m_split;
+		}
+
+	private:
+		const BinIndex &m_binIndex;
+		int m_split;
+	};
+
+	class CentroidOrder
+	{
+	public:
+		CentroidOrder(const std::vector<sm::Vec3> &centroids, int axis) :
+			m_centroids(centroids),
+			m_axis(axis)
+		{
+		}
+
+		bool operator()(int a, int b) const
+		{
+			float va = GetAxis(m_centroids[a], m_axis);
+			float vb = GetAxis(m_centroids[b], m_axis);
+
+			if (va != vb)
+				return va < vb;
+
+			return a < b;
+		}
+
+	private:
+		const std::vector<sm::Vec3> &m_centroids;
+		int m_axis;
+	};
+}
+
+void Bvh::Build(const std::vector<sm::Vec3> &vertices)
+{
+	m_vertices = vertices;
+	m_nodes.clear();
+
+	int trianglesCount = (int)vertices.size() / 3;
+
+	m_triangles.resize(trianglesCount);
+	m_centroids.resize(trianglesCount);
+
+	for (int i = 0; i < trianglesCount; i++)
+	{
+		const sm::Vec3 &a = vertices[i * 3 + 0];
+		const sm::Vec3 &b = vertices[i * 3 + 1];
+		const sm::Vec3 &c = vertices[i * 3 + 2];
+
+		m_triangles[i] = i;
+		m_centroids[i].Set(
+			(a.x + b.x + c.x) / 3.0f,
+			(a.y + b.y + c.y) / 3.0f,
+			(a.z + b.z + c.z) / 3.0f);
+	}
+
+	if (trianglesCount == 0)
+		return;
+
+	m_nodes.reserve(trianglesCount * 2);
+	m_nodes.push_back(Node());
+
+	BuildNode(0, 0, trianglesCount);
+}
+
+void Bvh::BuildNode(int nodeIndex, int first, int count)
+{
+	sm::Vec3 min;
+	sm::Vec3 max;
+	GetBounds(first, count, min, max);
+
+	m_nodes[nodeIndex].boundsMin = min;
+	m_nodes[nodeIndex].boundsMax = max;
+	m_nodes[nodeIndex].first = first;
+	m_nodes[nodeIndex].count = count;
+
+	if (count <= MaxLeafTriangles)
+		return;
+
+	sm::Vec3 centroidsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	sm::Vec3 centroidsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (int i = first; i < first + count; i++)
+		Grow(centroidsMin, centroidsMax, m_centroids[m_triangles[i]]);
+
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = GetArea(min, max) * count;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float axisMin = GetAxis(centroidsMin, axis);
+		float axisMax = GetAxis(centroidsMax, axis);
+
+		if (axisMax <= axisMin)
+			continue;
+
+		BinIndex binIndex(m_centroids, axis, axisMin, BinsCount / (axisMax - axisMin), BinsCount);
+
+		std::vector<Bin> bins(BinsCount);
+
+		for (int i = first; i < first + count; i++)
+		{
+			int triangle = m_triangles[i];
+			Bin &bin = bins[binIndex(triangle)];
+
+			bin.count++;
+			for (int j = 0; j < 3; j++)
+				Grow(bin.min, bin.max, m_vertices[triangle * 3 + j]);
+		}
+
+		// area and count of everything right of each split
+		std::vector<float> rightAreas(BinsCount);
+		std::vector<int> rightCounts(BinsCount);
+
+		Bin right;
+		for (int i = BinsCount - 1; i > 0; i--)
+		{
+			right.count += bins[i].count;
+			if (bins[i].count > 0)
+			{
+				Grow(right.min, right.max, bins[i].min);
+				Grow(right.min, right.max, bins[i].max);
+			}
+
+			rightAreas[i] = right.count > 0 ? GetArea(right.min, right.max) : 0.0f;
+			rightCounts[i] = right.count;
+		}
+
+		Bin left;
+		for (int i = 1; i < BinsCount; i++)
+		{
+			left.count += bins[i - 1].count;
+			if (bins[i - 1].count > 0)
+			{
+				Grow(left.min, left.max, bins[i - 1].min);
+				Grow(left.min, left.max, bins[i - 1].max);
+			}
+
+			if (left.count == 0 || rightCounts[i] == 0)
+				continue;
+
+			float cost = GetArea(left.min, left.max) * left.count + rightAreas[i] * rightCounts[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	int middle;
+
+	if (bestAxis != -1)
+	{
+		float axisMin = GetAxis(centroidsMin, bestAxis);
+		float axisMax = GetAxis(centroidsMax, bestAxis);
+
+		BinIndex binIndex(m_centroids, bestAxis, axisMin, BinsCount / (axisMax - axisMin), BinsCount);
+
+		middle = (int)(std::partition(
+			m_triangles.begin() + first,
+			m_triangles.begin() + first + count,
+			BinBelow(binIndex, bestSplit)) - m_triangles.begin());
+	}
+	else
+	{
+		// splitting doesn't pay off, but leafs are kept small for the queries
+		if (count <= MaxLeafTriangles * 4)
+			return;
+
+		int axis = 0;
+		if (max.y - min.y > GetAxis(max, axis) - GetAxis(min, axis))
+			axis = 1;
+		if (max.z - min.z > GetAxis(max, axis) - GetAxis(min, axis))
+			axis = 2;
+
+		middle = first + count / 2;
+		std::nth_element(
+			m_triangles.begin() + first,
+			m_triangles.begin() + middle,
+			m_triangles.begin() + first + count,
+			CentroidOrder(m_centroids, axis));
+	}
+
+	int left = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+	m_nodes.push_back(Node());
+
+	m_nodes[nodeIndex].first = left;
+	m_nodes[nodeIndex].count = 0;
+
+	BuildNode(left, first, middle - first);
+	BuildNode(left + 1, middle, first + count - middle);
+}
+
+void Bvh::GetBounds(int first, int count, sm::Vec3 &min, sm::Vec3 &max) const
+{
+	min.Set(FLT_MAX, FLT_MAX, FLT_MAX);
+	max.Set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (int i = first; i < first + count; i++)
+	{
+		int triangle = m_triangles[i];
+
+		for (int j = 0; j < 3; j++)
+			Grow(min, max, m_vertices[triangle * 3 + j]);
+	}
+}
+
+float Bvh::FindClosest(const sm::Vec3 &point, float maxDistanceSq, int &triangle) const
+{
+	triangle = -1;
+
+	if (m_nodes.size() == 0)
+		return maxDistanceSq;
+
+	float bestDistanceSq = maxDistanceSq;
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (stack.size() > 0)
+	{
+		const Node &node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (GetDistanceSq(point, node.boundsMin, node.boundsMax) > bestDistanceSq)
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				int index = m_triangles[i];
+
+				float distanceSq = GetTriangleDistanceSq(
+					point,
+					m_vertices[index * 3 + 0],
+					m_vertices[index * 3 + 1],
+					m_vertices[index * 3 + 2]);
+
+				if (distanceSq <= bestDistanceSq)
+				{
+					bestDistanceSq = distanceSq;
+					triangle = index;
+				}
+			}
+
+			continue;
+		}
+
+		// nearer child goes on top, it shrinks the search radius for the other one
+		const Node &left = m_nodes[node.first];
+		const Node &right = m_nodes[node.first + 1];
+
+		float leftDistanceSq = GetDistanceSq(point, left.boundsMin, left.boundsMax);
+		float rightDistanceSq = GetDistanceSq(point, right.boundsMin, right.boundsMax);
+
+		if (leftDistanceSq < rightDistanceSq)
+		{
+			stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+		}
+		else
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+		}
+	}
+
+	return bestDistanceSq;
+}
+
+int Bvh::CountHits(const sm::Vec3 &origin, const sm::Vec3 &direction) const
+{
+	if (m_nodes.size() == 0)
+		return 0;
+
+	sm::Vec3 inverseDirection(
+		direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+		direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX,
+		direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX);
+
+	int hits = 0;
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (stack.size() > 0)
+	{
+		const Node &node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (!IntersectBox(origin, inverseDirection, node.boundsMin, node.boundsMax, FLT_MAX))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				int index = m_triangles[i];
+				float t;
+
+				if (IntersectTriangle(
+					origin,
+					direction,
+					m_vertices[index * 3 + 0],
+					m_vertices[index * 3 + 1],
+					m_vertices[index * 3 + 2],
+					t))
+				{
+					hits++;
+				}
+			}
+
+			continue;
+		}
+
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+
+	return hits;
+}
+
+bool Bvh::Intersects(const sm::Vec3 &origin, const sm::Vec3 &direction, float maxDistance) const
+{
+	if (m_nodes.size() == 0)
+		return false;
+
+	sm::Vec3 inverseDirection(
+		direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+		direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX,
+		direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX);
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (stack.size() > 0)
+	{
+		const Node &node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (!IntersectBox(origin, inverseDirection, node.boundsMin, node.boundsMax, maxDistance))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				int index = m_triangles[i];
+				float t;
+
+				if (IntersectTriangle(
+					origin,
+					direction,
+					m_vertices[index * 3 + 0],
+					m_vertices[index * 3 + 1],
+					m_vertices[index * 3 + 2],
+					t) && t < maxDistance)
+				{
+					return true;
+				}
+			}
+
+			continue;
+		}
+
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+
+	return false;
+}
+
+int Bvh::FindHit(const sm::Vec3 &origin, const sm::Vec3 &direction, float maxDistance, float &distance) const
+{
+	distance = maxDistance;
+
+	if (m_nodes.size() == 0)
+		return -1;
+
+	sm::Vec3 inverseDirection(
+		direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+		direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX,
+		direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX);
+
+	int triangle = -1;
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (stack.size() > 0)
+	{
+		const Node &node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		// the distance shrinks with every hit, so boxes behind it are skipped
+		if (!IntersectBox(origin, inverseDirection, node.boundsMin, node.boundsMax, distance))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				int index = m_triangles[i];
+				float t;
+
+				if (IntersectTriangle(
+					origin,
+					direction,
+					m_vertices[index * 3 + 0],
+					m_vertices[index * 3 + 1],
+					m_vertices[index * 3 + 2],
+					t) && t < distance)
+				{
+					distance = t;
+					triangle = index;
+				}
+			}
+
+			continue;
+		}
+
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+
+	return triangle;
+}
+
+bool Bvh::IsInside(const sm::Vec3 &point) const
+{
+	// parity of crossings along three skewed rays, the majority wins so a
+	// hole or a ray grazing an edge doesn't flip the sign
+	static const sm::Vec3 directions[3] =
+	{
+		sm::Vec3(1.0f, 0.0013f, 0.0029f),
+		sm::Vec3(0.0017f, 1.0f, 0.0031f),
+		sm::Vec3(0.0023f, 0.0011f, 1.0f)
+	};
+
+	int insideVotes = 0;
+
+	for (int i = 0; i < 3; i++)
+		if (CountHits(point, directions[i]) % 2 == 1)
+			insideVotes++;
+
+	return insideVotes >= 2;
+}
+
+float Bvh::GetArea(const sm::Vec3 &min, const sm::Vec3 &max)
+{
+	sm::Vec3 size = max - min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+float Bvh::GetDistanceSq(const sm::Vec3 &point, const sm::Vec3 &min, const sm::Vec3 &max)
+{
+	float dx = std::max(std::max(min.x - point.x, 0.0f), point.x - max.x);
+	float dy = std::max(std::max(min.y - point.y, 0.0f), point.y - max.y);
+	float dz = std::max(std::max(min.z - point.z, 0.0f), point.z - max.z);
+
+	return dx * dx + dy * dy + dz * dz;
+}
+
+float Bvh::GetTriangleDistanceSq(const sm::Vec3 &p, const sm::Vec3 &a, const sm::Vec3 &b, const sm::Vec3 &c)
+{
+	// closest point on triangle, by the voronoi regions of its features
+	sm::Vec3 ab = b - a;
+	sm::Vec3 ac = c - a;
+	sm::Vec3 ap = p - a;
+
+	sm::Vec3 closest;
+
+	float d1 = sm::Vec3::Dot(ab, ap);
+	float d2 = sm::Vec3::Dot(ac, ap);
+
+	sm::Vec3 bp = p - b;
+	float d3 = sm::Vec3::Dot(ab, bp);
+	float d4 = sm::Vec3::Dot(ac, bp);
+
+	sm::Vec3 cp = p - c;
+	float d5 = sm::Vec3::Dot(ab, cp);
+	float d6 = sm::Vec3::Dot(ac, cp);
+
+	float va = d3 * d6 - d5 * d4;
+	float vb = d5 * d2 - d1 * d6;
+	float vc = d1 * d4 - d3 * d2;
+
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		closest = a;
+	else if (d3 >= 0.0f && d4 <= d3)
+		closest = b;
+	else if (d6 >= 0.0f && d5 <= d6)
+		closest = c;
+	else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		closest = a + ab * (d1 / (d1 - d3));
+	else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		closest = a + ac * (d2 / (d2 - d6));
+	else if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	else
+	{
+		float sum = va + vb + vc;
+		if (sum == 0.0f)
+			closest = a; // degenerate triangle
+		else
+			closest = a + ab * (vb / sum) + ac * (vc / sum);
+	}
+
+	sm::Vec3 d = p - closest;
+	return sm::Vec3::Dot(d, d);
+}
+
+bool Bvh::IntersectBox(const sm::Vec3 &origin, const sm::Vec3 &inverseDirection, const sm::Vec3 &min, const sm::Vec3 &max, float maxDistance)
+{
+	float t1 = (min.x - origin.x) * inverseDirection.x;
+	float t2 = (max.x - origin.x) * inverseDirection.x;
+	float tMin = std::min(t1, t2);
+	float tMax = std::max(t1, t2);
+
+	t1 = (min.y - origin.y) * inverseDirection.y;
+	t2 = (max.y - origin.y) * inverseDirection.y;
+	tMin = std::max(tMin, std::min(t1, t2));
+	tMax = std::min(tMax, std::max(t1, t2));
+
+	t1 = (min.z - origin.z) * inverseDirection.z;
+	t2 = (max.z - origin.z) * inverseDirection.z;
+	tMin = std::max(tMin, std::min(t1, t2));
+	tMax = std::min(tMax, std::max(t1, t2));
+
+	return tMax >= std::max(tMin, 0.0f) && tMin <= maxDistance;
+}
+
+bool Bvh::IntersectTriangle(const sm::Vec3 &origin, const sm::Vec3 &direction, const sm::Vec3 &a, const sm::Vec3 &b, const sm::Vec3 &c, float &t)
+{
+	sm::Vec3 e1 = b - a;
+	sm::Vec3 e2 = c - a;
+
+	sm::Vec3 p(
+		direction.y * e2.z - direction.z * e2.y,
+		direction.z * e2.x - direction.x * e2.z,
+		direction.x * e2.y - direction.y * e2.x);
+
+	float det = sm::Vec3::Dot(e1, p);
+	if (det == 0.0f)
+		return false;
+
+	float inverseDet = 1.0f / det;
+
+	sm::Vec3 s = origin - a;
+	float u = sm::Vec3::Dot(s, p) * inverseDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	sm::Vec3 q(
+		s.y * e1.z - s.z * e1.y,
+		s.z * e1.x - s.x * e1.z,
+		s.x * e1.y - s.y * e1.x);
+
+	float v = sm::Vec3::Dot(direction, q) * inverseDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	t = sm::Vec3::Dot(e2, q) * inverseDet;
+
+	return t > 0.0f;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Math/Vec3.h>
+
+#include <vector>
+#include <stdint.h>
+
+// Bounding volume hierarchy over triangles, built with the surface area
+// heuristic. Triangles are given as vertices, three per triangle. Queries
+// are const and can run on many threads at once.
+class Bvh
+{
+public:
+	class Node
+	{
+	public:
+		sm::Vec3 boundsMin;
+		sm::Vec3 boundsMax;
+
+		// inner nodes: index of the left child, the right one follows it.
+		// leafs: first triangle in GetTriangles()
+		int first;
+
+		// triangles of a leaf, 0 for inner nodes
+		int count;
+	};
+
+	void Build(const std::vector<sm::Vec3> &vertices);
+
+	const std::vector<Node>& GetNodes() const { return m_nodes; }
+
+	// triangle indices referenced by the leafs
+	const std::vector<int>& GetTriangles() const { return m_triangles; }
+
+	// squared distance to the closest triangle not further than sqrt(maxDistanceSq),
+	// triangle is -1 when there's none
+	float FindClosest(const sm::Vec3 &point, float maxDistanceSq, int &triangle) const;
+
+	// number of triangles crossed by the ray going from origin to infinity
+	int CountHits(const sm::Vec3 &origin, const sm::Vec3 &direction) const;
+
+	// true when the ray hits any triangle closer than maxDistance
+	bool Intersects(const sm::Vec3 &origin, const sm::Vec3 &direction, float maxDistance) const;
+
+	// closest triangle hit by the ray not further than maxDistance, -1 when
+	// there's none. Distance is set to the hit's, in direction lengths.
+	int FindHit(const sm::Vec3 &origin, const sm::Vec3 &direction, float maxDistance, float &distance) const;
+
+	// true when the point is inside the closed surface of the triangles
+	bool IsInside(const sm::Vec3 &point) const;
+
+private:
+	static const int MaxLeafTriangles;
+	static const int BinsCount;
+
+	std::vector<sm::Vec3> m_vertices;
+	std::vector<sm::Vec3> m_centroids;
+	std::vector<int> m_triangles;
+	std::vector<Node> m_nodes;
+
+	void BuildNode(int nodeIndex, int first, int count);
+	void GetBounds(int first, int count, sm::Vec3 &min, sm::Vec3 &max) const;
+
+	static float GetArea(const sm::Vec3 &min, const sm::Vec3 &max);
+	static float GetDistanceSq(const sm::Vec3 &point, const sm::Vec3 &min, const sm::Vec3 &max);
+	static float GetTriangleDistanceSq(const sm::Vec3 &p, const sm::Vec3 &a, const sm::Vec3 &b, const sm::Vec3 &c);
+	static bool IntersectBox(const sm::Vec3 &origin, const sm::Vec3 &inverseDirection, const sm::Vec3 &min, const sm::Vec3 &max, float maxDistance);
+	static bool IntersectTriangle(const sm::Vec3 &origin, const sm::Vec3 &direction, const sm::Vec3 &a, const sm::Vec3 &b, const sm::Vec3 &c, float &t);
+};
@@ -0,0 +1,96 @@
+#include "FlatBvh.h"
+#include "Bvh.h"
+
+#include <math.h>
+
+void FlatBvh::Build(const Bvh &bvh)
+{
+	nodes.clear();
+	triangles.clear();
+
+	if (bvh.GetNodes().size() == 0)
+		return;
+
+	nodes.reserve(bvh.GetNodes().size());
+
+	// leafs cover consecutive ranges in depth first order already,
+	// so the triangle list can be taken as it is
+	const std::vector<int> &bvhTriangles = bvh.GetTriangles();
+	triangles.assign(bvhTriangles.begin(), bvhTriangles.end());
+
+	FlattenNode(bvh, 0);
+}
+
+void FlatBvh::FlattenNode(const Bvh &bvh, int nodeIndex)
+{
+	const Bvh::Node &bvhNode = bvh.GetNodes()[nodeIndex];
+
+	int flatIndex = (int)nodes.size();
+	nodes.push_back(Node());
+
+	Node &node = nodes.back();
+	node.boundsMin[0] = bvhNode.boundsMin.x;
+	node.boundsMin[1] = bvhNode.boundsMin.y;
+	node.boundsMin[2] = bvhNode.boundsMin.z;
+	node.boundsMax[0] = bvhNode.boundsMax.x;
+	node.boundsMax[1] = bvhNode.boundsMax.y;
+	node.boundsMax[2] = bvhNode.boundsMax.z;
+
+	if (bvhNode.count > 0)
+	{
+		node.offset = (uint32_t)bvhNode.first;
+		node.count = (uint16_t)bvhNode.count;
+		node.axis = 0;
+		return;
+	}
+
+	const Bvh::Node &left = bvh.GetNodes()[bvhNode.first];
+	const Bvh::Node &right = bvh.GetNodes()[bvhNode.first + 1];
+
+	// the axis the children's centers are furthest apart on
+	float centersDistance[3] =
+	{
+		fabsf((right.boundsMin.x + right.boundsMax.x) - (left.boundsMin.x + left.boundsMax.x)),
+		fabsf((right.boundsMin.y + right.boundsMax.y) - (left.boundsMin.y + left.boundsMax.y)),
+		fabsf((right.boundsMin.z + right.boundsMax.z) - (left.boundsMin.z + left.boundsMax.z))
+	};
+
+	uint16_t axis = 0;
+	if (centersDistance[1] > centersDistance[axis])
+		axis = 1;
+	if (centersDistance[2] > centersDistance[axis])
+		axis = 2;
+
+	// the vector may grow below, so the node isn't referenced after that
+	nodes[flatIndex].count = 0;
+	nodes[flatIndex].axis = axis;
+
+	FlattenNode(bvh, bvhNode.first);
+
+	nodes[flatIndex].offset = (uint32_t)nodes.size();
+
+	FlattenNode(bvh, bvhNode.first + 1);
+}
+
+void FlatBvh::Save(BinaryWriter &bw) const
+{
+	bw.Write((int)nodes.size());
+	bw.Write((int)triangles.size());
+
+	for (unsigned i = 0; i < nodes.size(); i++)
+	{
+		const Node &node = nodes[i];
+
+		for (int j = 0; j < 3; j++)
+			bw.Write(node.boundsMin[j]);
+		for (int j = 0; j < 3; j++)
+			bw.Write(node.boundsMax[j]);
+
+		bw.Write(node.offset);
+		bw.Write(node.count);
+		bw.Write(node.axis);
+	}
+
+	for (unsigned i = 0; i < triangles.size(); i++)
+		bw.Write(triangles[i]);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <IO/BinaryWriter.h>
+
+#include <vector>
+#include <stdint.h>
+
+class Bvh;
+
+// Bvh flattened for saving: 32 byte nodes in depth first order, so the
+// left child of an inner node is always right after it and a traversal
+// mostly walks forward through memory.
+class FlatBvh
+{
+public:
+	class Node
+	{
+	public:
+		float boundsMin[3];
+		float boundsMax[3];
+
+		// inner nodes: index of the right child. Leafs: first triangle in triangles
+		uint32_t offset;
+
+		// triangles of a leaf, 0 for inner nodes
+		uint16_t count;
+
+		// axis the children were split along, 0 - x, 1 - y, 2 - z. A ray going
+		// the negative way along it visits the right child first.
+		uint16_t axis;
+	};
+
+	std::vector<Node> nodes;
+
+	// triangle indices in the order of the original triangles given to the Bvh
+	std::vector<uint32_t> triangles;
+
+	void Build(const Bvh &bvh);
+
+	// int nodes count, int triangles count, the nodes, then uint32 triangle indices
+	void Save(BinaryWriter &bw) const;
+
+private:
+	void FlattenNode(const Bvh &bvh, int nodeIndex);
+};
@@ -1,4 +1,6 @@
 #include "GeoSaver.h"
+#include "MeshPartIndexer.h"
+#include "PropertyBlock.h"
 #include <Graphics/VertexInformation.h>
 #include <Utils/Log.h>
 #include <sstream>
@@ -27,126 +29,150 @@ void GeoSaver::SaveMesh(Scene3DMesh *mesh, BinaryWriter &bw)
 		SaveMeshPart(mesh ->meshParts[i], bw);
 
 	SaveProperties(mesh, bw);
+	SaveChunks(mesh, bw);
+}
+
+void GeoSaver::SaveChunks(Scene3DMesh *mesh, BinaryWriter &bw)
+{
+	bw.Write((int)mesh->chunks.size());
+
+	for (unsigned i = 0; i < mesh->chunks.size(); i++)
+	{
+		bw.Write(mesh->chunks[i]->tag, 4);
+		bw.Write((uint32_t)mesh->chunks[i]->data.size());
+		bw.Write(mesh->chunks[i]->data.c_str(), (uint32_t)mesh->chunks[i]->data.size());
+	}
 }
 
 void GeoSaver::SaveMeshPart(Scene3DMeshPart *meshPart, BinaryWriter &bw)
 {
 	bw.Write(meshPart ->materialName);
 	bw.Write(meshPart ->m_vertexType);
-	bw.Write((int)meshPart ->vertices.size());
 
-	for (int i = 0; i < (int)meshPart ->vertices.size(); i++)
+	if (meshPart->progressive != NULL)
 	{
-		Scene3DVertex *vert = meshPart ->vertices[i];
+		bw.Write((uint8_t)1); // progressive
+		SaveProgressive(meshPart, bw);
+		return;
+	}
 
-		bw.Write(vert ->position.x);
-		bw.Write(vert ->position.y);
-		bw.Write(vert ->position.z);
+	bw.Write((uint8_t)0); // indexed
 
-		if (VertexInformation::HasAttrib(meshPart->m_vertexType, VertexAttrib::Coords1))
-		{
-			bw.Write(vert ->coords1.x);
-			bw.Write(vert ->coords1.y);
-		}
+	if (meshPart->outOfCore != NULL)
+	{
+		bw.Write((int)meshPart->outOfCore->GetVerticesCount());
+		meshPart->outOfCore->SaveVertices(bw);
+		meshPart->outOfCore->SaveIndices(bw);
+		return;
+	}
 
-		if (VertexInformation::HasAttrib(meshPart->m_vertexType, VertexAttrib::Coords2))
-		{
-			bw.Write(vert ->coords2.x);
-			bw.Write(vert ->coords2.y);
-		}
-		if (VertexInformation::HasAttrib(meshPart->m_vertexType, VertexAttrib::Coords3))
-		{
-			bw.Write(vert ->coords3.x);
-			bw.Write(vert ->coords3.y);
-		}
+	bw.Write((int)meshPart ->vertices.size());
 
-		if (VertexInformation::HasAttrib(meshPart->m_vertexType, VertexAttrib::Normal))
-		{
-			bw.Write(vert ->normal.x);
-			bw.Write(vert ->normal.y);
-			bw.Write(vert ->normal.z);
-		}
+	for (int i = 0; i < (int)meshPart ->vertices.size(); i++)
+		SaveVertex(meshPart ->vertices[i], meshPart->m_vertexType, bw);
 
-		if (VertexInformation::HasAttrib(meshPart->m_vertexType, VertexAttrib::Tangent))
-		{
-			bw.Write(vert ->tangent.x);
-			bw.Write(vert ->tangent.y);
-			bw.Write(vert ->tangent.z);
-		}
-	}
+	uint8_t indexSize = MeshPartIndexer::GetIndexSize(meshPart);
+
+	bw.Write(indexSize);
+	bw.Write((int)meshPart->indices.size());
+	SaveIndices(meshPart->indices, indexSize, bw);
 }
 
-void GeoSaver::SaveProperties(Scene3DMesh *mesh, BinaryWriter &bw)
+void GeoSaver::SaveProgressive(Scene3DMeshPart *meshPart, BinaryWriter &bw)
 {
-	//bw.Write((int)mesh->properties.size());
+	const ProgressiveMesh *progressive = meshPart->progressive;
+	uint8_t indexSize = MeshPartIndexer::GetIndexSize(meshPart);
 
-	bw.Write((int)0);
-	return;
+	// totals first, so a reader can allocate its buffers before the splits come in
+	bw.Write((int)meshPart->vertices.size());
+	bw.Write(indexSize);
+	bw.Write((int)meshPart->indices.size());
 
-	for (unsigned i = 0; i < mesh->properties.size(); i++)
-		SaveProperty(mesh->properties[i], bw);
+	bw.Write((int)progressive->baseVerticesCount);
+	for (uint32_t i = 0; i < progressive->baseVerticesCount; i++)
+		SaveVertex(meshPart->vertices[i], meshPart->m_vertexType, bw);
+
+	bw.Write((int)progressive->baseIndices.size());
+	SaveIndices(progressive->baseIndices, indexSize, bw);
+
+	bw.Write((int)progressive->splits.size());
+
+	for (unsigned i = 0; i < progressive->splits.size(); i++)
+	{
+		const ProgressiveMesh::VertexSplit &split = progressive->splits[i];
+
+		bw.Write(split.error);
+		SaveVertex(meshPart->vertices[progressive->baseVerticesCount + i], meshPart->m_vertexType, bw);
+
+		bw.Write((int)split.triangles.size() / 3);
+		SaveIndices(split.triangles, indexSize, bw);
+
+		bw.Write((int)split.corners.size());
+		for (unsigned j = 0; j < split.corners.size(); j++)
+			bw.Write(split.corners[j]);
+	}
 }
 
-void GeoSaver::SaveProperty(Property *prop, BinaryWriter &bw)
+void GeoSaver::SaveIndices(const std::vector<uint32_t> &indices, uint8_t indexSize, BinaryWriter &bw)
 {
-	bw.Write(prop->GetName());
-	bw.Write((BYTE)prop->GetPropertyType());
-	bw.Write((BYTE)prop->GetAnimationType());
-
-	if (!prop->IsAnimatable())
+	if (indexSize == 2)
 	{
-		switch (prop->GetPropertyType())
-		{
-		case Property::PropertyType_Boolean: bw.Write(prop->GetBoolValue()); break;
-		case Property::PropertyType_Int: bw.Write(prop->GetIntValue()); break;
-		case Property::PropertyType_Float: bw.Write(prop->GetFloatValue()); break;
-		case Property::PropertyType_Vector3:
-			bw.Write(prop->GetVector3Value().x);
-			bw.Write(prop->GetVector3Value().y);
-			bw.Write(prop->GetVector3Value().z);
-			break;
-
-		case Property::PropertyType_String: bw.Write(prop->GetStringValue()); break;
-		}
+		for (unsigned i = 0; i < indices.size(); i++)
+			bw.Write((uint16_t)indices[i]);
 	}
 	else
 	{
-		if (prop->GetPropertyType() == Property::PropertyType_Float)
-		{
-			IInterpolator<float> *inter = prop->GetInterpolator<float>();
+		for (unsigned i = 0; i < indices.size(); i++)
+			bw.Write((uint32_t)indices[i]);
+	}
+}
 
-			bw.Write(inter->GetKeysCount());
+void GeoSaver::SaveVertex(Scene3DVertex *vert, uint8_t vertexType, BinaryWriter &bw)
+{
+	bw.Write(vert ->position.x);
+	bw.Write(vert ->position.y);
+	bw.Write(vert ->position.z);
 
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
-			{
-				float value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords1))
+	{
+		bw.Write(vert ->coords1.x);
+		bw.Write(vert ->coords1.y);
+	}
 
-				bw.Write(time);
-				bw.Write(value);
-			}
-		}
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords2))
+	{
+		bw.Write(vert ->coords2.x);
+		bw.Write(vert ->coords2.y);
+	}
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Coords3))
+	{
+		bw.Write(vert ->coords3.x);
+		bw.Write(vert ->coords3.y);
+	}
 
-		if (prop->GetPropertyType() == Property::PropertyType_Int)
-		{
-			IInterpolator<int> *inter = prop->GetInterpolator<int>();
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Normal))
+	{
+		bw.Write(vert ->normal.x);
+		bw.Write(vert ->normal.y);
+		bw.Write(vert ->normal.z);
+	}
 
-			bw.Write(inter->GetKeysCount());
+	if (VertexInformation::HasAttrib(vertexType, VertexAttrib::Tangent))
+	{
+		bw.Write(vert ->tangent.x);
+		bw.Write(vert ->tangent.y);
+		bw.Write(vert ->tangent.z);
+	}
+}
 
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
-			{
-				int value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
+void GeoSaver::SaveProperties(Scene3DMesh *mesh, BinaryWriter &bw)
+{
+	std::string block;
+	PropertyBlock::Build(mesh->properties, block);
 
-				bw.Write(time);
-				bw.Write(value);
-			}
-		}
-	}
+	bw.Write((int)mesh->properties.size());
+	bw.Write((uint32_t)block.size());
+	bw.Write(block.c_str(), (uint32_t)block.size());
 }
 
 void GeoSaver::SavePropertiesTxt(Scene3DMesh *mesh, BinaryWriter &bw)
@@ -183,32 +209,17 @@ void GeoSaver::SavePropertyTxt(Property *prop, BinaryWriter &bw, std::stringstre
 	{
 		data << "\t<property name=\"" << prop->GetName() << "\" type=\"" << prop->GetPropertyType() << "\" anim=\"" << prop->IsAnimatable() << "\" anim_type=\"" << prop->GetAnimationType() << "\">\n";
 
-		if (prop->GetPropertyType() == Property::PropertyType_Float)
-		{
-			IInterpolator<float> *inter = prop->GetInterpolator<float>();
-
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
-			{
-				float value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
-				data << "\t\t<key time=\"" << time << "\" value=\"" << value << "\" />\n";
-			}
-		}
+		const std::vector<float> &times = prop->GetKeyTimes();
+		const std::vector<Property::Value> &values = prop->GetKeyValues();
 
-		if (prop->GetPropertyType() == Property::PropertyType_Int)
+		for (unsigned i = 0; i < times.size(); i++)
 		{
-			IInterpolator<int> *inter = prop->GetInterpolator<int>();
-
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
-			{
-				int value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
-				data << "\t\t<key time=\"" << time << "\" value=\"" << value << "\" />\n";
-			}
+			data << "\t\t<key time=\"" << times[i] << "\" value=\"";
+
+			for (unsigned j = 0; j < prop->GetComponentsCount(); j++)
+				data << (j > 0 ? "," : "") << prop->GetComponent(values[i], j);
+
+			data << "\" />\n";
 		}
 
 		data << "\t</property>\n";
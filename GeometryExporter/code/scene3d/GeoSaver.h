@@ -17,8 +17,11 @@ public:
 	static void SaveMeshes(std::vector<Scene3DMesh*> &meshes, std::ostream &os);
 	static void SaveMesh(Scene3DMesh *mesh, BinaryWriter &bw);
 	static void SaveProperties(Scene3DMesh *mesh, BinaryWriter &bw);
-	static void SaveProperty(Property *prop, BinaryWriter &bw);
+	static void SaveChunks(Scene3DMesh *mesh, BinaryWriter &bw);
 	static void SavePropertiesTxt(Scene3DMesh *mesh, BinaryWriter &bw);
 	static void SavePropertyTxt(Property *prop, BinaryWriter &bw, std::stringstream &data);
 	static void SaveMeshPart(Scene3DMeshPart *meshPart, BinaryWriter &bw);
+	static void SaveProgressive(Scene3DMeshPart *meshPart, BinaryWriter &bw);
+	static void SaveIndices(const std::vector<uint32_t> &indices, uint8_t indexSize, BinaryWriter &bw);
+	static void SaveVertex(Scene3DVertex *vert, uint8_t vertexType, BinaryWriter &bw);
 };
@@ -0,0 +1,277 @@
+#include "MeshPartIndexer.h"
+#include <Graphics/VertexInformation.h>
+#include <Utils/Log.h>
+
+#include <unordered_map>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+
+namespace
+{
+	uint32_t FloatBits(float value)
+	{
+		if (value == 0.0f)
+			value = 0.0f; // -0.0 and 0.0 must land in the same bucket
+
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(float));
+		return bits;
+	}
+
+	void HashCombine(size_t &hash, float value)
+	{
+		hash ^= FloatBits(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+
+	class VertexHash
+	{
+	public:
+		VertexHash(uint8_t vertexType) : m_vertexType(vertexType) {}
+
+		size_t operator()(const Scene3DVertex *vert) const
+		{
+			size_t hash = 0;
+
+			HashCombine(hash, vert->position.x);
+			HashCombine(hash, vert->position.y);
+			HashCombine(hash, vert->position.z);
+
+			if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Coords1))
+			{
+				HashCombine(hash, vert->coords1.x);
+				HashCombine(hash, vert->coords1.y);
+			}
+
+			if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Normal))
+			{
+				HashCombine(hash, vert->normal.x);
+				HashCombine(hash, vert->normal.y);
+				HashCombine(hash, vert->normal.z);
+			}
+
+			return hash;
+		}
+
+	private:
+		uint8_t m_vertexType;
+	};
+
+	class VertexEqual
+	{
+	public:
+		VertexEqual(uint8_t vertexType) : m_vertexType(vertexType) {}
+
+		bool operator()(const Scene3DVertex *a, const Scene3DVertex *b) const
+		{
+			if (a->position.x != b->position.x || a->position.y != b->position.y || a->position.z != b->position.z)
+				return false;
+
+			if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Coords1) &&
+				(a->coords1.x != b->coords1.x || a->coords1.y != b->coords1.y))
+				return false;
+
+			if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Coords2) &&
+				(a->coords2.x != b->coords2.x || a->coords2.y != b->coords2.y))
+				return false;
+
+			if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Coords3) &&
+				(a->coords3.x != b->coords3.x || a->coords3.y != b->coords3.y))
+				return false;
+
+			if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Normal) &&
+				(a->normal.x != b->normal.x || a->normal.y != b->normal.y || a->normal.z != b->normal.z))
+				return false;
+
+			if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Tangent) &&
+				(a->tangent.x != b->tangent.x || a->tangent.y != b->tangent.y || a->tangent.z != b->tangent.z ||
+				a->tangentSign != b->tangentSign))
+				return false;
+
+			return true;
+		}
+
+	private:
+		uint8_t m_vertexType;
+	};
+
+	class TriangleOrder
+	{
+	public:
+		TriangleOrder(const std::vector<uint32_t> &codes) : m_codes(codes) {}
+
+		bool operator()(uint32_t a, uint32_t b) const
+		{
+			if (m_codes[a] != m_codes[b])
+				return m_codes[a] < m_codes[b];
+
+			return a < b;
+		}
+
+	private:
+		const std::vector<uint32_t> &m_codes;
+	};
+
+	Scene3DMeshPart* CreateChunk(const Scene3DMeshPart *meshPart)
+	{
+		Scene3DMeshPart *chunk = new Scene3DMeshPart();
+		chunk->materialName = meshPart->materialName;
+		chunk->m_vertexType = meshPart->m_vertexType;
+		chunk->useWire = meshPart->useWire;
+		return chunk;
+	}
+}
+
+void MeshPartIndexer::Weld(Scene3DMeshPart *meshPart)
+{
+	if (meshPart->indices.size() > 0)
+		return;
+
+	typedef std::unordered_map<const Scene3DVertex*, uint32_t, VertexHash, VertexEqual> VertexMap;
+
+	VertexMap uniqueVertices(
+		meshPart->vertices.size(),
+		VertexHash(meshPart->m_vertexType),
+		VertexEqual(meshPart->m_vertexType));
+
+	std::vector<Scene3DVertex*> vertices;
+	vertices.reserve(meshPart->vertices.size() / 2);
+
+	meshPart->indices.resize(meshPart->vertices.size());
+
+	for (unsigned i = 0; i < meshPart->vertices.size(); i++)
+	{
+		Scene3DVertex *vert = meshPart->vertices[i];
+
+		VertexMap::iterator it = uniqueVertices.find(vert);
+		if (it != uniqueVertices.end())
+		{
+			meshPart->indices[i] = it->second;
+			delete vert;
+		}
+		else
+		{
+			uint32_t index = (uint32_t)vertices.size();
+			uniqueVertices[vert] = index;
+			vertices.push_back(vert);
+			meshPart->indices[i] = index;
+		}
+	}
+
+	Log::LogT("welded %d corners into %d vertices", (int)meshPart->indices.size(), (int)vertices.size());
+
+	meshPart->vertices.swap(vertices);
+}
+
+void MeshPartIndexer::Split(Scene3DMeshPart *meshPart, unsigned maxVertices, std::vector<Scene3DMeshPart*> &chunks)
+{
+	assert(maxVertices >= 3);
+
+	unsigned firstChunk = (unsigned)chunks.size();
+	unsigned trianglesCount = (unsigned)meshPart->indices.size() / 3;
+	if (trianglesCount == 0)
+		return;
+
+	sm::Vec3 min = meshPart->vertices[0]->position;
+	sm::Vec3 max = min;
+
+	for (unsigned i = 1; i < meshPart->vertices.size(); i++)
+	{
+		const sm::Vec3 &p = meshPart->vertices[i]->position;
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max.Set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	float sizeX = max.x - min.x > 0.0f ? max.x - min.x : 1.0f;
+	float sizeY = max.y - min.y > 0.0f ? max.y - min.y : 1.0f;
+	float sizeZ = max.z - min.z > 0.0f ? max.z - min.z : 1.0f;
+
+	std::vector<uint32_t> codes(trianglesCount);
+	std::vector<uint32_t> order(trianglesCount);
+
+	for (unsigned i = 0; i < trianglesCount; i++)
+	{
+		const sm::Vec3 &a = meshPart->vertices[meshPart->indices[i * 3 + 0]]->position;
+		const sm::Vec3 &b = meshPart->vertices[meshPart->indices[i * 3 + 1]]->position;
+		const sm::Vec3 &c = meshPart->vertices[meshPart->indices[i * 3 + 2]]->position;
+
+		codes[i] = MortonCode(
+			((a.x + b.x + c.x) / 3.0f - min.x) / sizeX,
+			((a.y + b.y + c.y) / 3.0f - min.y) / sizeY,
+			((a.z + b.z + c.z) / 3.0f - min.z) / sizeZ);
+		order[i] = i;
+	}
+
+	std::sort(order.begin(), order.end(), TriangleOrder(codes));
+
+	// maps vertex of the source part to the vertex of the current chunk
+	std::vector<int> remap(meshPart->vertices.size(), -1);
+	std::vector<uint32_t> used;
+
+	Scene3DMeshPart *chunk = CreateChunk(meshPart);
+
+	for (unsigned i = 0; i < trianglesCount; i++)
+	{
+		const uint32_t *triangle = &meshPart->indices[order[i] * 3];
+
+		unsigned newVertices = 0;
+		for (int j = 0; j < 3; j++)
+			if (remap[triangle[j]] == -1)
+				newVertices++;
+
+		if (chunk->vertices.size() + newVertices > maxVertices)
+		{
+			chunks.push_back(chunk);
+			chunk = CreateChunk(meshPart);
+
+			for (unsigned j = 0; j < used.size(); j++)
+				remap[used[j]] = -1;
+			used.clear();
+		}
+
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t index = triangle[j];
+
+			if (remap[index] == -1)
+			{
+				remap[index] = (int)chunk->vertices.size();
+				chunk->vertices.push_back(new Scene3DVertex(*meshPart->vertices[index]));
+				used.push_back(index);
+			}
+
+			chunk->indices.push_back((uint32_t)remap[index]);
+		}
+	}
+
+	chunks.push_back(chunk);
+
+	Log::LogT("part with %d vertices split into %d chunks", (int)meshPart->vertices.size(), (int)(chunks.size() - firstChunk));
+}
+
+uint8_t MeshPartIndexer::GetIndexSize(const Scene3DMeshPart *meshPart)
+{
+	return meshPart->vertices.size() <= MaxVertices16Bit ? 2 : 4;
+}
+
+uint32_t MeshPartIndexer::MortonCode(float x, float y, float z)
+{
+	uint32_t coords[3] =
+	{
+		(uint32_t)std::min(std::max(x * 1024.0f, 0.0f), 1023.0f),
+		(uint32_t)std::min(std::max(y * 1024.0f, 0.0f), 1023.0f),
+		(uint32_t)std::min(std::max(z * 1024.0f, 0.0f), 1023.0f)
+	};
+
+	for (int i = 0; i < 3; i++)
+	{
+		uint32_t v = coords[i];
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		coords[i] = v;
+	}
+
+	return coords[0] * 4 + coords[1] * 2 + coords[2];
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Scene3DMeshPart.h"
+
+class MeshPartIndexer
+{
+public:
+	static const unsigned MaxVertices16Bit = 65535;
+
+	// Replaces the per-corner vertex soup of the part with unique vertices and
+	// an index buffer. Only attributes present in the part's vertex type are compared.
+	static void Weld(Scene3DMeshPart *meshPart);
+
+	// Splits an indexed part into chunks that reference at most maxVertices
+	// vertices each. Triangles are taken in Morton order of their centroids,
+	// so each chunk covers a compact region and keeps most of its vertices shared.
+	// Chunks are appended to the vector, the source part is left untouched.
+	static void Split(Scene3DMeshPart *meshPart, unsigned maxVertices, std::vector<Scene3DMeshPart*> &chunks);
+
+	// Size of a single index in bytes, the smallest one that can address every vertex of the part.
+	static uint8_t GetIndexSize(const Scene3DMeshPart *meshPart);
+
+private:
+	static uint32_t MortonCode(float x, float y, float z);
+};
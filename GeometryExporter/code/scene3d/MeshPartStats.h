@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Math\Vec3.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "Scene3DMeshPart.h"
+
+class MeshPartStats
+{
+public:
+	// size of the simulated post-transform vertex cache used for ACMR
+	static const unsigned CacheSize = 32;
+
+	class AttribBytes
+	{
+	public:
+		const char *name;
+		unsigned bytes;
+
+		AttribBytes(const char *name, unsigned bytes) :
+			name(name),
+			bytes(bytes)
+		{
+		}
+	};
+
+	std::string materialName;
+
+	unsigned cornersCount;
+	unsigned uniqueVerticesCount;
+	unsigned storedVerticesCount;
+
+	// bytes taken by every vertex attribute stream of the part, in file order
+	std::vector<AttribBytes> attribBytes;
+	unsigned vertexSize;
+	unsigned indexSize;
+
+	// average cache miss ratio, negative when the index stream isn't in memory
+	float acmr;
+
+	sm::Vec3 boundsMin;
+	sm::Vec3 boundsMax;
+
+	MeshPartStats();
+
+	// has to be called after the part is indexed
+	void Collect(const Scene3DMeshPart *meshPart);
+
+	float GetRedundancy() const;
+	unsigned GetVerticesBytes() const;
+	unsigned GetIndicesBytes() const;
+
+	// vertex shader invocations per triangle with a FIFO cache of cacheSize entries
+	static float CalculateAcmr(const std::vector<uint32_t> &indices, unsigned verticesCount, unsigned cacheSize);
+
+private:
+	void CollectAttribBytes(uint8_t vertexType);
+};
@@ -0,0 +1,198 @@
+#include "OccluderBaker.h"
+#include "Bvh.h"
+#include "../ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	class VolumeOrder
+	{
+	public:
+		bool operator()(const OccluderBaker::Box &a, const OccluderBaker::Box &b) const
+		{
+			sm::Vec3 sizeA = a.max - a.min;
+			sm::Vec3 sizeB = b.max - b.min;
+
+			return sizeA.x * sizeA.y * sizeA.z > sizeB.x * sizeB.y * sizeB.z;
+		}
+	};
+}
+
+class OccluderBaker::SliceClassifier
+{
+public:
+	SliceClassifier(
+		const Bvh &bvh,
+		const sm::Vec3 &origin,
+		float voxelSize,
+		int sizeX,
+		int sizeY,
+		std::vector<uint8_t> &solid) :
+		m_bvh(bvh),
+		m_origin(origin),
+		m_voxelSize(voxelSize),
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_solid(solid)
+	{
+	}
+
+	void operator()(int z)
+	{
+		// no triangle closer to the center than the corners are means the voxel
+		// doesn't touch the surface, so it is inside or outside as a whole
+		float halfDiagonal = m_voxelSize * 0.8661f;
+		float halfDiagonalSq = halfDiagonal * halfDiagonal;
+
+		for (int y = 0; y < m_sizeY; y++)
+		{
+			for (int x = 0; x < m_sizeX; x++)
+			{
+				sm::Vec3 center(
+					m_origin.x + (x + 0.5f) * m_voxelSize,
+					m_origin.y + (y + 0.5f) * m_voxelSize,
+					m_origin.z + (z + 0.5f) * m_voxelSize);
+
+				int triangle;
+				m_bvh.FindClosest(center, halfDiagonalSq, triangle);
+
+				m_solid[(z * m_sizeY + y) * m_sizeX + x] = triangle == -1 && m_bvh.IsInside(center) ? 1 : 0;
+			}
+		}
+	}
+
+private:
+	const Bvh &m_bvh;
+	sm::Vec3 m_origin;
+	float m_voxelSize;
+	int m_sizeX;
+	int m_sizeY;
+	std::vector<uint8_t> &m_solid;
+};
+
+void OccluderBaker::Bake(const std::vector<sm::Vec3> &vertices, int resolution, int maxBoxes, std::vector<Box> &boxes)
+{
+	boxes.clear();
+
+	if (vertices.size() < 3 || resolution < 1)
+		return;
+
+	sm::Vec3 min = vertices[0];
+	sm::Vec3 max = vertices[0];
+
+	for (unsigned i = 1; i < vertices.size(); i++)
+	{
+		const sm::Vec3 &p = vertices[i];
+
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max.Set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	float longestSide = std::max(std::max(max.x - min.x, max.y - min.y), max.z - min.z);
+	if (longestSide <= 0.0f)
+		return;
+
+	float voxelSize = longestSide / resolution;
+
+	int sizeX = std::max((int)ceilf((max.x - min.x) / voxelSize), 1);
+	int sizeY = std::max((int)ceilf((max.y - min.y) / voxelSize), 1);
+	int sizeZ = std::max((int)ceilf((max.z - min.z) / voxelSize), 1);
+
+	Bvh bvh;
+	bvh.Build(vertices);
+
+	std::vector<uint8_t> solid(sizeX * sizeY * sizeZ);
+
+	SliceClassifier sliceClassifier(bvh, min, voxelSize, sizeX, sizeY, solid);
+	ParallelFor::Run(sizeZ, sliceClassifier);
+
+	// greedy merge: grow a box from the first free voxel along x, then y, then z,
+	// as long as the whole new row or slab is solid and free
+	for (int z = 0; z < sizeZ; z++)
+	{
+		for (int y = 0; y < sizeY; y++)
+		{
+			for (int x = 0; x < sizeX; x++)
+			{
+				if (solid[(z * sizeY + y) * sizeX + x] != 1)
+					continue;
+
+				int endX = x + 1;
+				while (endX < sizeX && solid[(z * sizeY + y) * sizeX + endX] == 1)
+					endX++;
+
+				int endY = y + 1;
+				for (bool grow = true; grow && endY < sizeY; )
+				{
+					for (int i = x; i < endX && grow; i++)
+						grow = solid[(z * sizeY + endY) * sizeX + i] == 1;
+
+					if (grow)
+						endY++;
+				}
+
+				int endZ = z + 1;
+				for (bool grow = true; grow && endZ < sizeZ; )
+				{
+					for (int j = y; j < endY && grow; j++)
+						for (int i = x; i < endX && grow; i++)
+							grow = solid[(endZ * sizeY + j) * sizeX + i] == 1;
+
+					if (grow)
+						endZ++;
+				}
+
+				// 2 marks voxels taken by a box
+				for (int k = z; k < endZ; k++)
+					for (int j = y; j < endY; j++)
+						for (int i = x; i < endX; i++)
+							solid[(k * sizeY + j) * sizeX + i] = 2;
+
+				Box box;
+				box.min = min + sm::Vec3((float)x, (float)y, (float)z) * voxelSize;
+				box.max = min + sm::Vec3((float)endX, (float)endY, (float)endZ) * voxelSize;
+				boxes.push_back(box);
+			}
+		}
+	}
+
+	std::stable_sort(boxes.begin(), boxes.end(), VolumeOrder());
+
+	if ((int)boxes.size() > maxBoxes)
+		boxes.resize(maxBoxes);
+}
+
+void OccluderBaker::BuildMesh(const std::vector<Box> &boxes, std::vector<sm::Vec3> &positions, std::vector<uint32_t> &indices)
+{
+	// corner i has max x when bit 0 is set, max y for bit 1, max z for bit 2
+	static const uint32_t faces[36] =
+	{
+		0, 4, 6,  0, 6, 2, // -x
+		1, 3, 7,  1, 7, 5, // +x
+		0, 1, 5,  0, 5, 4, // -y
+		2, 6, 7,  2, 7, 3, // +y
+		0, 2, 3,  0, 3, 1, // -z
+		4, 5, 7,  4, 7, 6  // +z
+	};
+
+	positions.clear();
+	indices.clear();
+
+	for (unsigned i = 0; i < boxes.size(); i++)
+	{
+		uint32_t first = (uint32_t)positions.size();
+
+		for (int j = 0; j < 8; j++)
+		{
+			positions.push_back(sm::Vec3(
+				(j & 1) ? boxes[i].max.x : boxes[i].min.x,
+				(j & 2) ? boxes[i].max.y : boxes[i].min.y,
+				(j & 4) ? boxes[i].max.z : boxes[i].min.z));
+		}
+
+		for (int j = 0; j < 36; j++)
+			indices.push_back(first + faces[j]);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Math/Vec3.h>
+
+#include <vector>
+#include <stdint.h>
+
+// Conservative occluder for a closed mesh: voxels lying fully inside the
+// mesh, merged greedily into boxes, the largest of them kept. The occluder
+// never covers anything the mesh doesn't, so culling with it can't hide
+// visible objects.
+class OccluderBaker
+{
+public:
+	class Box
+	{
+	public:
+		sm::Vec3 min;
+		sm::Vec3 max;
+	};
+
+	// resolution is the voxels count along the longest side of the bounds.
+	// Boxes are sorted by volume, largest first, at most maxBoxes of them.
+	static void Bake(const std::vector<sm::Vec3> &vertices, int resolution, int maxBoxes, std::vector<Box> &boxes);
+
+	// 8 corners and 12 triangles per box, counter clockwise seen from outside
+	static void BuildMesh(const std::vector<Box> &boxes, std::vector<sm::Vec3> &positions, std::vector<uint32_t> &indices);
+
+private:
+	// marks solid voxels of one z slice, run by ParallelFor
+	class SliceClassifier;
+};
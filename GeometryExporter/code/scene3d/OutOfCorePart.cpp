@@ -0,0 +1,606 @@
+#include "OutOfCorePart.h"
+#include "MeshPartIndexer.h"
+#include "GeoSaver.h"
+#include <Graphics/VertexInformation.h>
+#include <Utils/Log.h>
+
+#include <windows.h>
+#include <unordered_map>
+#include <algorithm>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+namespace
+{
+	const uint32_t NoIndex = 0xffffffff;
+
+	class PackedVertexRef
+	{
+	public:
+		const void *data;
+		size_t size;
+	};
+
+	class PackedVertexHash
+	{
+	public:
+		size_t operator()(const PackedVertexRef &ref) const
+		{
+			// FNV-1a
+			const uint8_t *bytes = (const uint8_t*)ref.data;
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < ref.size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+	};
+
+	class PackedVertexEqual
+	{
+	public:
+		bool operator()(const PackedVertexRef &a, const PackedVertexRef &b) const
+		{
+			return memcmp(a.data, b.data, a.size) == 0;
+		}
+	};
+
+	float CanonicalFloat(float value)
+	{
+		return value == 0.0f ? 0.0f : value;
+	}
+
+	template <typename T>
+	bool ReadFile(const std::string &fileName, std::vector<T> &records)
+	{
+		std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+		if (file.fail())
+			return false;
+
+		std::streamoff size = file.tellg();
+		file.seekg(0, std::ios::beg);
+
+		records.resize((size_t)(size / sizeof(T)));
+		if (records.size() > 0)
+			file.read((char*)&records[0], records.size() * sizeof(T));
+
+		return !file.fail();
+	}
+
+	// next records of an open file, false at its end
+	template <typename T>
+	bool ReadRecords(std::ifstream &file, unsigned capacity, std::vector<T> &records)
+	{
+		records.resize(capacity);
+		file.read((char*)&records[0], capacity * sizeof(T));
+		records.resize((size_t)file.gcount() / sizeof(T));
+
+		return records.size() > 0;
+	}
+
+	// temporary files are reopened for every buffer, so their count isn't
+	// limited by the handles the CRT can keep open
+	template <typename T>
+	bool AppendRecords(const std::string &fileName, std::vector<T> &records)
+	{
+		if (records.size() == 0)
+			return true;
+
+		std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::app);
+		file.write((const char*)&records[0], records.size() * sizeof(T));
+		records.clear();
+
+		return !file.fail();
+	}
+
+	bool CreateEmptyFile(const std::string &fileName)
+	{
+		std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+		if (file.fail())
+		{
+			Log::LogT("error: couldn't create temporary file '%s'", fileName.c_str());
+			return false;
+		}
+
+		return true;
+	}
+}
+
+OutOfCorePart::OutOfCorePart(
+	uint8_t vertexType,
+	unsigned cornersCount,
+	unsigned memoryBudget,
+	const std::string &tempDir) :
+	m_vertexType(vertexType),
+	m_cornersCount(cornersCount),
+	m_memoryBudget(memoryBudget),
+	m_tempDir(tempDir),
+	m_addedCorners(0),
+	m_verticesCount(0),
+	m_writeFailed(false)
+{
+	m_boundsMin.Set(0.0f, 0.0f, 0.0f);
+	m_boundsMax.Set(0.0f, 0.0f, 0.0f);
+
+	static unsigned partsCounter = 0;
+	m_id = ++partsCounter;
+
+	unsigned recordsPerBucket = std::max(memoryBudget / (unsigned)(sizeof(CornerRecord) + WeldOverhead), (unsigned)BufferRecords);
+	m_bucketsCount = std::max((cornersCount + recordsPerBucket - 1) / recordsPerBucket, 1u);
+
+	// a range needs its index array and its records loaded at the same time
+	m_rangeSize = std::max(memoryBudget / (unsigned)(sizeof(uint32_t) + sizeof(IndexRecord)), (unsigned)BufferRecords);
+	m_rangesCount = std::max((cornersCount + m_rangeSize - 1) / m_rangeSize, 1u);
+}
+
+OutOfCorePart::~OutOfCorePart()
+{
+	RemoveFiles();
+}
+
+bool OutOfCorePart::Begin()
+{
+	Log::LogT("out of core part: %d corners, %d buckets, %d index ranges",
+		m_cornersCount, m_bucketsCount, m_rangesCount);
+
+	for (unsigned i = 0; i < m_bucketsCount; i++)
+	{
+		m_bucketFiles.push_back(CreateTempFileName("bucket", i));
+		if (!CreateEmptyFile(m_bucketFiles[i]))
+			return false;
+	}
+
+	m_bucketBuffers.resize(m_bucketsCount);
+	for (unsigned i = 0; i < m_bucketsCount; i++)
+		m_bucketBuffers[i].reserve(BufferRecords);
+
+	return true;
+}
+
+void OutOfCorePart::AddCorners(const std::vector<Scene3DVertex> &corners)
+{
+	assert(m_addedCorners + corners.size() <= m_cornersCount);
+
+	for (unsigned i = 0; i < corners.size(); i++)
+	{
+		CornerRecord record;
+		Pack(corners[i], record.vertex);
+
+		const sm::Vec3 &p = corners[i].position;
+		if (m_addedCorners == 0)
+		{
+			m_boundsMin = p;
+			m_boundsMax = p;
+		}
+		else
+		{
+			m_boundsMin.Set(std::min(m_boundsMin.x, p.x), std::min(m_boundsMin.y, p.y), std::min(m_boundsMin.z, p.z));
+			m_boundsMax.Set(std::max(m_boundsMax.x, p.x), std::max(m_boundsMax.y, p.y), std::max(m_boundsMax.z, p.z));
+		}
+
+		record.corner = m_addedCorners++;
+
+		unsigned bucket = Hash(record.vertex) % m_bucketsCount;
+
+		m_bucketBuffers[bucket].push_back(record);
+		if (m_bucketBuffers[bucket].size() == BufferRecords)
+			FlushBucket(bucket);
+	}
+}
+
+bool OutOfCorePart::Finish()
+{
+	for (unsigned i = 0; i < m_bucketsCount; i++)
+		FlushBucket(i);
+
+	m_bucketBuffers.clear();
+
+	if (m_writeFailed)
+		return false;
+
+	if (m_addedCorners != m_cornersCount)
+		Log::LogT("warning: expected %d corners, got %d", m_cornersCount, m_addedCorners);
+
+	m_cornersCount = m_addedCorners;
+
+	for (unsigned i = 0; i < m_rangesCount; i++)
+	{
+		m_firstFiles.push_back(CreateTempFileName("first", i));
+		m_linkFiles.push_back(CreateTempFileName("link", i));
+		m_rangeFiles.push_back(CreateTempFileName("range", i));
+
+		if (!CreateEmptyFile(m_firstFiles[i]) ||
+			!CreateEmptyFile(m_linkFiles[i]) ||
+			!CreateEmptyFile(m_rangeFiles[i]))
+			return false;
+	}
+
+	bool result = true;
+
+	for (unsigned i = 0; i < m_bucketsCount && result; i++)
+		result = WeldBucket(i);
+
+	if (result)
+		result = Renumber();
+
+	Log::LogT("out of core part: welded %d corners into %d vertices", m_cornersCount, m_verticesCount);
+
+	return result;
+}
+
+bool OutOfCorePart::WeldBucket(unsigned bucket)
+{
+	std::vector<CornerRecord> records;
+	if (!ReadFile(m_bucketFiles[bucket], records))
+	{
+		Log::LogT("error: couldn't read temporary file '%s'", m_bucketFiles[bucket].c_str());
+		return false;
+	}
+
+	remove(m_bucketFiles[bucket].c_str());
+
+	// records are in corner order, so a vertex is keyed to the first corner using it
+	typedef std::unordered_map<PackedVertexRef, uint32_t, PackedVertexHash, PackedVertexEqual> VertexMap;
+	VertexMap uniqueVertices(records.size());
+
+	std::vector<std::vector<CornerRecord> > firstBuffers(m_rangesCount);
+	std::vector<std::vector<IndexRecord> > linkBuffers(m_rangesCount);
+
+	bool result = true;
+
+	for (unsigned i = 0; i < records.size(); i++)
+	{
+		PackedVertexRef ref;
+		ref.data = &records[i].vertex;
+		ref.size = sizeof(PackedVertex);
+
+		// the index is the first corner until Renumber() replaces it
+		IndexRecord link;
+		link.corner = records[i].corner;
+
+		VertexMap::iterator it = uniqueVertices.find(ref);
+		if (it != uniqueVertices.end())
+			link.index = it->second;
+		else
+		{
+			link.index = records[i].corner;
+			uniqueVertices[ref] = link.index;
+			m_verticesCount++;
+
+			unsigned range = link.index / m_rangeSize;
+			firstBuffers[range].push_back(records[i]);
+
+			if (firstBuffers[range].size() == BufferRecords)
+				result = AppendRecords(m_firstFiles[range], firstBuffers[range]) && result;
+		}
+
+		unsigned range = link.index / m_rangeSize;
+		linkBuffers[range].push_back(link);
+
+		if (linkBuffers[range].size() == BufferRecords)
+			result = AppendRecords(m_linkFiles[range], linkBuffers[range]) && result;
+	}
+
+	for (unsigned i = 0; i < m_rangesCount; i++)
+	{
+		result = AppendRecords(m_firstFiles[i], firstBuffers[i]) && result;
+		result = AppendRecords(m_linkFiles[i], linkBuffers[i]) && result;
+	}
+
+	if (!result)
+		Log::LogT("error: couldn't write temporary files of bucket %d", bucket);
+
+	return result;
+}
+
+// Vertices get their indices in the order of their first corners, the order
+// the in core indexer leaves them in, so the vertex buffer follows the index
+// buffer. Ranges of first corners are renumbered one after another.
+bool OutOfCorePart::Renumber()
+{
+	m_verticesFile = CreateTempFileName("vertices", 0);
+	std::ofstream verticesFile(m_verticesFile.c_str(), std::ios::binary | std::ios::trunc);
+	if (verticesFile.fail())
+	{
+		Log::LogT("error: couldn't create temporary file '%s'", m_verticesFile.c_str());
+		return false;
+	}
+
+	// a range can hold more vertices than the budget, they're written a window at a time
+	unsigned windowSize = std::max(m_memoryBudget / (unsigned)(2 * sizeof(PackedVertex)), (unsigned)BufferRecords);
+
+	std::vector<uint32_t> indices;
+	std::vector<PackedVertex> window;
+	std::vector<CornerRecord> firsts;
+	std::vector<IndexRecord> links;
+	std::vector<std::vector<IndexRecord> > rangeBuffers(m_rangesCount);
+
+	uint32_t verticesCount = 0;
+	bool result = true;
+
+	for (unsigned range = 0; range < m_rangesCount && result; range++)
+	{
+		unsigned first = range * m_rangeSize;
+		if (first >= m_cornersCount)
+			break;
+
+		unsigned count = std::min(m_rangeSize, m_cornersCount - first);
+
+		// first corners of the range are marked, then numbered in corner order
+		indices.assign(count, NoIndex);
+
+		std::ifstream firstFile(m_firstFiles[range].c_str(), std::ios::binary);
+		if (firstFile.fail())
+		{
+			Log::LogT("error: couldn't read temporary file '%s'", m_firstFiles[range].c_str());
+			return false;
+		}
+
+		while (ReadRecords(firstFile, BufferRecords, firsts))
+		{
+			for (unsigned i = 0; i < firsts.size(); i++)
+				indices[firsts[i].corner - first] = 0;
+		}
+
+		uint32_t rangeVertices = verticesCount;
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (indices[i] != NoIndex)
+				indices[i] = verticesCount++;
+		}
+
+		for (uint32_t windowFirst = rangeVertices; windowFirst < verticesCount; windowFirst += windowSize)
+		{
+			unsigned windowCount = std::min(windowSize, verticesCount - windowFirst);
+			window.resize(windowCount);
+
+			firstFile.clear();
+			firstFile.seekg(0, std::ios::beg);
+
+			while (ReadRecords(firstFile, BufferRecords, firsts))
+			{
+				for (unsigned i = 0; i < firsts.size(); i++)
+				{
+					uint32_t index = indices[firsts[i].corner - first];
+					if (index >= windowFirst && index - windowFirst < windowCount)
+						window[index - windowFirst] = firsts[i].vertex;
+				}
+			}
+
+			verticesFile.write((const char*)&window[0], windowCount * sizeof(PackedVertex));
+		}
+
+		firstFile.close();
+		remove(m_firstFiles[range].c_str());
+
+		// corners using the range's vertices go to the ranges of their own corners
+		std::ifstream linkFile(m_linkFiles[range].c_str(), std::ios::binary);
+		if (linkFile.fail())
+		{
+			Log::LogT("error: couldn't read temporary file '%s'", m_linkFiles[range].c_str());
+			return false;
+		}
+
+		while (ReadRecords(linkFile, BufferRecords, links))
+		{
+			for (unsigned i = 0; i < links.size(); i++)
+			{
+				IndexRecord indexRecord;
+				indexRecord.corner = links[i].corner;
+				indexRecord.index = indices[links[i].index - first];
+
+				unsigned target = indexRecord.corner / m_rangeSize;
+				rangeBuffers[target].push_back(indexRecord);
+
+				if (rangeBuffers[target].size() == BufferRecords)
+					result = AppendRecords(m_rangeFiles[target], rangeBuffers[target]) && result;
+			}
+		}
+
+		linkFile.close();
+		remove(m_linkFiles[range].c_str());
+	}
+
+	for (unsigned i = 0; i < m_rangesCount; i++)
+		result = AppendRecords(m_rangeFiles[i], rangeBuffers[i]) && result;
+
+	verticesFile.close();
+
+	if (!result || verticesFile.fail())
+	{
+		Log::LogT("error: couldn't write temporary files of an out of core part");
+		return false;
+	}
+
+	assert(verticesCount == m_verticesCount);
+
+	return true;
+}
+
+void OutOfCorePart::SaveVertices(BinaryWriter &bw)
+{
+	std::ifstream file(m_verticesFile.c_str(), std::ios::binary);
+
+	std::vector<PackedVertex> buffer(BufferRecords);
+	Scene3DVertex vert;
+
+	unsigned left = m_verticesCount;
+	while (left > 0)
+	{
+		unsigned count = std::min(left, (unsigned)BufferRecords);
+		file.read((char*)&buffer[0], count * sizeof(PackedVertex));
+
+		for (unsigned i = 0; i < count; i++)
+		{
+			Unpack(buffer[i], vert);
+			GeoSaver::SaveVertex(&vert, m_vertexType, bw);
+		}
+
+		left -= count;
+	}
+}
+
+void OutOfCorePart::SaveIndices(BinaryWriter &bw)
+{
+	uint8_t indexSize = GetIndexSize();
+
+	bw.Write(indexSize);
+	bw.Write((int)m_cornersCount);
+
+	std::vector<uint32_t> indices;
+	std::vector<IndexRecord> records;
+
+	for (unsigned range = 0; range < m_rangesCount; range++)
+	{
+		unsigned first = range * m_rangeSize;
+		if (first >= m_cornersCount)
+			break;
+
+		unsigned count = std::min(m_rangeSize, m_cornersCount - first);
+
+		indices.assign(count, 0);
+
+		if (!ReadFile(m_rangeFiles[range], records))
+			Log::LogT("error: couldn't read temporary file '%s'", m_rangeFiles[range].c_str());
+
+		for (unsigned i = 0; i < records.size(); i++)
+			indices[records[i].corner - first] = records[i].index;
+
+		if (indexSize == 2)
+		{
+			for (unsigned i = 0; i < count; i++)
+				bw.Write((uint16_t)indices[i]);
+		}
+		else
+		{
+			for (unsigned i = 0; i < count; i++)
+				bw.Write((uint32_t)indices[i]);
+		}
+	}
+}
+
+unsigned OutOfCorePart::GetVerticesCount() const
+{
+	return m_verticesCount;
+}
+
+unsigned OutOfCorePart::GetIndicesCount() const
+{
+	return m_cornersCount;
+}
+
+uint8_t OutOfCorePart::GetIndexSize() const
+{
+	return m_verticesCount <= MeshPartIndexer::MaxVertices16Bit ? 2 : 4;
+}
+
+void OutOfCorePart::GetBounds(sm::Vec3 &min, sm::Vec3 &max) const
+{
+	min = m_boundsMin;
+	max = m_boundsMax;
+}
+
+void OutOfCorePart::Pack(const Scene3DVertex &vert, PackedVertex &packed) const
+{
+	// attributes which are not saved stay zeroed, so they don't split vertices
+	memset(&packed, 0, sizeof(PackedVertex));
+
+	packed.position[0] = CanonicalFloat(vert.position.x);
+	packed.position[1] = CanonicalFloat(vert.position.y);
+	packed.position[2] = CanonicalFloat(vert.position.z);
+
+	if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Coords1))
+	{
+		packed.coords1[0] = CanonicalFloat(vert.coords1.x);
+		packed.coords1[1] = CanonicalFloat(vert.coords1.y);
+	}
+
+	if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Coords2))
+	{
+		packed.coords2[0] = CanonicalFloat(vert.coords2.x);
+		packed.coords2[1] = CanonicalFloat(vert.coords2.y);
+	}
+
+	if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Coords3))
+	{
+		packed.coords3[0] = CanonicalFloat(vert.coords3.x);
+		packed.coords3[1] = CanonicalFloat(vert.coords3.y);
+	}
+
+	if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Normal))
+	{
+		packed.normal[0] = CanonicalFloat(vert.normal.x);
+		packed.normal[1] = CanonicalFloat(vert.normal.y);
+		packed.normal[2] = CanonicalFloat(vert.normal.z);
+	}
+
+	if (VertexInformation::HasAttrib(m_vertexType, VertexAttrib::Tangent))
+	{
+		packed.tangent[0] = CanonicalFloat(vert.tangent.x);
+		packed.tangent[1] = CanonicalFloat(vert.tangent.y);
+		packed.tangent[2] = CanonicalFloat(vert.tangent.z);
+	}
+}
+
+void OutOfCorePart::Unpack(const PackedVertex &packed, Scene3DVertex &vert) const
+{
+	vert.position.Set(packed.position[0], packed.position[1], packed.position[2]);
+	vert.coords1.Set(packed.coords1[0], packed.coords1[1]);
+	vert.coords2.Set(packed.coords2[0], packed.coords2[1]);
+	vert.coords3.Set(packed.coords3[0], packed.coords3[1]);
+	vert.normal.Set(packed.normal[0], packed.normal[1], packed.normal[2]);
+	vert.tangent.Set(packed.tangent[0], packed.tangent[1], packed.tangent[2]);
+}
+
+uint32_t OutOfCorePart::Hash(const PackedVertex &packed)
+{
+	PackedVertexRef ref;
+	ref.data = &packed;
+	ref.size = sizeof(PackedVertex);
+
+	// bucket selection must not correlate with the hash map buckets inside WeldBucket
+	uint32_t hash = (uint32_t)PackedVertexHash()(ref);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+void OutOfCorePart::FlushBucket(unsigned bucket)
+{
+	if (!AppendRecords(m_bucketFiles[bucket], m_bucketBuffers[bucket]) && !m_writeFailed)
+	{
+		Log::LogT("error: couldn't write temporary file '%s'", m_bucketFiles[bucket].c_str());
+		m_writeFailed = true;
+	}
+}
+
+std::string OutOfCorePart::CreateTempFileName(const char *suffix, unsigned index)
+{
+	std::stringstream fileName;
+	fileName << m_tempDir << "geo_" << GetCurrentProcessId() << "_" << m_id << "_" << suffix << index << ".tmp";
+	return fileName.str();
+}
+
+void OutOfCorePart::RemoveFiles()
+{
+	for (unsigned i = 0; i < m_bucketFiles.size(); i++)
+		remove(m_bucketFiles[i].c_str());
+
+	for (unsigned i = 0; i < m_firstFiles.size(); i++)
+		remove(m_firstFiles[i].c_str());
+
+	for (unsigned i = 0; i < m_linkFiles.size(); i++)
+		remove(m_linkFiles[i].c_str());
+
+	for (unsigned i = 0; i < m_rangeFiles.size(); i++)
+		remove(m_rangeFiles[i].c_str());
+
+	if (m_verticesFile.size() > 0)
+		remove(m_verticesFile.c_str());
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <IO\BinaryWriter.h>
+#include <Math\Vec3.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+#include "Scene3DVertex.h"
+
+// Bounded-memory replacement for the vertex and index arrays of a mesh part.
+// Corners are added in windows and spilled to temporary files, bucketed by
+// vertex hash. Finish() welds every bucket separately, so peak memory depends
+// on the budget instead of the size of the mesh, and then renumbers the
+// vertices in the order the indices first use them. Temporary files are only
+// open while a buffer is appended to them. Save() streams the welded vertices
+// and the indices straight from the temporary files into the output.
+class OutOfCorePart
+{
+public:
+	OutOfCorePart(
+		uint8_t vertexType,
+		unsigned cornersCount,
+		unsigned memoryBudget,
+		const std::string &tempDir);
+
+	~OutOfCorePart();
+
+	bool Begin();
+	void AddCorners(const std::vector<Scene3DVertex> &corners);
+	bool Finish();
+
+	void SaveVertices(BinaryWriter &bw);
+	// writes index size, index count and the indices
+	void SaveIndices(BinaryWriter &bw);
+
+	unsigned GetVerticesCount() const;
+	unsigned GetIndicesCount() const;
+	uint8_t GetIndexSize() const;
+	void GetBounds(sm::Vec3 &min, sm::Vec3 &max) const;
+
+private:
+	struct PackedVertex
+	{
+		float position[3];
+		float coords1[2];
+		float coords2[2];
+		float coords3[2];
+		float normal[3];
+		float tangent[3];
+	};
+
+	struct CornerRecord
+	{
+		PackedVertex vertex;
+		uint32_t corner;
+	};
+
+	struct IndexRecord
+	{
+		uint32_t corner;
+		uint32_t index;
+	};
+
+	static const unsigned BufferRecords = 1024;
+	// hash map node and bucket overhead per welded record
+	static const unsigned WeldOverhead = 64;
+
+	unsigned m_id;
+	uint8_t m_vertexType;
+	unsigned m_cornersCount;
+	unsigned m_memoryBudget;
+	std::string m_tempDir;
+
+	unsigned m_addedCorners;
+	unsigned m_verticesCount;
+	bool m_writeFailed;
+
+	sm::Vec3 m_boundsMin;
+	sm::Vec3 m_boundsMax;
+
+	unsigned m_bucketsCount;
+	unsigned m_rangeSize;
+	unsigned m_rangesCount;
+
+	std::vector<std::string> m_bucketFiles;
+	std::vector<std::vector<CornerRecord> > m_bucketBuffers;
+
+	// vertices and the corners using them, by the range of the vertex's first corner
+	std::vector<std::string> m_firstFiles;
+	std::vector<std::string> m_linkFiles;
+	// final indices, by the range of the corner
+	std::vector<std::string> m_rangeFiles;
+	std::string m_verticesFile;
+
+	void Pack(const Scene3DVertex &vert, PackedVertex &packed) const;
+	void Unpack(const PackedVertex &packed, Scene3DVertex &vert) const;
+	static uint32_t Hash(const PackedVertex &packed);
+
+	void FlushBucket(unsigned bucket);
+	bool WeldBucket(unsigned bucket);
+	bool Renumber();
+
+	std::string CreateTempFileName(const char *suffix, unsigned index);
+	void RemoveFiles();
+};
@@ -0,0 +1,562 @@
+#include "ProgressiveMesh.h"
+#include "Scene3DMeshPart.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <queue>
+#include <math.h>
+
+namespace
+{
+	// boundary edges are held in place by planes through them, weighted that
+	// many times their squared length, so open borders don't shrink
+	const double BoundaryWeight = 100.0;
+
+	// sum of squared distances to planes, weighted by the planes' areas
+	class Quadric
+	{
+	public:
+		double a[10];
+		double weight;
+
+		Quadric() :
+			weight(0.0)
+		{
+			for (int i = 0; i < 10; i++)
+				a[i] = 0.0;
+		}
+
+		void AddPlane(const double *normal, double distance, double planeWeight)
+		{
+			double plane[4] = { normal[0], normal[1], normal[2], distance };
+
+			int index = 0;
+			for (int i = 0; i < 4; i++)
+				for (int j = i; j < 4; j++)
+					a[index++] += plane[i] * plane[j] * planeWeight;
+		}
+
+		void Add(const Quadric &other)
+		{
+			for (int i = 0; i < 10; i++)
+				a[i] += other.a[i];
+
+			weight += other.weight;
+		}
+
+		double Evaluate(const double *p) const
+		{
+			return
+				a[0] * p[0] * p[0] + 2.0 * a[1] * p[0] * p[1] + 2.0 * a[2] * p[0] * p[2] + 2.0 * a[3] * p[0] +
+				a[4] * p[1] * p[1] + 2.0 * a[5] * p[1] * p[2] + 2.0 * a[6] * p[1] +
+				a[7] * p[2] * p[2] + 2.0 * a[8] * p[2] +
+				a[9];
+		}
+	};
+
+	class Collapse
+	{
+	public:
+		float error;
+		uint32_t from;
+		uint32_t to;
+		int stamp;
+	};
+
+	// smallest error on top, ties broken by vertex, so the result doesn't depend on the queue
+	class CollapseGreater
+	{
+	public:
+		bool operator()(const Collapse &a, const Collapse &b) const
+		{
+			if (a.error != b.error)
+				return a.error > b.error;
+
+			return a.from > b.from;
+		}
+	};
+
+	class PositionLess
+	{
+	public:
+		PositionLess(const std::vector<double> &positions) : m_positions(positions) {}
+
+		bool operator()(uint32_t a, uint32_t b) const
+		{
+			for (int i = 0; i < 3; i++)
+				if (m_positions[a * 3 + i] != m_positions[b * 3 + i])
+					return m_positions[a * 3 + i] < m_positions[b * 3 + i];
+
+			return a < b;
+		}
+
+	private:
+		const std::vector<double> &m_positions;
+	};
+
+	void Cross(const double *a, const double *b, double *result)
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	double Dot(const double *a, const double *b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void FaceNormal(const double *a, const double *b, const double *c, double *normal)
+	{
+		double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+		Cross(ab, ac, normal);
+	}
+}
+
+class ProgressiveMesh::Coarsener
+{
+public:
+	// one collapse as it was done, in collapse order
+	class Step
+	{
+	public:
+		uint32_t from;
+		float error;
+
+		// triangles that went away, their corners are left as they were then
+		std::vector<uint32_t> removed;
+
+		// triangle * 3 + corner that went from the collapsed vertex to its target
+		std::vector<uint32_t> corners;
+	};
+
+	std::vector<uint32_t> triangles;
+	std::vector<bool> triangleAlive;
+	std::vector<bool> vertexAlive;
+	std::vector<Step> steps;
+
+	Coarsener(const std::vector<double> &positions, const std::vector<uint32_t> &indices) :
+		triangles(indices),
+		triangleAlive(indices.size() / 3, true),
+		vertexAlive(positions.size() / 3, true),
+		m_positions(positions),
+		m_vertexTriangles(positions.size() / 3),
+		m_quadrics(positions.size() / 3),
+		m_stamps(positions.size() / 3, 0),
+		m_locked(positions.size() / 3, false),
+		m_aliveTriangles((int)(indices.size() / 3))
+	{
+		for (uint32_t i = 0; i < triangles.size(); i++)
+			m_vertexTriangles[triangles[i]].push_back(i / 3);
+
+		LockSeams();
+		InitQuadrics();
+	}
+
+	void Run(int maxTriangles)
+	{
+		for (uint32_t i = 0; i < vertexAlive.size(); i++)
+			FindCollapse(i);
+
+		float error = 0.0f;
+
+		while (m_aliveTriangles > maxTriangles && !m_queue.empty())
+		{
+			Collapse collapse = m_queue.top();
+			m_queue.pop();
+
+			if (!vertexAlive[collapse.from] || m_stamps[collapse.from] != collapse.stamp)
+				continue;
+
+			// the neighbourhood changed since it was queued
+			if (!vertexAlive[collapse.to] || !CanCollapse(collapse.from, collapse.to))
+			{
+				FindCollapse(collapse.from);
+				continue;
+			}
+
+			error = std::max(error, collapse.error);
+			DoCollapse(collapse.from, collapse.to, error);
+
+			std::vector<uint32_t> neighbours;
+			GetNeighbours(collapse.to, neighbours);
+
+			FindCollapse(collapse.to);
+			for (unsigned i = 0; i < neighbours.size(); i++)
+				FindCollapse(neighbours[i]);
+		}
+	}
+
+private:
+	const std::vector<double> &m_positions;
+	std::vector<std::vector<uint32_t> > m_vertexTriangles;
+	std::vector<Quadric> m_quadrics;
+	std::vector<int> m_stamps;
+	std::vector<bool> m_locked;
+	int m_aliveTriangles;
+
+	std::priority_queue<Collapse, std::vector<Collapse>, CollapseGreater> m_queue;
+
+	const double* Position(uint32_t vertex) const
+	{
+		return &m_positions[vertex * 3];
+	}
+
+	void LockSeams()
+	{
+		std::vector<uint32_t> order(vertexAlive.size());
+		for (uint32_t i = 0; i < order.size(); i++)
+			order[i] = i;
+
+		std::sort(order.begin(), order.end(), PositionLess(m_positions));
+
+		for (unsigned i = 1; i < order.size(); i++)
+		{
+			const double *a = Position(order[i - 1]);
+			const double *b = Position(order[i]);
+
+			if (a[0] == b[0] && a[1] == b[1] && a[2] == b[2])
+			{
+				m_locked[order[i - 1]] = true;
+				m_locked[order[i]] = true;
+			}
+		}
+	}
+
+	void InitQuadrics()
+	{
+		// a triangle of every edge and how many triangles share it
+		std::unordered_map<uint64_t, int> edgeTriangles;
+		std::unordered_map<uint64_t, int> edgeCounts;
+
+		for (uint32_t i = 0; i < triangles.size() / 3; i++)
+		{
+			double normal[3];
+			FaceNormal(Position(triangles[i * 3 + 0]), Position(triangles[i * 3 + 1]), Position(triangles[i * 3 + 2]), normal);
+
+			double length = sqrt(Dot(normal, normal));
+			if (length > 0.0)
+			{
+				for (int j = 0; j < 3; j++)
+					normal[j] /= length;
+
+				double distance = -Dot(normal, Position(triangles[i * 3]));
+				double area = length * 0.5;
+
+				for (int j = 0; j < 3; j++)
+				{
+					m_quadrics[triangles[i * 3 + j]].AddPlane(normal, distance, area);
+					m_quadrics[triangles[i * 3 + j]].weight += area;
+				}
+			}
+
+			for (int j = 0; j < 3; j++)
+			{
+				uint64_t a = triangles[i * 3 + j];
+				uint64_t b = triangles[i * 3 + (j + 1) % 3];
+				uint64_t key = a < b ? (a << 32) | b : (b << 32) | a;
+
+				edgeTriangles[key] = i;
+				edgeCounts[key]++;
+			}
+		}
+
+		for (std::unordered_map<uint64_t, int>::const_iterator it = edgeCounts.begin(); it != edgeCounts.end(); ++it)
+		{
+			if (it->second != 1)
+				continue;
+
+			uint32_t triangle = edgeTriangles[it->first];
+			uint32_t a = (uint32_t)(it->first >> 32);
+			uint32_t b = (uint32_t)(it->first & 0xffffffff);
+
+			double faceNormal[3];
+			FaceNormal(Position(triangles[triangle * 3 + 0]), Position(triangles[triangle * 3 + 1]), Position(triangles[triangle * 3 + 2]), faceNormal);
+
+			double edge[3] = { Position(b)[0] - Position(a)[0], Position(b)[1] - Position(a)[1], Position(b)[2] - Position(a)[2] };
+
+			// plane through the edge, perpendicular to the face
+			double normal[3];
+			Cross(edge, faceNormal, normal);
+
+			double length = sqrt(Dot(normal, normal));
+			if (length <= 0.0)
+				continue;
+
+			for (int j = 0; j < 3; j++)
+				normal[j] /= length;
+
+			double distance = -Dot(normal, Position(a));
+			double weight = Dot(edge, edge) * BoundaryWeight;
+
+			m_quadrics[a].AddPlane(normal, distance, weight);
+			m_quadrics[b].AddPlane(normal, distance, weight);
+		}
+	}
+
+	void GetNeighbours(uint32_t vertex, std::vector<uint32_t> &neighbours) const
+	{
+		neighbours.clear();
+
+		const std::vector<uint32_t> &vertexTriangles = m_vertexTriangles[vertex];
+
+		for (unsigned i = 0; i < vertexTriangles.size(); i++)
+			for (int j = 0; j < 3; j++)
+				if (triangles[vertexTriangles[i] * 3 + j] != vertex)
+					neighbours.push_back(triangles[vertexTriangles[i] * 3 + j]);
+
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+	}
+
+	bool HasVertex(uint32_t triangle, uint32_t vertex) const
+	{
+		return
+			triangles[triangle * 3 + 0] == vertex ||
+			triangles[triangle * 3 + 1] == vertex ||
+			triangles[triangle * 3 + 2] == vertex;
+	}
+
+	bool CanCollapse(uint32_t from, uint32_t to) const
+	{
+		const std::vector<uint32_t> &fromTriangles = m_vertexTriangles[from];
+
+		// link condition: the only vertices both ends see are the ones across
+		// the triangles on the edge, otherwise the mesh folds into itself
+		int sharedTriangles = 0;
+		for (unsigned i = 0; i < fromTriangles.size(); i++)
+			if (HasVertex(fromTriangles[i], to))
+				sharedTriangles++;
+
+		if (sharedTriangles == 0)
+			return false;
+
+		std::vector<uint32_t> fromNeighbours;
+		std::vector<uint32_t> toNeighbours;
+		GetNeighbours(from, fromNeighbours);
+		GetNeighbours(to, toNeighbours);
+
+		std::vector<uint32_t> shared;
+		std::set_intersection(
+			fromNeighbours.begin(), fromNeighbours.end(),
+			toNeighbours.begin(), toNeighbours.end(),
+			std::back_inserter(shared));
+
+		if ((int)shared.size() > sharedTriangles)
+			return false;
+
+		// no triangle left may turn over
+		for (unsigned i = 0; i < fromTriangles.size(); i++)
+		{
+			uint32_t triangle = fromTriangles[i];
+
+			if (HasVertex(triangle, to))
+				continue;
+
+			const double *corners[3];
+			const double *movedCorners[3];
+
+			for (int j = 0; j < 3; j++)
+			{
+				corners[j] = Position(triangles[triangle * 3 + j]);
+				movedCorners[j] = triangles[triangle * 3 + j] == from ? Position(to) : corners[j];
+			}
+
+			double normal[3];
+			double movedNormal[3];
+			FaceNormal(corners[0], corners[1], corners[2], normal);
+			FaceNormal(movedCorners[0], movedCorners[1], movedCorners[2], movedNormal);
+
+			if (Dot(normal, movedNormal) <= 0.0 && Dot(normal, normal) > 0.0)
+				return false;
+		}
+
+		return true;
+	}
+
+	// queues the cheapest collapse of the vertex, if it has one
+	void FindCollapse(uint32_t from)
+	{
+		m_stamps[from]++;
+
+		if (!vertexAlive[from] || m_locked[from])
+			return;
+
+		std::vector<uint32_t> neighbours;
+		GetNeighbours(from, neighbours);
+
+		// candidates sorted by error, the first one that can collapse is queued
+		std::vector<std::pair<float, uint32_t> > candidates(neighbours.size());
+
+		for (unsigned i = 0; i < neighbours.size(); i++)
+		{
+			Quadric quadric = m_quadrics[from];
+			quadric.Add(m_quadrics[neighbours[i]]);
+
+			double cost = std::max(quadric.Evaluate(Position(neighbours[i])), 0.0);
+			if (quadric.weight > 0.0)
+				cost /= quadric.weight;
+
+			candidates[i] = std::make_pair((float)sqrt(cost), neighbours[i]);
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+
+		for (unsigned i = 0; i < candidates.size(); i++)
+		{
+			if (CanCollapse(from, candidates[i].second))
+			{
+				Collapse collapse;
+				collapse.error = candidates[i].first;
+				collapse.from = from;
+				collapse.to = candidates[i].second;
+				collapse.stamp = m_stamps[from];
+
+				m_queue.push(collapse);
+				return;
+			}
+		}
+	}
+
+	void DoCollapse(uint32_t from, uint32_t to, float error)
+	{
+		steps.push_back(Step());
+		Step &step = steps.back();
+		step.from = from;
+		step.error = error;
+
+		m_quadrics[to].Add(m_quadrics[from]);
+
+		const std::vector<uint32_t> &fromTriangles = m_vertexTriangles[from];
+
+		for (unsigned i = 0; i < fromTriangles.size(); i++)
+		{
+			uint32_t triangle = fromTriangles[i];
+
+			if (HasVertex(triangle, to))
+			{
+				triangleAlive[triangle] = false;
+				m_aliveTriangles--;
+				step.removed.push_back(triangle);
+
+				for (int j = 0; j < 3; j++)
+				{
+					uint32_t vertex = triangles[triangle * 3 + j];
+					if (vertex == from)
+						continue;
+
+					std::vector<uint32_t> &vertexTriangles = m_vertexTriangles[vertex];
+					vertexTriangles.erase(std::remove(vertexTriangles.begin(), vertexTriangles.end(), triangle), vertexTriangles.end());
+				}
+
+				continue;
+			}
+
+			for (int j = 0; j < 3; j++)
+			{
+				if (triangles[triangle * 3 + j] == from)
+				{
+					triangles[triangle * 3 + j] = to;
+					step.corners.push_back(triangle * 3 + j);
+				}
+			}
+
+			m_vertexTriangles[to].push_back(triangle);
+		}
+
+		m_vertexTriangles[from].clear();
+		vertexAlive[from] = false;
+	}
+};
+
+ProgressiveMesh* ProgressiveMesh::Build(Scene3DMeshPart *meshPart, float baseRatio)
+{
+	uint32_t verticesCount = (uint32_t)meshPart->vertices.size();
+	uint32_t trianglesCount = (uint32_t)meshPart->indices.size() / 3;
+
+	std::vector<double> positions(verticesCount * 3);
+	for (uint32_t i = 0; i < verticesCount; i++)
+	{
+		positions[i * 3 + 0] = meshPart->vertices[i]->position.x;
+		positions[i * 3 + 1] = meshPart->vertices[i]->position.y;
+		positions[i * 3 + 2] = meshPart->vertices[i]->position.z;
+	}
+
+	std::vector<uint32_t> indices(meshPart->indices.begin(), meshPart->indices.begin() + trianglesCount * 3);
+
+	Coarsener coarsener(positions, indices);
+	coarsener.Run(std::max((int)(trianglesCount * baseRatio), 1));
+
+	if (coarsener.steps.size() == 0)
+		return NULL;
+
+	const std::vector<Coarsener::Step> &steps = coarsener.steps;
+
+	ProgressiveMesh *progressive = new ProgressiveMesh();
+
+	// vertices that are left keep their order, then the collapsed ones in split order
+	std::vector<uint32_t> vertexMap(verticesCount);
+	uint32_t vertex = 0;
+
+	for (uint32_t i = 0; i < verticesCount; i++)
+		if (coarsener.vertexAlive[i])
+			vertexMap[i] = vertex++;
+
+	progressive->baseVerticesCount = vertex;
+
+	for (size_t i = steps.size(); i-- > 0; )
+		vertexMap[steps[i].from] = vertex++;
+
+	// triangles get their place in the index buffer in the order they show up
+	std::vector<uint32_t> slots(trianglesCount);
+	uint32_t slot = 0;
+
+	for (uint32_t i = 0; i < trianglesCount; i++)
+	{
+		if (coarsener.triangleAlive[i])
+		{
+			slots[i] = slot++;
+
+			for (int j = 0; j < 3; j++)
+				progressive->baseIndices.push_back(vertexMap[coarsener.triangles[i * 3 + j]]);
+		}
+	}
+
+	progressive->splits.resize(steps.size());
+
+	for (size_t i = 0; i < steps.size(); i++)
+	{
+		const Coarsener::Step &step = steps[steps.size() - 1 - i];
+		VertexSplit &split = progressive->splits[i];
+
+		split.error = step.error;
+
+		for (unsigned j = 0; j < step.removed.size(); j++)
+		{
+			slots[step.removed[j]] = slot++;
+
+			for (int k = 0; k < 3; k++)
+				split.triangles.push_back(vertexMap[coarsener.triangles[step.removed[j] * 3 + k]]);
+		}
+
+		// every triangle touched by the collapse outlived it, so it has its place already
+		for (unsigned j = 0; j < step.corners.size(); j++)
+			split.corners.push_back(slots[step.corners[j] / 3] * 3 + step.corners[j] % 3);
+	}
+
+	std::vector<Scene3DVertex*> vertices(verticesCount);
+	for (uint32_t i = 0; i < verticesCount; i++)
+		vertices[vertexMap[i]] = meshPart->vertices[i];
+
+	meshPart->vertices.swap(vertices);
+
+	meshPart->indices.resize(trianglesCount * 3);
+	for (uint32_t i = 0; i < trianglesCount; i++)
+		for (int j = 0; j < 3; j++)
+			meshPart->indices[slots[i] * 3 + j] = vertexMap[indices[i * 3 + j]];
+
+	return progressive;
+}
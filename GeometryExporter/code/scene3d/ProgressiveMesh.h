@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+class Scene3DMeshPart;
+
+// Progressive mesh (Hoppe, 1996) of an indexed part: a coarse base mesh and
+// vertex splits that bring it back to full detail one vertex at a time, so a
+// reader can draw the base right away and refine while the rest streams in.
+// The part is coarsened by half edge collapses in order of their quadric
+// error (Garland and Heckbert, 1997). A collapse only drops a vertex, nothing
+// is moved or made up, so every vertex keeps its exported attributes.
+// Vertices sharing their position with another one (uv and normal seams)
+// never collapse, so seams can't open up.
+class ProgressiveMesh
+{
+public:
+	class VertexSplit
+	{
+	public:
+		// distance from the full detail surface of the mesh before the split,
+		// it never grows along the splits, so a reader stops at the first one
+		// below its screen space threshold
+		float error;
+
+		// triangles the split adds at the end of the index buffer
+		std::vector<uint32_t> triangles;
+
+		// places in the index buffer whose vertex becomes the split's vertex
+		std::vector<uint32_t> corners;
+	};
+
+	// vertices of the base mesh come first, the vertex of split i is baseVerticesCount + i
+	uint32_t baseVerticesCount;
+	std::vector<uint32_t> baseIndices;
+	std::vector<VertexSplit> splits;
+
+	// Coarsens the part until at most baseRatio of its triangles are left or
+	// nothing can collapse anymore. Vertices of the part are reordered and its
+	// indices become the full detail index buffer the splits lead to, so
+	// anything built from the part afterwards matches the saved order.
+	// Returns NULL and leaves the part as it was when nothing collapses.
+	static ProgressiveMesh* Build(Scene3DMeshPart *meshPart, float baseRatio);
+
+private:
+	// runs the collapses, defined in the .cpp
+	class Coarsener;
+};
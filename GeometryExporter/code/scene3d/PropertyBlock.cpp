@@ -0,0 +1,169 @@
+#include "PropertyBlock.h"
+
+#include <IO/BinaryWriter.h>
+#include <Utils/StringUtils.h>
+
+#include <Utils/Log.h>
+
+#include <sstream>
+#include <algorithm>
+
+class PropertyBlock::HashEntry
+{
+public:
+	uint32_t hash;
+	uint32_t record;
+};
+
+// by hash, records of equal hashes stay in their order
+class PropertyBlock::HashEntryLess
+{
+public:
+	bool operator()(const HashEntry &a, const HashEntry &b) const
+	{
+		if (a.hash != b.hash)
+			return a.hash < b.hash;
+
+		return a.record < b.record;
+	}
+};
+
+void PropertyBlock::Build(const std::vector<Property*> &properties, std::string &data)
+{
+	std::string strings;
+	std::map<std::string, uint32_t> stringOffsets;
+
+	std::vector<int> ints;
+	std::vector<float> floats;
+	std::vector<float> times;
+
+	std::stringstream records;
+	BinaryWriter bw(&records);
+
+	for (unsigned i = 0; i < properties.size(); i++)
+	{
+		const Property *prop = properties[i];
+
+		// animated without keys is saved as the static value
+		bool keyed = prop->IsAnimatable() && prop->GetKeysCount() > 0;
+
+		std::vector<Property::Value> values;
+		if (keyed)
+			values = prop->GetKeyValues();
+		else
+			values.push_back(prop->Evaluate(0.0f));
+
+		uint32_t valueIndex = 0;
+
+		switch (prop->GetPropertyType())
+		{
+		case Property::PropertyType_Boolean:
+			valueIndex = (uint32_t)ints.size();
+			for (unsigned j = 0; j < values.size(); j++)
+				ints.push_back(values[j].boolValue ? 1 : 0);
+			break;
+
+		case Property::PropertyType_Int:
+			valueIndex = (uint32_t)ints.size();
+			for (unsigned j = 0; j < values.size(); j++)
+				ints.push_back(values[j].intValue);
+			break;
+
+		case Property::PropertyType_Float:
+		case Property::PropertyType_Vector3:
+			valueIndex = (uint32_t)floats.size();
+			for (unsigned j = 0; j < values.size(); j++)
+				for (unsigned k = 0; k < prop->GetComponentsCount(); k++)
+					floats.push_back(prop->GetComponent(values[j], k));
+			break;
+
+		case Property::PropertyType_String:
+			valueIndex = AddString(StringUtils::ToNarrow(prop->GetStringValue()), strings, stringOffsets);
+			break;
+		}
+
+		bw.Write(AddString(prop->GetName(), strings, stringOffsets));
+		bw.Write((uint8_t)prop->GetPropertyType());
+		bw.Write((uint8_t)prop->GetAnimationType());
+		bw.Write((uint16_t)0);
+		bw.Write((uint32_t)(keyed ? prop->GetKeysCount() : 0));
+		bw.Write((uint32_t)(keyed ? times.size() : 0));
+		bw.Write(valueIndex);
+
+		if (keyed && prop->GetAnimationType() == Property::AnimationType_Sampled)
+		{
+			times.push_back(prop->GetSampleStart());
+			times.push_back(prop->GetSampleStep());
+		}
+		else if (keyed)
+			times.insert(times.end(), prop->GetKeyTimes().begin(), prop->GetKeyTimes().end());
+	}
+
+	std::vector<HashEntry> hashEntries(properties.size());
+
+	for (unsigned i = 0; i < properties.size(); i++)
+	{
+		hashEntries[i].hash = HashName(properties[i]->GetName());
+		hashEntries[i].record = i;
+	}
+
+	std::sort(hashEntries.begin(), hashEntries.end(), HashEntryLess());
+
+	for (unsigned i = 0; i < hashEntries.size(); i++)
+	{
+		// still found, but a reader has to compare names to tell them apart
+		if (i > 0 && hashEntries[i].hash == hashEntries[i - 1].hash)
+		{
+			Log::LogT("warning: properties '%s' and '%s' have the same name hash",
+				properties[hashEntries[i - 1].record]->GetName().c_str(), properties[hashEntries[i].record]->GetName().c_str());
+		}
+
+		bw.Write(hashEntries[i].hash);
+		bw.Write(hashEntries[i].record);
+	}
+
+	bw.Write((uint32_t)strings.size());
+	bw.Write(strings.c_str(), (uint32_t)strings.size());
+
+	bw.Write((uint32_t)ints.size());
+	for (unsigned i = 0; i < ints.size(); i++)
+		bw.Write(ints[i]);
+
+	bw.Write((uint32_t)floats.size());
+	for (unsigned i = 0; i < floats.size(); i++)
+		bw.Write(floats[i]);
+
+	bw.Write((uint32_t)times.size());
+	for (unsigned i = 0; i < times.size(); i++)
+		bw.Write(times[i]);
+
+	data = records.str();
+}
+
+uint32_t PropertyBlock::AddString(const std::string &value, std::string &strings, std::map<std::string, uint32_t> &offsets)
+{
+	std::map<std::string, uint32_t>::const_iterator it = offsets.find(value);
+	if (it != offsets.end())
+		return it->second;
+
+	uint32_t offset = (uint32_t)strings.size();
+	offsets[value] = offset;
+
+	strings.append(value);
+	strings.push_back('\0');
+
+	return offset;
+}
+
+uint32_t PropertyBlock::HashName(const std::string &name)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../Property.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+// Mesh properties packed for the .geo: fixed size records, one table of
+// zero terminated names and string values, and one array per value type,
+// so a reader maps the block as it is instead of parsing every property.
+// Records are followed by their names' hashes, sorted, so a reader finds
+// a property by a hash it computed once, without comparing strings.
+class PropertyBlock
+{
+public:
+	// bytes of a property record
+	static const unsigned RecordSize = 20;
+
+	// bytes of a hash index entry: uint32 name hash, uint32 record index
+	static const unsigned HashEntrySize = 8;
+
+	static void Build(const std::vector<Property*> &properties, std::string &data);
+
+	// 32-bit FNV-1a of the name's bytes. It's a few lines without tables, so
+	// a reader can compute it at compile time for the names it looks for.
+	static uint32_t HashName(const std::string &name);
+
+private:
+	class HashEntry;
+	class HashEntryLess;
+
+	// offset of the string in the table, equal strings are stored once
+	static uint32_t AddString(const std::string &value, std::string &strings, std::map<std::string, uint32_t> &offsets);
+};
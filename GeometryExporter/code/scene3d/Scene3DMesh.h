@@ -4,6 +4,7 @@
 #include <Math\Matrix.h>
 #include <Math\Vec2.h>
 #include "Scene3DMeshPart.h"
+#include "Scene3DMeshChunk.h"
 #include <string>
 #include "../Property.h"
 
@@ -15,6 +16,7 @@ public:
 
 	std::vector<Scene3DMeshPart*> meshParts;
 	std::vector<Property*> properties;
+	std::vector<Scene3DMeshChunk*> chunks;
 	sm::Matrix m_worldInverseMatrix;
 
 	~Scene3DMesh()
@@ -23,6 +25,16 @@ public:
 			delete meshParts[i];
 
 		meshParts.clear();
+
+		for (unsigned i = 0; i < chunks.size(); i++)
+			delete chunks[i];
+
+		chunks.clear();
+
+		for (unsigned i = 0; i < properties.size(); i++)
+			delete properties[i];
+
+		properties.clear();
 	}
 };
 
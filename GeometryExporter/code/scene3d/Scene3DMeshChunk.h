@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <string.h>
+
+// Optional block of mesh data saved after the properties. The payload is
+// prefixed with its size, so readers can skip tags they don't know.
+class Scene3DMeshChunk
+{
+public:
+	char tag[4];
+	std::string data;
+
+	Scene3DMeshChunk(const char *tag)
+	{
+		memcpy(this->tag, tag, 4);
+	}
+};
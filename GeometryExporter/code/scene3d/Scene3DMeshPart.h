@@ -2,7 +2,11 @@
 
 #include <windows.h>
 #include <string>
+#include <vector>
+#include <stdint.h>
 #include "Scene3DVertex.h"
+#include "OutOfCorePart.h"
+#include "ProgressiveMesh.h"
 
 class Scene3DMeshPart
 {
@@ -11,6 +15,24 @@ public:
 	uint8_t m_vertexType;
 
 	std::vector<Scene3DVertex*> vertices;
+	std::vector<uint32_t> indices;
+
+	// material has use_wire set, the part gets a wire line list
+	bool useWire;
+
+	// set instead of vertices and indices when the part is too big to be held in memory
+	OutOfCorePart *outOfCore;
+
+	// set when the part is saved as a base mesh and vertex splits, vertices
+	// and indices are then in the order the splits lead to
+	ProgressiveMesh *progressive;
+
+	Scene3DMeshPart() :
+		useWire(false),
+		outOfCore(NULL),
+		progressive(NULL)
+	{
+	}
 
 	~Scene3DMeshPart()
 	{
@@ -18,5 +40,11 @@ public:
 			delete vertices[i];
 
 		vertices.clear();
+
+		if (outOfCore != NULL)
+			delete outOfCore;
+
+		if (progressive != NULL)
+			delete progressive;
 	}
 };
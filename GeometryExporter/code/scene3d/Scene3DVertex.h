@@ -12,4 +12,8 @@ public:
 	sm::Vec2 coords3;
 	sm::Vec3 normal;
 	sm::Vec3 tangent;
+
+	// bitangent is tangentSign * cross(normal, tangent), -1 on mirrored uvs.
+	// Not a vertex attribute, saved in the mesh's "TSGN" chunk
+	float tangentSign;
 };
@@ -0,0 +1,95 @@
+#include "SdfBaker.h"
+#include "Bvh.h"
+#include "../ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+const int SdfBaker::Padding = 2;
+
+class SdfBaker::SliceBaker
+{
+public:
+	SliceBaker(const Bvh &bvh, SdfVolume &volume) :
+		m_bvh(bvh),
+		m_volume(volume)
+	{
+	}
+
+	void operator()(int z)
+	{
+		float maxDistanceSq = m_volume.maxDistance * m_volume.maxDistance;
+
+		for (int y = 0; y < m_volume.sizeY; y++)
+		{
+			for (int x = 0; x < m_volume.sizeX; x++)
+			{
+				sm::Vec3 point(
+					m_volume.origin.x + (x + 0.5f) * m_volume.voxelSize,
+					m_volume.origin.y + (y + 0.5f) * m_volume.voxelSize,
+					m_volume.origin.z + (z + 0.5f) * m_volume.voxelSize);
+
+				int triangle;
+				float distanceSq = m_bvh.FindClosest(point, maxDistanceSq, triangle);
+				float distance = triangle != -1 ? sqrtf(distanceSq) : m_volume.maxDistance;
+
+				if (m_bvh.IsInside(point))
+					distance = -distance;
+
+				m_volume.values[(z * m_volume.sizeY + y) * m_volume.sizeX + x] = Quantize(distance, m_volume.maxDistance);
+			}
+		}
+	}
+
+private:
+	const Bvh &m_bvh;
+	SdfVolume &m_volume;
+};
+
+bool SdfBaker::Bake(const std::vector<sm::Vec3> &vertices, int resolution, float range, SdfVolume &volume)
+{
+	if (vertices.size() < 3 || resolution <= Padding * 2)
+		return false;
+
+	sm::Vec3 min = vertices[0];
+	sm::Vec3 max = vertices[0];
+
+	for (unsigned i = 1; i < vertices.size(); i++)
+	{
+		const sm::Vec3 &p = vertices[i];
+
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max.Set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	float longestSide = std::max(std::max(max.x - min.x, max.y - min.y), max.z - min.z);
+	if (longestSide <= 0.0f)
+		return false;
+
+	// padding voxels are on top of the requested resolution's inner part
+	volume.voxelSize = longestSide / (resolution - Padding * 2);
+	volume.origin = min - sm::Vec3(1.0f, 1.0f, 1.0f) * (Padding * volume.voxelSize);
+
+	volume.sizeX = (int)ceilf((max.x - min.x) / volume.voxelSize) + Padding * 2;
+	volume.sizeY = (int)ceilf((max.y - min.y) / volume.voxelSize) + Padding * 2;
+	volume.sizeZ = (int)ceilf((max.z - min.z) / volume.voxelSize) + Padding * 2;
+
+	volume.maxDistance = range * volume.voxelSize;
+	volume.values.resize(volume.sizeX * volume.sizeY * volume.sizeZ);
+
+	Bvh bvh;
+	bvh.Build(vertices);
+
+	SliceBaker sliceBaker(bvh, volume);
+	ParallelFor::Run(volume.sizeZ, sliceBaker);
+
+	return true;
+}
+
+uint8_t SdfBaker::Quantize(float distance, float maxDistance)
+{
+	float value = std::min(std::max(distance / maxDistance, -1.0f), 1.0f);
+
+	return (uint8_t)((value * 0.5f + 0.5f) * 255.0f + 0.5f);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Math/Vec3.h>
+
+#include <vector>
+#include <stdint.h>
+
+// Signed distance field sampled at voxel centers, negative inside the mesh
+class SdfVolume
+{
+public:
+	int sizeX;
+	int sizeY;
+	int sizeZ;
+
+	// corner of the first voxel, voxels are cubes
+	sm::Vec3 origin;
+	float voxelSize;
+
+	// distances are clamped to +-maxDistance and stored as
+	// (d / maxDistance * 0.5 + 0.5) * 255, x changes fastest
+	float maxDistance;
+	std::vector<uint8_t> values;
+};
+
+class SdfBaker
+{
+public:
+	// resolution is the voxels count along the longest side of the bounds,
+	// range is the clamp distance in voxels
+	static bool Bake(const std::vector<sm::Vec3> &vertices, int resolution, float range, SdfVolume &volume);
+
+private:
+	// empty margin around the mesh bounds, in voxels
+	static const int Padding;
+
+	// bakes one z slice of the volume, run by ParallelFor
+	class SliceBaker;
+
+	static uint8_t Quantize(float distance, float maxDistance);
+};
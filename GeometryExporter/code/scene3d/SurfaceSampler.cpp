@@ -0,0 +1,365 @@
+#include "SurfaceSampler.h"
+#include "../ParallelFor.h"
+
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+const int SurfaceSampler::CandidatesPerSample = 8;
+
+class SurfaceSampler::Candidate
+{
+public:
+	sm::Vec3 position;
+	sm::Vec3 normal;
+	uint32_t triangle;
+
+	// candidates of a cell are tried in the order of their keys
+	uint32_t key;
+
+	int cell[3];
+};
+
+class SurfaceSampler::Cell
+{
+public:
+	int coords[3];
+
+	int firstCandidate;
+	int candidatesCount;
+
+	// accepted candidates
+	std::vector<int> samples;
+};
+
+namespace
+{
+	// xorshift, seeded through a hash, so nearby seeds give unrelated streams
+	class Random
+	{
+	public:
+		Random(uint32_t seed) :
+			m_state(seed != 0 ? seed : 0x9e3779b9)
+		{
+		}
+
+		uint32_t Next()
+		{
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 17;
+			m_state ^= m_state << 5;
+
+			return m_state;
+		}
+
+		// [0, 1)
+		float NextFloat()
+		{
+			return (Next() >> 8) / 16777216.0f;
+		}
+
+	private:
+		uint32_t m_state;
+	};
+
+	bool CoordsLess(const int *a, const int *b)
+	{
+		for (int i = 0; i < 3; i++)
+			if (a[i] != b[i])
+				return a[i] < b[i];
+
+		return false;
+	}
+
+	class CandidateOrder
+	{
+	public:
+		template <typename Candidate>
+		bool operator()(const Candidate &a, const Candidate &b) const
+		{
+			if (CoordsLess(a.cell, b.cell))
+				return true;
+			if (CoordsLess(b.cell, a.cell))
+				return false;
+
+			if (a.key != b.key)
+				return a.key < b.key;
+
+			return a.triangle < b.triangle;
+		}
+	};
+}
+
+class SurfaceSampler::CandidateThrower
+{
+public:
+	static const int BlockSize = 256;
+
+	CandidateThrower(
+		const std::vector<sm::Vec3> &vertices,
+		float candidatesDensity,
+		uint32_t seed,
+		std::vector<std::vector<Candidate> > &blocks) :
+		m_vertices(vertices),
+		m_candidatesDensity(candidatesDensity),
+		m_seed(seed),
+		m_blocks(blocks)
+	{
+	}
+
+	void operator()(int block)
+	{
+		int trianglesCount = (int)m_vertices.size() / 3;
+		int first = block * BlockSize;
+		int last = std::min(first + BlockSize, trianglesCount);
+
+		std::vector<Candidate> &candidates = m_blocks[block];
+
+		for (int i = first; i < last; i++)
+		{
+			const sm::Vec3 &a = m_vertices[i * 3 + 0];
+			const sm::Vec3 &b = m_vertices[i * 3 + 1];
+			const sm::Vec3 &c = m_vertices[i * 3 + 2];
+
+			sm::Vec3 ab = b - a;
+			sm::Vec3 ac = c - a;
+			sm::Vec3 cross(
+				ab.y * ac.z - ab.z * ac.y,
+				ab.z * ac.x - ab.x * ac.z,
+				ab.x * ac.y - ab.y * ac.x);
+
+			float doubleArea = sqrtf(sm::Vec3::Dot(cross, cross));
+			if (doubleArea <= 0.0f)
+				continue;
+
+			sm::Vec3 normal = cross * (1.0f / doubleArea);
+
+			Random random(Hash(m_seed ^ Hash((uint32_t)i)));
+
+			// the fraction of a candidate is thrown with that probability
+			float expected = doubleArea * 0.5f * m_candidatesDensity;
+			int count = (int)expected;
+			if (random.NextFloat() < expected - count)
+				count++;
+
+			for (int j = 0; j < count; j++)
+			{
+				// uniform over the triangle
+				float u = sqrtf(random.NextFloat());
+				float v = random.NextFloat();
+
+				Candidate candidate;
+				candidate.position = a + ab * (u * (1.0f - v)) + ac * (u * v);
+				candidate.normal = normal;
+				candidate.triangle = (uint32_t)i;
+				candidate.key = random.Next();
+
+				candidates.push_back(candidate);
+			}
+		}
+	}
+
+private:
+	const std::vector<sm::Vec3> &m_vertices;
+	float m_candidatesDensity;
+	uint32_t m_seed;
+	std::vector<std::vector<Candidate> > &m_blocks;
+};
+
+class SurfaceSampler::CellThinner
+{
+public:
+	CellThinner(
+		const std::vector<Candidate> &candidates,
+		std::vector<Cell> &cells,
+		const std::vector<int> &phaseCells,
+		float radius) :
+		m_candidates(candidates),
+		m_cells(cells),
+		m_phaseCells(phaseCells),
+		m_radiusSq(radius * radius)
+	{
+	}
+
+	void operator()(int phaseCell)
+	{
+		Cell &cell = m_cells[m_phaseCells[phaseCell]];
+
+		// the cell is as big as the radius, so only direct neighbours can hold
+		// samples too close. They belong to other phases and don't change now.
+		std::vector<const Cell*> neighbours;
+
+		for (int z = -1; z <= 1; z++)
+		{
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					int coords[3] = { cell.coords[0] + x, cell.coords[1] + y, cell.coords[2] + z };
+
+					const Cell *neighbour = FindCell(coords);
+					if (neighbour != NULL && neighbour != &cell && neighbour->samples.size() > 0)
+						neighbours.push_back(neighbour);
+				}
+			}
+		}
+
+		for (int i = cell.firstCandidate; i < cell.firstCandidate + cell.candidatesCount; i++)
+		{
+			const sm::Vec3 &position = m_candidates[i].position;
+
+			bool tooClose = IsTooClose(cell, position);
+			for (unsigned j = 0; j < neighbours.size() && !tooClose; j++)
+				tooClose = IsTooClose(*neighbours[j], position);
+
+			if (!tooClose)
+				cell.samples.push_back(i);
+		}
+	}
+
+private:
+	const std::vector<Candidate> &m_candidates;
+	std::vector<Cell> &m_cells;
+	const std::vector<int> &m_phaseCells;
+	float m_radiusSq;
+
+	const Cell* FindCell(const int *coords) const
+	{
+		int first = 0;
+		int count = (int)m_cells.size();
+
+		while (count > 0)
+		{
+			int step = count / 2;
+
+			if (CoordsLess(m_cells[first + step].coords, coords))
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+				count = step;
+		}
+
+		if (first < (int)m_cells.size() && !CoordsLess(coords, m_cells[first].coords))
+			return &m_cells[first];
+
+		return NULL;
+	}
+
+	bool IsTooClose(const Cell &cell, const sm::Vec3 &position) const
+	{
+		for (unsigned i = 0; i < cell.samples.size(); i++)
+		{
+			sm::Vec3 d = m_candidates[cell.samples[i]].position - position;
+
+			if (sm::Vec3::Dot(d, d) < m_radiusSq)
+				return true;
+		}
+
+		return false;
+	}
+};
+
+float SurfaceSampler::Generate(const std::vector<sm::Vec3> &vertices, float density, uint32_t seed, std::vector<Sample> &samples)
+{
+	samples.clear();
+
+	int trianglesCount = (int)vertices.size() / 3;
+	if (trianglesCount == 0 || density <= 0.0f)
+		return 0.0f;
+
+	// thinning a limited set of candidates ends at about half of the densest
+	// packing, 2 / (sqrt(3) * radius^2) samples per square unit
+	float radius = sqrtf(0.5f * 2.0f / (1.7320508f * density));
+
+	int blocksCount = (trianglesCount + CandidateThrower::BlockSize - 1) / CandidateThrower::BlockSize;
+	std::vector<std::vector<Candidate> > blocks(blocksCount);
+
+	CandidateThrower candidateThrower(vertices, density * CandidatesPerSample, seed, blocks);
+	ParallelFor::Run(blocksCount, candidateThrower);
+
+	std::vector<Candidate> candidates;
+	for (int i = 0; i < blocksCount; i++)
+		candidates.insert(candidates.end(), blocks[i].begin(), blocks[i].end());
+
+	if (candidates.size() == 0)
+		return radius;
+
+	sm::Vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	for (unsigned i = 0; i < candidates.size(); i++)
+	{
+		const sm::Vec3 &p = candidates[i].position;
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+	}
+
+	for (unsigned i = 0; i < candidates.size(); i++)
+	{
+		sm::Vec3 cell = (candidates[i].position - min) * (1.0f / radius);
+
+		candidates[i].cell[0] = (int)cell.x;
+		candidates[i].cell[1] = (int)cell.y;
+		candidates[i].cell[2] = (int)cell.z;
+	}
+
+	std::sort(candidates.begin(), candidates.end(), CandidateOrder());
+
+	std::vector<Cell> cells;
+	std::vector<int> phaseCells[8];
+
+	for (int i = 0; i < (int)candidates.size(); i++)
+	{
+		if (cells.size() > 0 &&
+			!CoordsLess(cells.back().coords, candidates[i].cell) &&
+			!CoordsLess(candidates[i].cell, cells.back().coords))
+		{
+			cells.back().candidatesCount++;
+			continue;
+		}
+
+		cells.push_back(Cell());
+		Cell &cell = cells.back();
+
+		for (int j = 0; j < 3; j++)
+			cell.coords[j] = candidates[i].cell[j];
+		cell.firstCandidate = i;
+		cell.candidatesCount = 1;
+
+		int phase = (cell.coords[0] & 1) | ((cell.coords[1] & 1) << 1) | ((cell.coords[2] & 1) << 2);
+		phaseCells[phase].push_back((int)cells.size() - 1);
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		CellThinner cellThinner(candidates, cells, phaseCells[i], radius);
+		ParallelFor::Run((int)phaseCells[i].size(), cellThinner);
+	}
+
+	for (unsigned i = 0; i < cells.size(); i++)
+	{
+		for (unsigned j = 0; j < cells[i].samples.size(); j++)
+		{
+			const Candidate &candidate = candidates[cells[i].samples[j]];
+
+			Sample sample;
+			sample.position = candidate.position;
+			sample.normal = candidate.normal;
+			sample.triangle = candidate.triangle;
+
+			samples.push_back(sample);
+		}
+	}
+
+	return radius;
+}
+
+uint32_t SurfaceSampler::Hash(uint32_t value)
+{
+	value ^= value >> 16;
+	value *= 0x7feb352d;
+	value ^= value >> 15;
+	value *= 0x846ca68b;
+	value ^= value >> 16;
+
+	return value;
+}
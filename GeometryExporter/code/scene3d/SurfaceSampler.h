@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Math/Vec3.h>
+
+#include <vector>
+#include <stdint.h>
+
+// Poisson disk samples on a triangle soup: no two samples are closer than
+// the radius picked for the requested density. Candidates are thrown per
+// triangle from a seed, then thinned out on a grid. Grid cells are taken
+// in 8 phases by the parity of their coordinates, cells of one phase don't
+// see each other, so they are thinned on many threads and the result
+// only depends on the seed.
+class SurfaceSampler
+{
+public:
+	class Sample
+	{
+	public:
+		sm::Vec3 position;
+		sm::Vec3 normal;
+
+		// index of the triangle in the given vertices
+		uint32_t triangle;
+	};
+
+	// density is in samples per square unit, vertices are three per triangle.
+	// Returns the minimal distance between samples.
+	static float Generate(const std::vector<sm::Vec3> &vertices, float density, uint32_t seed, std::vector<Sample> &samples);
+
+private:
+	// candidates thrown per expected sample
+	static const int CandidatesPerSample;
+
+	class Candidate;
+	class Cell;
+
+	// throws candidates on one triangle, run by ParallelFor
+	class CandidateThrower;
+
+	// thins out the candidates of the cells of one phase, run by ParallelFor
+	class CellThinner;
+
+	static uint32_t Hash(uint32_t value);
+};
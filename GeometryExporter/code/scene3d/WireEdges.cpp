@@ -0,0 +1,129 @@
+#include "WireEdges.h"
+#include <Utils/Log.h>
+
+#include <map>
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	class PositionOrder
+	{
+	public:
+		bool operator()(const sm::Vec3 &a, const sm::Vec3 &b) const
+		{
+			if (a.x != b.x)
+				return a.x < b.x;
+			if (a.y != b.y)
+				return a.y < b.y;
+			return a.z < b.z;
+		}
+	};
+
+	class Edge
+	{
+	public:
+		// vertices of the first triangle using the edge, they go to the line list
+		uint32_t a;
+		uint32_t b;
+
+		sm::Vec3 firstNormal;
+		float maxAngleCos;
+		int facesCount;
+	};
+}
+
+void WireEdges::Build(const Scene3DMeshPart *meshPart, float featureAngle, std::vector<uint32_t> &lines)
+{
+	lines.clear();
+
+	// every vertex gets the id of the first vertex at the same position
+	std::map<sm::Vec3, uint32_t, PositionOrder> positions;
+	std::vector<uint32_t> positionIds(meshPart->vertices.size());
+
+	for (unsigned i = 0; i < meshPart->vertices.size(); i++)
+		positionIds[i] = positions.insert(std::make_pair(meshPart->vertices[i]->position, (uint32_t)i)).first->second;
+
+	std::map<std::pair<uint32_t, uint32_t>, Edge> edges;
+	std::vector<std::pair<uint32_t, uint32_t> > order;
+
+	unsigned trianglesCount = (unsigned)meshPart->indices.size() / 3;
+
+	for (unsigned i = 0; i < trianglesCount; i++)
+	{
+		const uint32_t *triangle = &meshPart->indices[i * 3];
+
+		const sm::Vec3 &p0 = meshPart->vertices[triangle[0]]->position;
+		const sm::Vec3 &p1 = meshPart->vertices[triangle[1]]->position;
+		const sm::Vec3 &p2 = meshPart->vertices[triangle[2]]->position;
+
+		sm::Vec3 e1 = p1 - p0;
+		sm::Vec3 e2 = p2 - p0;
+		sm::Vec3 normal(
+			e1.y * e2.z - e1.z * e2.y,
+			e1.z * e2.x - e1.x * e2.z,
+			e1.x * e2.y - e1.y * e2.x);
+
+		float length = sqrtf(sm::Vec3::Dot(normal, normal));
+		if (length == 0.0f)
+			continue; // degenerate, has no edges worth drawing
+
+		normal = normal * (1.0f / length);
+
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t a = triangle[j];
+			uint32_t b = triangle[(j + 1) % 3];
+
+			uint32_t idA = positionIds[a];
+			uint32_t idB = positionIds[b];
+
+			if (idA == idB)
+				continue;
+
+			std::pair<uint32_t, uint32_t> key(std::min(idA, idB), std::max(idA, idB));
+
+			std::map<std::pair<uint32_t, uint32_t>, Edge>::iterator it = edges.find(key);
+			if (it == edges.end())
+			{
+				Edge edge;
+				edge.a = a;
+				edge.b = b;
+				edge.firstNormal = normal;
+				edge.maxAngleCos = 1.0f;
+				edge.facesCount = 1;
+
+				edges[key] = edge;
+				order.push_back(key);
+			}
+			else
+			{
+				Edge &edge = it->second;
+				edge.maxAngleCos = std::min(edge.maxAngleCos, sm::Vec3::Dot(edge.firstNormal, normal));
+				edge.facesCount++;
+			}
+		}
+	}
+
+	float featureCos = cosf(featureAngle * 3.14159265f / 180.0f);
+
+	// first use order keeps the lines as coherent as the triangles were
+	for (unsigned i = 0; i < order.size(); i++)
+	{
+		const Edge &edge = edges[order[i]];
+
+		bool keep =
+			featureAngle <= 0.0f ||
+			edge.facesCount != 2 ||
+			edge.maxAngleCos < featureCos;
+
+		if (keep)
+		{
+			lines.push_back(edge.a);
+			lines.push_back(edge.b);
+		}
+	}
+
+	Log::LogT("wire: %d triangles, %d unique edges, %d lines kept",
+		trianglesCount, (int)edges.size(), (int)lines.size() / 2);
+}
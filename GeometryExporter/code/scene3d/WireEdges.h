@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Scene3DMeshPart.h"
+
+class WireEdges
+{
+public:
+	// Builds a line list with every edge of the indexed part drawn once. Edges
+	// are compared by vertex positions, so uv and normal seams don't double them.
+	// With featureAngle above 0 (degrees), only edges where the faces meet at a
+	// larger angle are kept, together with open and non-manifold edges.
+	static void Build(const Scene3DMeshPart *meshPart, float featureAngle, std::vector<uint32_t> &lines);
+};
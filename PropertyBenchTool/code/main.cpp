@@ -0,0 +1,184 @@
+#include "../../GeometryExporter/code/Property.h"
+#include "../../GeometryExporter/code/PropertyTable.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+// Evaluates the same animated properties every frame one by one through
+// Property::Evaluate and all at once through PropertyTable, checks they
+// agree and prints how long a frame takes each way. Properties are made
+// up like the demo's material and uniform ones: floats and vectors, linear
+// and tcb, and some state ints.
+//
+// PropertyBenchTool [-properties n] [-keys n] [-frames n]
+//
+// Sources don't depend on Windows, outside of it the tool builds with
+// something like
+//
+// g++ -O2 -I<Framework> code/main.cpp ../GeometryExporter/code/PropertyTable.cpp
+
+namespace
+{
+	const float Duration = 10.0f;
+
+	float Random(float min, float max)
+	{
+		return min + (max - min) * (float)rand() / (float)RAND_MAX;
+	}
+
+	Property* CreateProperty(unsigned index, unsigned keysCount)
+	{
+		char name[32];
+		sprintf(name, "property%u", index);
+
+		Property *prop = NULL;
+
+		switch (index % 4)
+		{
+		case 0: prop = new Property(name, Property::PropertyType_Float, Property::AnimationType_Linear); break;
+		case 1: prop = new Property(name, Property::PropertyType_Float, Property::AnimationType_TCB); break;
+		case 2: prop = new Property(name, Property::PropertyType_Vector3, Property::AnimationType_TCB); break;
+		case 3: prop = new Property(name, Property::PropertyType_Int, Property::AnimationType_State); break;
+		}
+
+		// unevenly spaced keys over the whole duration
+		float step = Duration / (float)keysCount;
+
+		for (unsigned i = 0; i < keysCount; i++)
+		{
+			float time = step * ((float)i + Random(0.0f, 0.9f));
+
+			switch (prop->GetPropertyType())
+			{
+			case Property::PropertyType_Float: prop->SetValue(Random(-1.0f, 1.0f), time); break;
+			case Property::PropertyType_Vector3: prop->SetValue(sm::Vec3(Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f)), time); break;
+			case Property::PropertyType_Int: prop->SetValue(rand() % 16, time); break;
+			default: break;
+			}
+		}
+
+		return prop;
+	}
+
+	double GetSeconds(clock_t start)
+	{
+		return (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int propertiesCount = 500;
+	int keysCount = 300;
+	int framesCount = 10000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-properties") == 0 && i + 1 < argc)
+			propertiesCount = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-keys") == 0 && i + 1 < argc)
+			keysCount = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+			framesCount = atoi(argv[++i]);
+		else
+			propertiesCount = 0;
+	}
+
+	if (propertiesCount < 1 || keysCount < 1 || framesCount < 1)
+	{
+		printf("usage: PropertyBenchTool [-properties n] [-keys n] [-frames n]\n");
+		return 1;
+	}
+
+	srand(1);
+
+	std::vector<Property*> properties;
+	std::vector<int> firstChannels;
+
+	PropertyTable table;
+
+	for (int i = 0; i < propertiesCount; i++)
+	{
+		properties.push_back(CreateProperty(i, keysCount));
+		firstChannels.push_back(table.Add(properties.back()));
+	}
+
+	std::vector<float> propertyOutput(table.GetChannelsCount());
+	std::vector<float> tableOutput(table.GetChannelsCount());
+
+	float frameStep = Duration / (float)framesCount;
+
+	// the output is summed up, so the compiler can't drop the evaluation
+	float sum = 0.0f;
+
+	clock_t start = clock();
+
+	for (int i = 0; i < framesCount; i++)
+	{
+		float time = frameStep * (float)i;
+
+		for (unsigned j = 0; j < properties.size(); j++)
+		{
+			Property::Value value = properties[j]->Evaluate(time);
+
+			for (unsigned k = 0; k < properties[j]->GetComponentsCount(); k++)
+				propertyOutput[firstChannels[j] + k] = properties[j]->GetComponent(value, k);
+		}
+
+		sum += propertyOutput[i % propertyOutput.size()];
+	}
+
+	double propertySeconds = GetSeconds(start);
+
+	start = clock();
+
+	for (int i = 0; i < framesCount; i++)
+	{
+		table.Evaluate(frameStep * (float)i, &tableOutput[0]);
+
+		sum += tableOutput[i % tableOutput.size()];
+	}
+
+	double tableSeconds = GetSeconds(start);
+
+	// not timed, both ways once more for every frame
+	float maxError = 0.0f;
+
+	for (int i = 0; i < framesCount; i++)
+	{
+		float time = frameStep * (float)i;
+
+		table.Evaluate(time, &tableOutput[0]);
+
+		for (unsigned j = 0; j < properties.size(); j++)
+		{
+			Property::Value value = properties[j]->Evaluate(time);
+
+			for (unsigned k = 0; k < properties[j]->GetComponentsCount(); k++)
+			{
+				float expected = properties[j]->GetComponent(value, k);
+				float result = tableOutput[firstChannels[j] + k];
+
+				if (properties[j]->GetPropertyType() == Property::PropertyType_Int)
+					result = floorf(result + 0.5f);
+
+				maxError = std::max(maxError, fabsf(expected - result));
+			}
+		}
+	}
+
+	printf("%d properties, %u channels, %d keys, %d frames\n", propertiesCount, table.GetChannelsCount(), keysCount, framesCount);
+	printf("Property::Evaluate: %.4f ms per frame\n", propertySeconds * 1000.0 / (double)framesCount);
+	printf("PropertyTable:      %.4f ms per frame\n", tableSeconds * 1000.0 / (double)framesCount);
+	printf("largest difference %g (checksum %g)\n", maxError, sum);
+
+	for (unsigned i = 0; i < properties.size(); i++)
+		delete properties[i];
+
+	return maxError < 0.001f ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#include "CentroidTree.h"
+
+#include <algorithm>
+
+const int CentroidTree::LeafSize = 8;
+
+namespace
+{
+	class AxisOrder
+	{
+	public:
+		AxisOrder(const std::vector<sm::Vec3> &points, int axis) :
+			m_points(points),
+			m_axis(axis)
+		{
+		}
+
+		bool operator()(int a, int b) const
+		{
+			const sm::Vec3 &pa = m_points[a];
+			const sm::Vec3 &pb = m_points[b];
+
+			float va = m_axis == 0 ? pa.x : (m_axis == 1 ? pa.y : pa.z);
+			float vb = m_axis == 0 ? pb.x : (m_axis == 1 ? pb.y : pb.z);
+
+			if (va != vb)
+				return va < vb;
+
+			return a < b;
+		}
+
+	private:
+		const std::vector<sm::Vec3> &m_points;
+		int m_axis;
+	};
+}
+
+void CentroidTree::Build(const std::vector<sm::Vec3> &points)
+{
+	m_points = points;
+	m_removed.assign(points.size(), false);
+	m_leafs.assign(points.size(), -1);
+	m_nodes.clear();
+
+	m_order.resize(points.size());
+	for (unsigned i = 0; i < points.size(); i++)
+		m_order[i] = (int)i;
+
+	if (points.size() > 0)
+		BuildNode(-1, 0, (int)points.size());
+}
+
+int CentroidTree::BuildNode(int parent, int begin, int end)
+{
+	int nodeIndex = (int)m_nodes.size();
+
+	Node node;
+	node.parent = parent;
+	node.axis = 0;
+	node.split = 0.0f;
+	node.left = -1;
+	node.right = -1;
+	node.begin = begin;
+	node.end = end;
+	node.pointsCount = end - begin;
+
+	m_nodes.push_back(node);
+
+	if (end - begin <= LeafSize)
+	{
+		for (int i = begin; i < end; i++)
+			m_leafs[m_order[i]] = nodeIndex;
+
+		return nodeIndex;
+	}
+
+	sm::Vec3 min = m_points[m_order[begin]];
+	sm::Vec3 max = min;
+
+	for (int i = begin + 1; i < end; i++)
+	{
+		const sm::Vec3 &p = m_points[m_order[i]];
+
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max.Set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	int axis = 0;
+	if (max.y - min.y > GetAxis(max, axis) - GetAxis(min, axis))
+		axis = 1;
+	if (max.z - min.z > GetAxis(max, axis) - GetAxis(min, axis))
+		axis = 2;
+
+	int middle = (begin + end) / 2;
+	std::nth_element(m_order.begin() + begin, m_order.begin() + middle, m_order.begin() + end, AxisOrder(m_points, axis));
+
+	// children reorder their ranges, so the split is taken first
+	float split = GetAxis(m_points[m_order[middle]], axis);
+
+	// m_nodes may grow below, don't keep references to it
+	int left = BuildNode(nodeIndex, begin, middle);
+	int right = BuildNode(nodeIndex, middle, end);
+
+	m_nodes[nodeIndex].axis = axis;
+	m_nodes[nodeIndex].split = split;
+	m_nodes[nodeIndex].left = left;
+	m_nodes[nodeIndex].right = right;
+
+	return nodeIndex;
+}
+
+int CentroidTree::FindNearest(const sm::Vec3 &point) const
+{
+	int nearest = -1;
+	float nearestDistance = 0.0f;
+
+	if (m_nodes.size() > 0)
+		FindNearest(0, point, nearest, nearestDistance);
+
+	return nearest;
+}
+
+void CentroidTree::FindNearest(int nodeIndex, const sm::Vec3 &point, int &nearest, float &nearestDistance) const
+{
+	const Node &node = m_nodes[nodeIndex];
+
+	if (node.pointsCount == 0)
+		return;
+
+	if (node.left == -1)
+	{
+		for (int i = node.begin; i < node.end; i++)
+		{
+			int index = m_order[i];
+			if (m_removed[index])
+				continue;
+
+			sm::Vec3 d = m_points[index] - point;
+			float distance = d.x * d.x + d.y * d.y + d.z * d.z;
+
+			if (nearest == -1 || distance < nearestDistance || (distance == nearestDistance && index < nearest))
+			{
+				nearest = index;
+				nearestDistance = distance;
+			}
+		}
+
+		return;
+	}
+
+	float planeDistance = GetAxis(point, node.axis) - node.split;
+
+	int nearChild = planeDistance < 0.0f ? node.left : node.right;
+	int farChild = planeDistance < 0.0f ? node.right : node.left;
+
+	FindNearest(nearChild, point, nearest, nearestDistance);
+
+	if (nearest == -1 || planeDistance * planeDistance <= nearestDistance)
+		FindNearest(farChild, point, nearest, nearestDistance);
+}
+
+void CentroidTree::Remove(int index)
+{
+	if (m_removed[index])
+		return;
+
+	m_removed[index] = true;
+
+	for (int nodeIndex = m_leafs[index]; nodeIndex != -1; nodeIndex = m_nodes[nodeIndex].parent)
+		m_nodes[nodeIndex].pointsCount--;
+}
+
+float CentroidTree::GetAxis(const sm::Vec3 &v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
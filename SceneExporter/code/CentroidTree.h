@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Math\Vec3.h>
+
+#include <vector>
+
+// k-d tree over a fixed set of points. Points can be removed, so it also
+// serves greedy matching where every point is taken at most once.
+class CentroidTree
+{
+public:
+	void Build(const std::vector<sm::Vec3> &points);
+
+	// index of the nearest point still in the tree, -1 when it's empty
+	int FindNearest(const sm::Vec3 &point) const;
+
+	void Remove(int index);
+
+private:
+	static const int LeafSize;
+
+	class Node
+	{
+	public:
+		int parent;
+
+		// inner nodes, children are -1 for leafs
+		int axis;
+		float split;
+		int left;
+		int right;
+
+		// leafs, range in m_order
+		int begin;
+		int end;
+
+		// points of the subtree not removed yet
+		int pointsCount;
+	};
+
+	std::vector<sm::Vec3> m_points;
+	std::vector<bool> m_removed;
+	std::vector<int> m_order;
+	std::vector<int> m_leafs;
+	std::vector<Node> m_nodes;
+
+	int BuildNode(int parent, int begin, int end);
+	void FindNearest(int nodeIndex, const sm::Vec3 &point, int &nearest, float &nearestDistance) const;
+
+	static float GetAxis(const sm::Vec3 &v, int axis);
+};
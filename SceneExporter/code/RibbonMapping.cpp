@@ -0,0 +1,438 @@
+#include "RibbonMapping.h"
+#include "CentroidTree.h"
+
+#include <fstream>
+#include <algorithm>
+#include <math.h>
+
+const int RibbonMapping::InstanceSize = 28;
+
+namespace
+{
+	class CodeOrder
+	{
+	public:
+		CodeOrder(const std::vector<uint32_t> &codes) : m_codes(codes) {}
+
+		bool operator()(int a, int b) const
+		{
+			if (m_codes[a] != m_codes[b])
+				return m_codes[a] < m_codes[b];
+
+			return a < b;
+		}
+
+	private:
+		const std::vector<uint32_t> &m_codes;
+	};
+
+	class PairOrder
+	{
+	public:
+		bool operator()(const RibbonMapping::Pair &a, const RibbonMapping::Pair &b) const
+		{
+			if (a.source != b.source)
+				return a.source < b.source;
+
+			return a.destination < b.destination;
+		}
+	};
+
+	class JobsQueue
+	{
+	public:
+		std::vector<RibbonMapping::Job> *jobs;
+		volatile LONG next;
+	};
+}
+
+bool RibbonMapping::Build(
+	const std::vector<sm::Vec3> &sourceVertices,
+	const std::vector<sm::Vec3> &destinationVertices,
+	std::vector<Pair> &pairs)
+{
+	pairs.clear();
+
+	std::vector<sm::Vec3> sourceCentroids;
+	std::vector<sm::Vec3> destinationCentroids;
+
+	GetCentroids(sourceVertices, sourceCentroids);
+	GetCentroids(destinationVertices, destinationCentroids);
+
+	if (sourceCentroids.size() == 0 || destinationCentroids.size() == 0)
+		return false;
+
+	bool sourceBigger = sourceCentroids.size() >= destinationCentroids.size();
+
+	const std::vector<sm::Vec3> &big = sourceBigger ? sourceCentroids : destinationCentroids;
+	const std::vector<sm::Vec3> &small = sourceBigger ? destinationCentroids : sourceCentroids;
+
+	// triangle of the small mesh each triangle of the big one is paired with
+	std::vector<int> assigned(big.size(), -1);
+	std::vector<int> pairsCount(small.size(), 0);
+
+	// going in morton order keeps neighbouring triangles picking neighbours
+	std::vector<int> smallOrder;
+	std::vector<int> bigOrder;
+	GetMortonOrder(small, smallOrder);
+	GetMortonOrder(big, bigOrder);
+
+	CentroidTree bigTree;
+	bigTree.Build(big);
+
+	for (unsigned i = 0; i < smallOrder.size(); i++)
+	{
+		int index = smallOrder[i];
+		int nearest = bigTree.FindNearest(small[index]);
+
+		bigTree.Remove(nearest);
+		assigned[nearest] = index;
+		pairsCount[index] = 1;
+	}
+
+	int capacity = (int)((big.size() + small.size() - 1) / small.size());
+
+	CentroidTree smallTree;
+	smallTree.Build(small);
+
+	if (capacity == 1)
+	{
+		for (unsigned i = 0; i < small.size(); i++)
+			smallTree.Remove((int)i);
+	}
+
+	for (unsigned i = 0; i < bigOrder.size(); i++)
+	{
+		int index = bigOrder[i];
+		if (assigned[index] != -1)
+			continue;
+
+		int nearest = smallTree.FindNearest(big[index]);
+
+		assigned[index] = nearest;
+		if (++pairsCount[nearest] == capacity)
+			smallTree.Remove(nearest);
+	}
+
+	pairs.resize(big.size());
+
+	for (unsigned i = 0; i < big.size(); i++)
+	{
+		pairs[i].source = sourceBigger ? (int)i : assigned[i];
+		pairs[i].destination = sourceBigger ? assigned[i] : (int)i;
+	}
+
+	std::sort(pairs.begin(), pairs.end(), PairOrder());
+
+	return true;
+}
+
+void RibbonMapping::BuildInstances(
+	const std::vector<sm::Vec3> &vertices,
+	const std::vector<sm::Vec3> &pathPoints,
+	float pathDelay,
+	bool destination,
+	std::vector<Instance> &instances)
+{
+	instances.resize(vertices.size() / 3);
+
+	for (unsigned i = 0; i < instances.size(); i++)
+	{
+		const sm::Vec3 &a = vertices[i * 3 + 0];
+		const sm::Vec3 &b = vertices[i * 3 + 1];
+		const sm::Vec3 &c = vertices[i * 3 + 2];
+
+		Instance &instance = instances[i];
+
+		instance.centroid.Set(
+			(a.x + b.x + c.x) / 3.0f,
+			(a.y + b.y + c.y) / 3.0f,
+			(a.z + b.z + c.z) / 3.0f);
+
+		sm::Vec3 e1 = b - a;
+		sm::Vec3 e2 = c - a;
+		sm::Vec3 cross(
+			e1.y * e2.z - e1.z * e2.y,
+			e1.z * e2.x - e1.x * e2.z,
+			e1.x * e2.y - e1.y * e2.x);
+
+		float length = sqrtf(sm::Vec3::Dot(cross, cross));
+
+		instance.area = length * 0.5f;
+		instance.normal = length > 0.0f ? cross * (1.0f / length) : sm::Vec3(0.0f, 0.0f, 0.0f);
+		instance.delay = 0.0f;
+	}
+
+	if (pathPoints.size() < 2 || instances.size() == 0)
+		return;
+
+	// source leaves at the first key, destination is entered at the last one
+	sm::Vec3 origin = destination ? pathPoints[pathPoints.size() - 1] : pathPoints[0];
+	sm::Vec3 direction = destination ?
+		pathPoints[pathPoints.size() - 1] - pathPoints[pathPoints.size() - 2] :
+		pathPoints[1] - pathPoints[0];
+
+	float directionLength = sqrtf(sm::Vec3::Dot(direction, direction));
+	if (directionLength == 0.0f)
+		return;
+
+	direction = direction * (1.0f / directionLength);
+
+	std::vector<float> distances(instances.size());
+	float minDistance = 0.0f;
+	float maxDistance = 0.0f;
+
+	for (unsigned i = 0; i < instances.size(); i++)
+	{
+		distances[i] = sm::Vec3::Dot(instances[i].centroid - origin, direction);
+
+		if (i == 0 || distances[i] < minDistance)
+			minDistance = distances[i];
+		if (i == 0 || distances[i] > maxDistance)
+			maxDistance = distances[i];
+	}
+
+	if (maxDistance - minDistance <= 0.0f)
+		return;
+
+	for (unsigned i = 0; i < instances.size(); i++)
+	{
+		float t = (distances[i] - minDistance) / (maxDistance - minDistance);
+
+		// source triangles furthest along the path leave first
+		instances[i].delay = pathDelay * (destination ? t : 1.0f - t);
+	}
+}
+
+bool RibbonMapping::Save(
+	const std::string &fileName,
+	const std::vector<int> &sourcePartTriangles,
+	const std::vector<int> &destinationPartTriangles,
+	const std::vector<Pair> &pairs,
+	const std::vector<Instance> &sourceInstances,
+	const std::vector<Instance> &destinationInstances)
+{
+	std::ofstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	BinaryWriter bw(&file);
+
+	/*
+
+	1.0
+		- source and destination triangle counts, pairs count
+		- pairs of source and destination triangle indices, sorted by source
+
+	1.1
+		- source and destination instance buffers after the pairs: int count,
+		  int stride, then per triangle float3 centroid, float area,
+		  snorm16x4 normal (w is 0) and float delay
+
+	1.2
+		- triangles are indexed in the order of the exported .geo, the mesh's
+		  parts one after another. After the pairs count, int source parts
+		  count and int triangles count per part, then the same for the
+		  destination
+
+	*/
+
+	bw.Write("RIBMAP", 6);
+	bw.Write((unsigned short)((1 << 8) | 2)); // version 1.2
+
+	bw.Write((int)sourceInstances.size());
+	bw.Write((int)destinationInstances.size());
+	bw.Write((int)pairs.size());
+
+	SavePartTriangles(bw, sourcePartTriangles);
+	SavePartTriangles(bw, destinationPartTriangles);
+
+	for (unsigned i = 0; i < pairs.size(); i++)
+	{
+		bw.Write(pairs[i].source);
+		bw.Write(pairs[i].destination);
+	}
+
+	SaveInstances(bw, sourceInstances);
+	SaveInstances(bw, destinationInstances);
+
+	file.close();
+
+	return !file.fail();
+}
+
+void RibbonMapping::SavePartTriangles(BinaryWriter &bw, const std::vector<int> &partTriangles)
+{
+	bw.Write((int)partTriangles.size());
+
+	for (unsigned i = 0; i < partTriangles.size(); i++)
+		bw.Write(partTriangles[i]);
+}
+
+void RibbonMapping::SaveInstances(BinaryWriter &bw, const std::vector<Instance> &instances)
+{
+	bw.Write((int)instances.size());
+	bw.Write(InstanceSize);
+
+	for (unsigned i = 0; i < instances.size(); i++)
+	{
+		const Instance &instance = instances[i];
+
+		bw.Write(instance.centroid.x);
+		bw.Write(instance.centroid.y);
+		bw.Write(instance.centroid.z);
+		bw.Write(instance.area);
+		bw.Write((uint16_t)ToSnorm16(instance.normal.x));
+		bw.Write((uint16_t)ToSnorm16(instance.normal.y));
+		bw.Write((uint16_t)ToSnorm16(instance.normal.z));
+		bw.Write((uint16_t)0);
+		bw.Write(instance.delay);
+	}
+}
+
+int16_t RibbonMapping::ToSnorm16(float value)
+{
+	value = std::min(std::max(value, -1.0f), 1.0f);
+
+	return (int16_t)(value >= 0.0f ? value * 32767.0f + 0.5f : value * 32767.0f - 0.5f);
+}
+
+void RibbonMapping::Run(std::vector<Job> &jobs)
+{
+	if (jobs.size() == 0)
+		return;
+
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+
+	unsigned threadsCount = std::min((unsigned)systemInfo.dwNumberOfProcessors, (unsigned)jobs.size());
+	if (threadsCount < 1)
+		threadsCount = 1;
+
+	JobsQueue queue;
+	queue.jobs = &jobs;
+	queue.next = 0;
+
+	std::vector<HANDLE> threads;
+
+	for (unsigned i = 0; i < threadsCount; i++)
+	{
+		DWORD threadId;
+		HANDLE hThread = CreateThread(NULL, 0, JobsThread, &queue, 0, &threadId);
+
+		if (hThread != NULL)
+			threads.push_back(hThread);
+	}
+
+	// no thread could be started, do the work here
+	if (threads.size() == 0)
+		JobsThread(&queue);
+
+	for (unsigned i = 0; i < threads.size(); i++)
+	{
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+	}
+}
+
+DWORD WINAPI RibbonMapping::JobsThread(LPVOID param)
+{
+	JobsQueue *queue = (JobsQueue*)param;
+
+	while (true)
+	{
+		LONG index = InterlockedIncrement(&queue->next) - 1;
+		if (index >= (LONG)queue->jobs->size())
+			break;
+
+		Job &job = (*queue->jobs)[index];
+
+		std::vector<Pair> pairs;
+		std::vector<Instance> sourceInstances;
+		std::vector<Instance> destinationInstances;
+
+		BuildInstances(*job.sourceVertices, job.pathPoints, job.pathDelay, false, sourceInstances);
+		BuildInstances(*job.destinationVertices, job.pathPoints, job.pathDelay, true, destinationInstances);
+
+		job.result =
+			Build(*job.sourceVertices, *job.destinationVertices, pairs) &&
+			Save(job.fileName, *job.sourcePartTriangles, *job.destinationPartTriangles, pairs, sourceInstances, destinationInstances);
+		job.pairsCount = (int)pairs.size();
+	}
+
+	return 0;
+}
+
+void RibbonMapping::GetCentroids(const std::vector<sm::Vec3> &vertices, std::vector<sm::Vec3> &centroids)
+{
+	centroids.resize(vertices.size() / 3);
+
+	for (unsigned i = 0; i < centroids.size(); i++)
+	{
+		const sm::Vec3 &a = vertices[i * 3 + 0];
+		const sm::Vec3 &b = vertices[i * 3 + 1];
+		const sm::Vec3 &c = vertices[i * 3 + 2];
+
+		centroids[i].Set(
+			(a.x + b.x + c.x) / 3.0f,
+			(a.y + b.y + c.y) / 3.0f,
+			(a.z + b.z + c.z) / 3.0f);
+	}
+}
+
+void RibbonMapping::GetMortonOrder(const std::vector<sm::Vec3> &points, std::vector<int> &order)
+{
+	order.resize(points.size());
+	if (points.size() == 0)
+		return;
+
+	sm::Vec3 min = points[0];
+	sm::Vec3 max = points[0];
+
+	for (unsigned i = 1; i < points.size(); i++)
+	{
+		const sm::Vec3 &p = points[i];
+
+		min.Set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max.Set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	float sizeX = max.x - min.x > 0.0f ? max.x - min.x : 1.0f;
+	float sizeY = max.y - min.y > 0.0f ? max.y - min.y : 1.0f;
+	float sizeZ = max.z - min.z > 0.0f ? max.z - min.z : 1.0f;
+
+	std::vector<uint32_t> codes(points.size());
+
+	for (unsigned i = 0; i < points.size(); i++)
+	{
+		codes[i] = MortonCode(
+			(points[i].x - min.x) / sizeX,
+			(points[i].y - min.y) / sizeY,
+			(points[i].z - min.z) / sizeZ);
+		order[i] = (int)i;
+	}
+
+	std::sort(order.begin(), order.end(), CodeOrder(codes));
+}
+
+uint32_t RibbonMapping::MortonCode(float x, float y, float z)
+{
+	uint32_t coords[3] =
+	{
+		(uint32_t)std::min(std::max(x * 1024.0f, 0.0f), 1023.0f),
+		(uint32_t)std::min(std::max(y * 1024.0f, 0.0f), 1023.0f),
+		(uint32_t)std::min(std::max(z * 1024.0f, 0.0f), 1023.0f)
+	};
+
+	for (int i = 0; i < 3; i++)
+	{
+		uint32_t v = coords[i];
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		coords[i] = v;
+	}
+
+	return coords[0] * 4 + coords[1] * 2 + coords[2];
+}
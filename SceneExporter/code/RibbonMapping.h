@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Math\Vec3.h>
+#include <IO\BinaryWriter.h>
+
+#include <windows.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Decides which source triangle of a ribbon flies to which destination
+// triangle. Triangles are given as world space vertices, three per triangle,
+// in the order of the exported .geo: the mesh's parts one after another,
+// each in the order of its indices. The triangles count of every part is
+// saved along, so an index can be turned into a part and a triangle in it.
+class RibbonMapping
+{
+public:
+	class Pair
+	{
+	public:
+		int source;
+		int destination;
+	};
+
+	// per triangle values of the ribbon effect, saved as an instance buffer
+	// with one instance per triangle in the same order pairs index them
+	class Instance
+	{
+	public:
+		sm::Vec3 centroid;
+		float area;
+		sm::Vec3 normal;
+
+		// seconds, triangles leave the source and reach the destination in that order
+		float delay;
+	};
+
+	class Job
+	{
+	public:
+		std::string ribbonName;
+		std::string fileName;
+
+		const std::vector<sm::Vec3> *sourceVertices;
+		const std::vector<sm::Vec3> *destinationVertices;
+		const std::vector<int> *sourcePartTriangles;
+		const std::vector<int> *destinationPartTriangles;
+
+		// positions of the path keys and Path::Delay, no keys give no delays
+		std::vector<sm::Vec3> pathPoints;
+		float pathDelay;
+
+		// filled by Run
+		bool result;
+		int pairsCount;
+	};
+
+	// Every triangle of the smaller mesh gets its nearest triangle of the
+	// bigger one first, then the rest of the bigger mesh goes to the nearest
+	// triangle with room left. Triangles of the smaller mesh get at most
+	// ceil(bigger / smaller) pairs, so no triangle is left out and none gets
+	// crowded. Pairs are sorted by source, then destination triangle.
+	static bool Build(
+		const std::vector<sm::Vec3> &sourceVertices,
+		const std::vector<sm::Vec3> &destinationVertices,
+		std::vector<Pair> &pairs);
+
+	// Delays grow from 0 to pathDelay along the path direction at its start
+	// for the source, the front triangles go first, and along the direction
+	// at its end for the destination, the nearest triangles land first.
+	static void BuildInstances(
+		const std::vector<sm::Vec3> &vertices,
+		const std::vector<sm::Vec3> &pathPoints,
+		float pathDelay,
+		bool destination,
+		std::vector<Instance> &instances);
+
+	static bool Save(
+		const std::string &fileName,
+		const std::vector<int> &sourcePartTriangles,
+		const std::vector<int> &destinationPartTriangles,
+		const std::vector<Pair> &pairs,
+		const std::vector<Instance> &sourceInstances,
+		const std::vector<Instance> &destinationInstances);
+
+	// builds and saves the jobs on all processors, doesn't log
+	static void Run(std::vector<Job> &jobs);
+
+private:
+	// bytes of one saved instance
+	static const int InstanceSize;
+
+	static void SaveInstances(BinaryWriter &bw, const std::vector<Instance> &instances);
+	static void SavePartTriangles(BinaryWriter &bw, const std::vector<int> &partTriangles);
+	static int16_t ToSnorm16(float value);
+
+	static void GetCentroids(const std::vector<sm::Vec3> &vertices, std::vector<sm::Vec3> &centroids);
+	static void GetMortonOrder(const std::vector<sm::Vec3> &points, std::vector<int> &order);
+	static uint32_t MortonCode(float x, float y, float z);
+
+	static DWORD WINAPI JobsThread(LPVOID param);
+};
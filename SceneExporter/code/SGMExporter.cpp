@@ -12,9 +12,14 @@
 #include "SceneElements/StaticDestination.h"
 
 #include "XmlWriter.h"
+#include "RibbonMapping.h"
+#include "../../GeometryExporter/code/GeoFile.h"
 #include <Utils/StringUtils.h>
 #include <Utils/Log.h>
 
+#include <fstream>
+#include <sstream>
+
 #include <modstack.h>
 #include <icustattribcontainer.h>
 #include <custattrib.h>
@@ -88,6 +93,8 @@ bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_i
 	for (int i = 0; i < sceneNodes.size(); i++)
 		ProcessSceneElement(sceneNodes[i]);
 
+	BuildRibbonMappings();
+
 	std::ofstream file(fileName);
 	if (file.fail())
 	{
@@ -106,6 +113,9 @@ bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_i
 	{
 		xmlWriter.OpenElement("Ribbon");
 
+		if (it->second->MappingFileName.size() > 0)
+			xmlWriter.WriteAttribute<const char*>("mapping_file", it->second->MappingFileName.c_str());
+
 		if (it->second->Source != NULL)
 		{
 			xmlWriter.OpenElement("Source");
@@ -345,6 +355,8 @@ Source* SGMExporter::ProcessSource(IGameNode* node, const std::string& id)
 	GetPropertyBool(node, "stay", stay);
 	source->Stay = stay;
 
+	source->MeshId = node->GetNodeID();
+
 	return source;
 }
 
@@ -439,9 +451,182 @@ Destination* SGMExporter::ProcessDestination(IGameNode* node, const std::string&
 
 	destination->Stay = stay;
 
+	destination->MeshId = node->GetNodeID();
+
 	return destination;
 }
 
+// The .geo of the scene and its sector files, exported to the same folder
+// before the scene. Triangles of ribbons are taken from them, the geometry
+// exporter splits, welds and reorders faces, so 3ds Max's face order isn't
+// the order the runtime draws and indexes them in.
+bool SGMExporter::LoadGeometry(std::vector<GeoFile*>& files)
+{
+	std::string baseName = fileName.substr(0, fileName.rfind(".scene"));
+	std::string directory = baseName.substr(0, baseName.find_last_of("\\/") + 1);
+
+	std::vector<std::string> geoFileNames;
+	geoFileNames.push_back(baseName + ".geo");
+
+	// static meshes are in sector files when the geometry was partitioned
+	std::ifstream indexStream((baseName + ".sectors.xml").c_str());
+	if (indexStream.is_open())
+	{
+		std::stringstream index;
+		index << indexStream.rdbuf();
+
+		std::string text = index.str();
+		const std::string attribute = " file=\"";
+
+		for (size_t start = text.find(attribute); start != std::string::npos; start = text.find(attribute, start))
+		{
+			start += attribute.size();
+
+			size_t end = text.find('"', start);
+			if (end == std::string::npos)
+				break;
+
+			geoFileNames.push_back(directory + text.substr(start, end - start));
+		}
+	}
+
+	for (unsigned i = 0; i < geoFileNames.size(); i++)
+	{
+		GeoFile *file = new GeoFile();
+
+		if (!file->Load(geoFileNames[i]))
+		{
+			Log::LogT("warning: couldn't load geometry '%s'", geoFileNames[i].c_str());
+			delete file;
+			continue;
+		}
+
+		files.push_back(file);
+	}
+
+	return files.size() > 0;
+}
+
+bool SGMExporter::ExtractTriangles(const std::vector<GeoFile*>& files, int meshId, std::vector<sm::Vec3>& vertices, std::vector<int>& partTriangles)
+{
+	for (unsigned i = 0; i < files.size(); i++)
+	{
+		for (unsigned j = 0; j < files[i]->meshes.size(); j++)
+		{
+			const GeoFile::Mesh *mesh = files[i]->meshes[j];
+			if (mesh->id != meshId)
+				continue;
+
+			for (unsigned k = 0; k < mesh->parts.size(); k++)
+			{
+				const GeoFile::Part *part = mesh->parts[k];
+				int stride = part->GetFloatsPerVertex();
+
+				for (unsigned l = 0; l < part->indices.size(); l++)
+				{
+					const float *position = &part->vertices[part->indices[l] * stride];
+					vertices.push_back(sm::Vec3(position[0], position[1], position[2]));
+				}
+
+				partTriangles.push_back((int)part->indices.size() / 3);
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void SGMExporter::BuildRibbonMappings()
+{
+	// triangles are read from the exported geometry here, the threads only do the math
+	std::string baseName = fileName.substr(0, fileName.rfind(".scene"));
+
+	std::vector<GeoFile*> geoFiles;
+	bool geometryLoaded = false;
+
+	std::vector<RibbonMapping::Job> jobs;
+
+	for (RibbonsMap::iterator it = m_ribbons.begin(); it != m_ribbons.end(); it++)
+	{
+		Ribbon* ribbon = it->second;
+
+		if (ribbon->Source == NULL || ribbon->Destination == NULL)
+			continue;
+
+		if (!geometryLoaded)
+		{
+			geometryLoaded = true;
+
+			if (!LoadGeometry(geoFiles))
+				Log::LogT("error: no geometry next to '%s', export it to the same folder before the scene to get ribbon triangle mappings", fileName.c_str());
+		}
+
+		if (!ExtractTriangles(geoFiles, ribbon->Source->MeshId, ribbon->Source->Vertices, ribbon->Source->PartTriangles) ||
+			!ExtractTriangles(geoFiles, ribbon->Destination->MeshId, ribbon->Destination->Vertices, ribbon->Destination->PartTriangles))
+		{
+			Log::LogT("error: source or destination of ribbon %s isn't in the exported geometry, no triangle mapping", it->first.c_str());
+			continue;
+		}
+
+		if (ribbon->Source->Vertices.size() == 0 || ribbon->Destination->Vertices.size() == 0)
+		{
+			Log::LogT("warning: ribbon %s has an empty source or destination, no triangle mapping", it->first.c_str());
+			continue;
+		}
+
+		RibbonMapping::Job job;
+		job.ribbonName = it->first;
+		job.fileName = baseName + "_" + it->first + ".ribmap";
+		job.sourceVertices = &ribbon->Source->Vertices;
+		job.destinationVertices = &ribbon->Destination->Vertices;
+		job.sourcePartTriangles = &ribbon->Source->PartTriangles;
+		job.destinationPartTriangles = &ribbon->Destination->PartTriangles;
+		job.pathDelay = 0.0f;
+		job.result = false;
+
+		if (ribbon->Path != NULL)
+		{
+			for (unsigned j = 0; j < ribbon->Path->Keys.size(); j++)
+				job.pathPoints.push_back(ribbon->Path->Keys[j]->Position);
+
+			job.pathDelay = ribbon->Path->Delay;
+		}
+		else
+			Log::LogT("warning: ribbon %s has no path, its triangles get no delays", it->first.c_str());
+		job.pairsCount = 0;
+
+		jobs.push_back(job);
+	}
+
+	for (unsigned i = 0; i < geoFiles.size(); i++)
+		delete geoFiles[i];
+
+	RibbonMapping::Run(jobs);
+
+	for (unsigned i = 0; i < jobs.size(); i++)
+	{
+		const RibbonMapping::Job &job = jobs[i];
+
+		if (!job.result)
+		{
+			Log::LogT("error: couldn't save triangle mapping of ribbon %s to '%s'", job.ribbonName.c_str(), job.fileName.c_str());
+			continue;
+		}
+
+		Log::LogT("ribbon %s: %d source triangles, %d destination triangles, %d pairs",
+			job.ribbonName.c_str(),
+			(int)job.sourceVertices->size() / 3,
+			(int)job.destinationVertices->size() / 3,
+			job.pairsCount);
+
+		// the scene file refers to sidecars by name, they sit next to it
+		size_t slash = job.fileName.find_last_of("\\/");
+		m_ribbons[job.ribbonName]->MappingFileName = slash == std::string::npos ? job.fileName : job.fileName.substr(slash + 1);
+	}
+}
+
 StaticSource* SGMExporter::ProcessStaticSource(IGameNode* node, const std::string& id)
 {
 	StaticSource* source = new StaticSource();
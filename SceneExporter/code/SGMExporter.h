@@ -5,6 +5,7 @@
 #include <map>
 
 #include <IO\BinaryWriter.h>
+#include <Math\Vec3.h>
 
 #include <IGame\igame.h>
 #include <IGame\IConversionManager.h>
@@ -24,6 +25,7 @@ class TransformKey;
 class Material;
 template <typename T> class Key;
 class XmlWriter;
+class GeoFile;
 
 class SGMExporter : public IExportInterface
 {
@@ -63,6 +65,9 @@ private:
 	StaticSource* ProcessStaticSource(IGameNode* node, const std::string& id);
 	StaticDestination* ProcessStaticDestination(IGameNode* node, const std::string& id);
 	Path* ProcessPath(IGameNode* node);
+	bool LoadGeometry(std::vector<GeoFile*>& files);
+	bool ExtractTriangles(const std::vector<GeoFile*>& files, int meshId, std::vector<sm::Vec3>& vertices, std::vector<int>& partTriangles);
+	void BuildRibbonMappings();
 	void ProcessIntProperty(IGameNode* node, const std::string& name, std::vector<Key<int>*>& keys);
 	void ProcessFloatProperty(IGameNode* node, const std::string& name, std::vector<Key<float>*>& keys);
 
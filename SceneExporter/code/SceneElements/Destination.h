@@ -1,6 +1,8 @@
 #pragma once
 
+#include <Math/Vec3.h>
 #include <string>
+#include <vector>
 
 class Destination
 {
@@ -8,4 +10,12 @@ public:
 	std::string MeshName;
 	std::string MaterialName;
 	bool Stay;
+
+	// node id, the mesh in the exported .geo has the same one
+	int MeshId;
+
+	// world space, three per triangle, triangles of the mesh's parts in the
+	// .geo one part after another
+	std::vector<sm::Vec3> Vertices;
+	std::vector<int> PartTriangles;
 };
@@ -17,5 +17,8 @@ public:
 	Path* Path;
 	StaticSource* StaticSource;
 	StaticDestination* StaticDestination;
+
+	// sidecar with triangle pairs and per triangle instance buffers, empty when there's none
+	std::string MappingFileName;
 };
 
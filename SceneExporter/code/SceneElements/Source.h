@@ -1,6 +1,8 @@
 #pragma once
 
+#include <Math/Vec3.h>
 #include <string>
+#include <vector>
 
 class Source
 {
@@ -9,4 +11,12 @@ public:
 	std::string MaterialName;
 	bool Destroy;
 	bool Stay;
+
+	// node id, the mesh in the exported .geo has the same one
+	int MeshId;
+
+	// world space, three per triangle, triangles of the mesh's parts in the
+	// .geo one part after another
+	std::vector<sm::Vec3> Vertices;
+	std::vector<int> PartTriangles;
 };
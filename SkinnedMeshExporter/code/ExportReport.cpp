@@ -0,0 +1,181 @@
+#include "ExportReport.h"
+#include "JsonWriter.h"
+#include <Utils/Log.h>
+
+#include <fstream>
+#include <assert.h>
+
+const char *ExportReport::StageNames[StagesCount] =
+{
+	"convert_mesh",
+	"properties",
+	"influences",
+	"serialization"
+};
+
+namespace
+{
+	void WriteVec3(JsonWriter &jw, const char *key, const sm::Vec3 &v)
+	{
+		jw.OpenArray(key);
+		jw.WriteValue(v.x);
+		jw.WriteValue(v.y);
+		jw.WriteValue(v.z);
+		jw.CloseArray();
+	}
+
+	void WritePart(JsonWriter &jw, const MeshPartStats &part)
+	{
+		jw.OpenObject();
+
+		jw.WriteMember("material", part.materialName);
+		jw.WriteMember("corners", part.cornersCount);
+		jw.WriteMember("unique_vertices", part.uniqueVerticesCount);
+		jw.WriteMember("stored_vertices", part.storedVerticesCount);
+		jw.WriteMember("redundancy", part.GetRedundancy());
+
+		jw.WriteMember("vertex_size", part.vertexSize);
+		jw.OpenObject("attribute_bytes");
+		for (unsigned i = 0; i < part.attribBytes.size(); i++)
+			jw.WriteMember(part.attribBytes[i].name, part.attribBytes[i].bytes);
+		jw.CloseObject();
+
+		jw.WriteMember("index_size", part.indexSize);
+		jw.WriteMember("index_bytes", part.GetIndicesBytes());
+
+		jw.WriteKey("acmr");
+		if (part.acmr < 0.0f)
+			jw.WriteNull();
+		else
+			jw.WriteValue(part.acmr);
+
+		jw.OpenObject("bounds");
+		WriteVec3(jw, "min", part.boundsMin);
+		WriteVec3(jw, "max", part.boundsMax);
+		jw.CloseObject();
+
+		jw.CloseObject();
+	}
+}
+
+void ExportReport::Clear()
+{
+	meshes.clear();
+}
+
+void ExportReport::BeginMesh(int id, const std::string &name)
+{
+	MeshEntry mesh;
+	mesh.id = id;
+	mesh.name = name;
+	mesh.exported = true;
+
+	for (int i = 0; i < StagesCount; i++)
+		mesh.times[i] = 0.0;
+
+	meshes.push_back(mesh);
+}
+
+void ExportReport::AddTime(Stage stage, double seconds)
+{
+	assert(meshes.size() > 0);
+
+	meshes.back().times[stage] += seconds;
+}
+
+void ExportReport::AddPart(const MeshPartStats &partStats)
+{
+	assert(meshes.size() > 0);
+
+	meshes.back().parts.push_back(partStats);
+}
+
+void ExportReport::SkipMesh()
+{
+	assert(meshes.size() > 0);
+
+	meshes.back().exported = false;
+}
+
+bool ExportReport::Save(const std::string &fileName, const std::string &exportedFileName) const
+{
+	std::ofstream fileStream(fileName.c_str());
+	if (!fileStream.is_open())
+	{
+		Log::LogT("error: couldn't open report file '%s'", fileName.c_str());
+		return false;
+	}
+
+	unsigned totalCorners = 0;
+	unsigned totalVertices = 0;
+	unsigned totalVerticesBytes = 0;
+	unsigned totalIndicesBytes = 0;
+	double totalTimes[StagesCount] = { 0.0 };
+
+	for (unsigned i = 0; i < meshes.size(); i++)
+	{
+		for (unsigned j = 0; j < meshes[i].parts.size(); j++)
+		{
+			const MeshPartStats &part = meshes[i].parts[j];
+
+			totalCorners += part.cornersCount;
+			totalVertices += part.storedVerticesCount;
+			totalVerticesBytes += part.GetVerticesBytes();
+			totalIndicesBytes += part.GetIndicesBytes();
+		}
+
+		for (int j = 0; j < StagesCount; j++)
+			totalTimes[j] += meshes[i].times[j];
+	}
+
+	JsonWriter jw(&fileStream, 0);
+
+	jw.OpenObject();
+	jw.WriteMember("file", exportedFileName);
+	jw.WriteMember("acmr_cache_size", MeshPartStats::CacheSize);
+
+	jw.OpenObject("totals");
+	jw.WriteMember("meshes", (unsigned)meshes.size());
+	jw.WriteMember("corners", totalCorners);
+	jw.WriteMember("stored_vertices", totalVertices);
+	jw.WriteMember("vertex_bytes", totalVerticesBytes);
+	jw.WriteMember("index_bytes", totalIndicesBytes);
+	jw.OpenObject("time");
+	for (int i = 0; i < StagesCount; i++)
+		jw.WriteMember(StageNames[i], totalTimes[i]);
+	jw.CloseObject();
+	jw.CloseObject();
+
+	jw.OpenArray("meshes");
+
+	for (unsigned i = 0; i < meshes.size(); i++)
+	{
+		const MeshEntry &mesh = meshes[i];
+
+		jw.OpenObject();
+		jw.WriteMember("id", mesh.id);
+		jw.WriteMember("name", mesh.name);
+		jw.WriteMember("exported", mesh.exported);
+
+		jw.OpenObject("time");
+		for (int j = 0; j < StagesCount; j++)
+			jw.WriteMember(StageNames[j], mesh.times[j]);
+		jw.CloseObject();
+
+		jw.OpenArray("parts");
+		for (unsigned j = 0; j < mesh.parts.size(); j++)
+			WritePart(jw, mesh.parts[j]);
+		jw.CloseArray();
+
+		jw.CloseObject();
+	}
+
+	jw.CloseArray();
+	jw.CloseObject();
+
+	fileStream.close();
+
+	Log::LogT("report saved to '%s'", fileName.c_str());
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#include "ExportSettings.h"
+#include "scene3d/Scene3DVertex.h"
+
+#include <windows.h>
+#include <Utils/Log.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+const char *ExportSettings::Section = "SkinnedMeshExporter";
+
+ExportSettings::ExportSettings() :
+	MaxInfluences(4),
+	InfluenceThreshold(0.01f),
+	WeightBits(8),
+	MaxPaletteBones(256)
+{
+}
+
+void ExportSettings::Load(const std::string &fileName)
+{
+	char value[256];
+	char defaultValue[64];
+
+	MaxInfluences = GetPrivateProfileIntA(Section, "MaxInfluences", MaxInfluences, fileName.c_str());
+
+	if (MaxInfluences < 1 || MaxInfluences > Scene3DVertex::MaxInfluences)
+	{
+		Log::LogT("warning: MaxInfluences must be between 1 and %d, got %d, using 4", Scene3DVertex::MaxInfluences, MaxInfluences);
+		MaxInfluences = 4;
+	}
+
+	sprintf(defaultValue, "%f", InfluenceThreshold);
+	GetPrivateProfileStringA(Section, "InfluenceThreshold", defaultValue, value, sizeof(value), fileName.c_str());
+	InfluenceThreshold = (float)atof(value);
+
+	if (InfluenceThreshold < 0.0f || InfluenceThreshold >= 1.0f)
+	{
+		Log::LogT("warning: InfluenceThreshold must be between 0 and 1, using 0.01");
+		InfluenceThreshold = 0.01f;
+	}
+
+	WeightBits = GetPrivateProfileIntA(Section, "WeightBits", WeightBits, fileName.c_str());
+
+	if (WeightBits != 8 && WeightBits != 16)
+	{
+		Log::LogT("warning: WeightBits must be 8 or 16, got %d, using 8", WeightBits);
+		WeightBits = 8;
+	}
+
+	MaxPaletteBones = GetPrivateProfileIntA(Section, "MaxPaletteBones", MaxPaletteBones, fileName.c_str());
+
+	// a single triangle has to fit
+	if (MaxPaletteBones < 3 * MaxInfluences || MaxPaletteBones > 256)
+	{
+		Log::LogT("warning: MaxPaletteBones must be between %d and 256, got %d, using 256", 3 * MaxInfluences, MaxPaletteBones);
+		MaxPaletteBones = 256;
+	}
+
+	Log::LogT("settings: max influences %d, influence threshold %f, weight bits %d, max palette bones %d",
+		MaxInfluences, InfluenceThreshold, WeightBits, MaxPaletteBones);
+}
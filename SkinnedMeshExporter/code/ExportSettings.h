@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+// Exporter options read from SkinnedMeshExporter.ini in the 3ds Max plugin
+// configuration folder. Every value has a default, so the file is optional.
+class ExportSettings
+{
+public:
+	// most bones a vertex is skinned to, 1 to 8, the heaviest ones are kept
+	int MaxInfluences;
+
+	// normalized weights below this are dropped, the heaviest one always stays
+	float InfluenceThreshold;
+
+	// bits of a saved weight, 8 or 16
+	int WeightBits;
+
+	// most bones a part is drawn with, meshes using more are split, up to 256
+	int MaxPaletteBones;
+
+	ExportSettings();
+
+	void Load(const std::string &fileName);
+
+private:
+	static const char *Section;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <string>
+#include <stack>
+#include <sstream>
+#include <stdio.h>
+#include <assert.h>
+
+class JsonWriter
+{
+private:
+	std::ostream *os;
+
+	int identLevel;
+
+	// one entry per open object or array, true when it has no members yet
+	std::stack<bool> openScopes;
+	bool isKeyWritten;
+
+	std::string Ident()
+	{
+		std::string ident = "";
+
+		for (int i = 0; i < identLevel; i++)
+			ident += "\t";
+
+		return ident;
+	}
+
+	void BeginValue()
+	{
+		if (isKeyWritten)
+		{
+			isKeyWritten = false;
+			return;
+		}
+
+		if (openScopes.size() != 0)
+		{
+			if (!openScopes.top())
+				*os << ",";
+
+			*os << "\n" << Ident();
+			openScopes.top() = false;
+		}
+	}
+
+	void Open(char bracket)
+	{
+		BeginValue();
+
+		*os << bracket;
+
+		openScopes.push(true);
+		identLevel++;
+	}
+
+	void Close(char bracket)
+	{
+		assert(openScopes.size() > 0 && !isKeyWritten);
+
+		identLevel--;
+
+		if (!openScopes.top())
+			*os << "\n" << Ident();
+
+		*os << bracket;
+
+		openScopes.pop();
+
+		if (openScopes.size() == 0)
+			*os << "\n";
+	}
+
+	void WriteString(const std::string &value)
+	{
+		*os << "\"";
+
+		for (unsigned i = 0; i < value.size(); i++)
+		{
+			unsigned char c = (unsigned char)value[i];
+
+			switch (c)
+			{
+			case '"': *os << "\\\""; break;
+			case '\\': *os << "\\\\"; break;
+			case '\n': *os << "\\n"; break;
+			case '\r': *os << "\\r"; break;
+			case '\t': *os << "\\t"; break;
+			default:
+				if (c < 0x20)
+				{
+					char escaped[8];
+					sprintf(escaped, "\\u%04x", c);
+					*os << escaped;
+				}
+				else
+					*os << value[i];
+			}
+		}
+
+		*os << "\"";
+	}
+
+public:
+	JsonWriter(std::ostream *os, int identLevel) :
+		isKeyWritten(false)
+	{
+		this ->os = os;
+		this ->identLevel = identLevel;
+	}
+
+	void OpenObject()
+	{
+		Open('{');
+	}
+
+	void OpenObject(const char *key)
+	{
+		WriteKey(key);
+		Open('{');
+	}
+
+	void CloseObject()
+	{
+		Close('}');
+	}
+
+	void OpenArray()
+	{
+		Open('[');
+	}
+
+	void OpenArray(const char *key)
+	{
+		WriteKey(key);
+		Open('[');
+	}
+
+	void CloseArray()
+	{
+		Close(']');
+	}
+
+	void WriteKey(const char *key)
+	{
+		assert(!isKeyWritten);
+
+		BeginValue();
+		WriteString(key);
+		*os << ": ";
+
+		isKeyWritten = true;
+	}
+
+	template <typename ValType>
+	void WriteValue(ValType value)
+	{
+		BeginValue();
+		*os << value;
+	}
+
+	// JSON has no nan and infinity, they come out as null
+	void WriteValue(double value)
+	{
+		BeginValue();
+
+		// x - x is 0 for every finite x and nan for nan and infinity
+		if (value - value == 0.0)
+			*os << value;
+		else
+			*os << "null";
+	}
+
+	void WriteValue(float value)
+	{
+		WriteValue((double)value);
+	}
+
+	void WriteValue(bool value)
+	{
+		BeginValue();
+		*os << (value ? "true" : "false");
+	}
+
+	void WriteValue(const char *value)
+	{
+		BeginValue();
+		WriteString(value);
+	}
+
+	void WriteValue(const std::string &value)
+	{
+		BeginValue();
+		WriteString(value);
+	}
+
+	void WriteNull()
+	{
+		BeginValue();
+		*os << "null";
+	}
+
+	template <typename ValType>
+	void WriteMember(const char *key, ValType value)
+	{
+		WriteKey(key);
+		WriteValue(value);
+	}
+};
@@ -1,9 +1,17 @@
 #include "sgmexporter.h"
 #include "XmlWriter.h"
+#include "Stopwatch.h"
+#include "scene3d/MeshPartStats.h"
+#include "scene3d/SkinInfluences.h"
+#include "scene3d/BonePaletteSplitter.h"
+#include "scene3d/MeshPartIndexer.h"
+#include "scene3d/VertexPacking.h"
 
 #include <Utils/StringUtils.h>
 #include <Utils/Log.h>
 
+#include <unordered_map>
+
 #include <modstack.h>
 #include <icustattribcontainer.h>
 #include <custattrib.h>
@@ -124,6 +132,22 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 					prop->SetValue(sm::Vec3(val.x, val.y, val.z));
 				}
 				break;
+
+			case IGAME_POINT4_PROP:
+				{
+					Point4 val;
+					gProp->GetPropertyValue(val);
+					prop->SetValue(sm::Vec3(val.x, val.y, val.z));
+				}
+				break;
+
+			case IGAME_STRING_PROP:
+				{
+					const MCHAR *val = NULL;
+					gProp->GetPropertyValue(val);
+					prop->SetValue(val != NULL ? val : L"");
+				}
+				break;
 			}
 		}
 		else
@@ -206,7 +230,7 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 							{
 								for (int j = 0; j < keys.Count(); j++)
 								{
-									prop->SetValue((int)keys[j].linearKey.fval, TicksToSec(keys[j].t));
+									prop->SetValue((int)keys[j].tcbKey.fval, TicksToSec(keys[j].t));
 								}
 							}
 						}
@@ -216,6 +240,45 @@ void SGMExporter::CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh)
 					}
 				}
 
+				break;
+
+			case IGAME_POINT3_PROP:
+				{
+					Control *maxControl = ctrl->GetMaxControl(IGAME_POINT3);
+					if (maxControl != NULL && maxControl->IsAnimated())
+					{
+						if (maxControl->ClassID() == Class_ID(LININTERP_POSITION_CLASS_ID, 0))
+						{
+							prop = new Property(propName, Property::PropertyType_Vector3, Property::AnimationType_Linear);
+							IGameKeyTab keys;
+							if (ctrl->GetLinearKeys(keys, IGAME_POINT3))
+							{
+								for (int j = 0; j < keys.Count(); j++)
+								{
+									Point3 val = keys[j].linearKey.pval;
+									prop->SetValue(sm::Vec3(val.x, val.y, val.z), TicksToSec(keys[j].t));
+								}
+							}
+						}
+						if (maxControl->ClassID() == Class_ID(TCBINTERP_POINT3_CLASS_ID, 0))
+						{
+							prop = new Property(propName, Property::PropertyType_Vector3, Property::AnimationType_TCB);
+							IGameKeyTab keys;
+							if (ctrl->GetTCBKeys(keys, IGAME_POINT3))
+							{
+								for (int j = 0; j < keys.Count(); j++)
+								{
+									Point3 val = keys[j].tcbKey.pval;
+									prop->SetValue(sm::Vec3(val.x, val.y, val.z), TicksToSec(keys[j].t));
+								}
+							}
+						}
+					}
+
+					if (prop == NULL)
+						Log::LogT("warning: property %s is animated by a controller that isn't linear or tcb, skipping it", propName.c_str());
+				}
+
 				break;
 			}
 		}
@@ -252,12 +315,17 @@ Scene3DMesh* SGMExporter::ConvertMesh(IGameNode* meshNode)
 	else 
 		Log::LogT("Mesh '%s' is skinned", meshNodeName.c_str());
 
+	if (!gMesh->InitializeBinormalData())
+		Log::LogT("warning: couldnt initialize tangents of '%s', exporting them as 0", meshNodeName.c_str());
+
 	Scene3DMesh *mesh = new Scene3DMesh();
 
 	mesh->id = meshNode->GetNodeID();
 	mesh->name = StringUtils::ToNarrow(meshNode->GetName());
 
+	Stopwatch propertiesTime;
 	CollectProperties(mesh, gMesh);
+	report.AddTime(ExportReport::Stage_Properties, propertiesTime.GetSeconds());
 
 	IGameMaterial *mat = meshNode ->GetNodeMaterial();
 
@@ -268,59 +336,168 @@ Scene3DMesh* SGMExporter::ConvertMesh(IGameNode* meshNode)
 	for (int i = 0; i < skin->GetTotalSkinBoneCount(); i++)
 		mesh->bonesIds.push_back(skin->GetIGameBone(i)->GetNodeID());
 
+	mesh->weightBits = settings.WeightBits;
+
+	// uv channels 1 and 2, the second one only along with the first
+	if (gMesh->GetNumberOfMapVerts(1) > 0)
+	{
+		mesh->coordsCount++;
+
+		if (gMesh->GetNumberOfMapVerts(2) > 0)
+			mesh->coordsCount++;
+	}
+
+	trimmedVerticesCount = 0;
+	unweightedVerticesCount = 0;
+	droppedInfluencesCount = 0;
+
+	Stopwatch influencesTime;
+	std::vector<Scene3DVertex> controlVertices;
+	CollectInfluences(skin, gMesh, mesh, controlVertices);
+	report.AddTime(ExportReport::Stage_Influences, influencesTime.GetSeconds());
+
+	bool mirrored = IsMirrored(gMesh);
+
 	for (int i = 0; i < gMesh ->GetNumberOfFaces(); i++)
-		ExtractVertices(skin, gMesh ->GetFace(i), gMesh, mesh->vertices);
+		ExtractVertices(gMesh ->GetFace(i), gMesh, mirrored, controlVertices, mesh);
 
 	Log::LogT("Min bones = %d, max bones = %d", dbgMinBonesCount, dbgMaxBonesCount);
+	Log::LogT("influences per vertex: %d, weights of %d bits", mesh->influencesCount, mesh->weightBits);
+	Log::LogT("uv channels: %d", mesh->coordsCount);
+
+	if (trimmedVerticesCount > 0)
+		Log::LogT("warning: %d vertices had more than %d influences, kept the heaviest", trimmedVerticesCount, settings.MaxInfluences);
+
+	if (unweightedVerticesCount > 0)
+		Log::LogT("warning: %d vertices have no weights, bound to bone 0", unweightedVerticesCount);
+
+	if (droppedInfluencesCount > 0)
+		Log::LogT("warning: %d influences have a bone that isn't in the skin, dropped", droppedInfluencesCount);
+
+	// a mesh of unweighted vertices still stores bone 0
+	if (mesh->influencesCount == 0)
+		mesh->influencesCount = 1;
+
+	BonePaletteSplitter::Split(mesh, settings.MaxPaletteBones);
+
+	for (unsigned i = 0; i < mesh->parts.size(); i++)
+		MeshPartIndexer::Weld(mesh->parts[i]);
 
 	meshNode ->ReleaseIGameObject();
 
 	return mesh;
 }
 
-void SGMExporter::ExtractVertices(IGameSkin* skin, FaceEx *gFace, IGameMesh *gMesh, std::vector<Scene3DVertex*> &vertices)
+// Skin of every control vertex resolved once, faces share control vertices
+// and IGameSkin calls are what a big character's export spends its time in.
+void SGMExporter::CollectInfluences(IGameSkin *skin, IGameMesh *gMesh, Scene3DMesh *mesh, std::vector<Scene3DVertex> &controlVertices)
 {
 	assert(skin != NULL);
 
-	GMatrix objectTM = gMesh ->GetIGameObjectTM();
-	/*log ->AddLog(sb() + "[" + objectTM.GetRow(0).x + "] [" + objectTM.GetRow(0).y + "] [" + objectTM.GetRow(0).z + "] [" + objectTM.GetRow(0).w + "]");
-	log ->AddLog(sb() + "[" + objectTM.GetRow(1).x + "] [" + objectTM.GetRow(1).y + "] [" + objectTM.GetRow(1).z + "] [" + objectTM.GetRow(1).w + "]");
-	log ->AddLog(sb() + "[" + objectTM.GetRow(2).x + "] [" + objectTM.GetRow(2).y + "] [" + objectTM.GetRow(2).z + "] [" + objectTM.GetRow(2).w + "]");
-	log ->AddLog(sb() + "[" + objectTM.GetRow(3).x + "] [" + objectTM.GetRow(3).y + "] [" + objectTM.GetRow(3).z + "] [" + objectTM.GetRow(3).w + "]");*/
+	// GetBoneIndex searches the skin's bones for the node, a map finds it right away
+	std::unordered_map<int, int> boneIndices;
+	for (unsigned i = 0; i < mesh->bonesIds.size(); i++)
+		boneIndices[mesh->bonesIds[i]] = (int)i;
 
-	int faceIndex = gFace ->meshFaceIndex;
+	controlVertices.resize(gMesh->GetNumberOfVerts());
 
-	for (int i = 0; i < 3; i++)
+	std::vector<SkinInfluences::Influence> influences;
+
+	for (int i = 0; i < gMesh->GetNumberOfVerts(); i++)
 	{
-		Scene3DVertex *vert = new Scene3DVertex();
+		Scene3DVertex &vert = controlVertices[i];
 
-		vert ->position.Set(
-			gMesh ->GetVertex(gFace ->vert[i]).x,
-			gMesh ->GetVertex(gFace ->vert[i]).y,
-			gMesh ->GetVertex(gFace ->vert[i]).z);
+		Point3 position = gMesh->GetVertex(i);
+		vert.position.Set(position.x, position.y, position.z);
 
-		int bonesCount = skin->GetNumberOfBones(gFace->vert[i]);
+		int bonesCount = skin->GetNumberOfBones(i);
 
-		int boneIndex = 0;
-		for (boneIndex = 0; boneIndex < bonesCount; boneIndex++)
+		influences.clear();
+		for (int boneIndex = 0; boneIndex < bonesCount; boneIndex++)
 		{
-			IGameNode* boneNode = skin->GetIGameBone(gFace->vert[i], boneIndex);
-			vert->boneIndex[boneIndex] = skin->GetBoneIndex(boneNode);
-			vert->weight[boneIndex] = skin->GetWeight(gFace->vert[i], boneIndex);
-		}
+			IGameNode* boneNode = skin->GetIGameBone(i, boneIndex);
 
-		for (; boneIndex < 4; boneIndex++)
-		{
-			vert->boneIndex[boneIndex] = 0;
-			vert->weight[boneIndex] = 0.0f;
+			std::unordered_map<int, int>::const_iterator it = boneIndices.find(boneNode->GetNodeID());
+
+			SkinInfluences::Influence influence;
+			influence.bone = it != boneIndices.end() ? it->second : skin->GetBoneIndex(boneNode);
+			influence.weight = skin->GetWeight(i, boneIndex);
+
+			// a bone the skin doesn't know has no place in the palettes
+			if (influence.bone < 0 || influence.bone >= (int)mesh->bonesIds.size())
+			{
+				droppedInfluencesCount++;
+				continue;
+			}
+
+			influences.push_back(influence);
 		}
 
+		unsigned influencesCount = SkinInfluences::Pack(influences, settings.MaxInfluences, settings.InfluenceThreshold, settings.WeightBits, &vert);
+
+		if (bonesCount > settings.MaxInfluences)
+			trimmedVerticesCount++;
+		if (influencesCount == 0)
+			unweightedVerticesCount++;
+
+		if ((int)influencesCount > mesh->influencesCount)
+			mesh->influencesCount = influencesCount;
+
 		if (bonesCount < dbgMinBonesCount)
 			dbgMinBonesCount = bonesCount;
 		if (bonesCount > dbgMaxBonesCount)
 			dbgMaxBonesCount = bonesCount;
+	}
+}
 
-		vertices.push_back(vert);
+// a mirrored object has its normals the other way
+bool SGMExporter::IsMirrored(IGameMesh *gMesh)
+{
+	GMatrix objectTM = gMesh->GetIGameObjectTM();
+
+	Point3 a(objectTM.GetRow(0).x, objectTM.GetRow(0).y, objectTM.GetRow(0).z);
+	Point3 b(objectTM.GetRow(1).x, objectTM.GetRow(1).y, objectTM.GetRow(1).z);
+	Point3 c(objectTM.GetRow(2).x, objectTM.GetRow(2).y, objectTM.GetRow(2).z);
+
+	return DotProd(CrossProd(a, b), c) < 0;
+}
+
+// Position and skin come from the control vertex, normal, tangent and uvs
+// belong to the face's corner.
+void SGMExporter::ExtractVertices(FaceEx *gFace, IGameMesh *gMesh, bool mirrored, const std::vector<Scene3DVertex> &controlVertices, Scene3DMesh *mesh)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		Scene3DVertex *vert = new Scene3DVertex(controlVertices[gFace->vert[i]]);
+
+		Point3 normal = gMesh->GetNormal(gFace->meshFaceIndex, i);
+		if (mirrored)
+			normal = -normal;
+
+		VertexPacking::PackOctahedral(sm::Vec3(normal.x, normal.y, normal.z), vert->normal);
+
+		Point3 tangent(0.0f, 0.0f, 0.0f);
+		bool negativeBitangent = false;
+
+		int tangentIndex = gMesh->GetFaceVertexTangentBinormal(gFace->meshFaceIndex, i);
+		if (tangentIndex >= 0)
+		{
+			tangent = gMesh->GetTangent(tangentIndex);
+			negativeBitangent = DotProd(CrossProd(normal, tangent), gMesh->GetBinormal(tangentIndex)) < 0;
+		}
+
+		VertexPacking::PackTangent(sm::Vec3(tangent.x, tangent.y, tangent.z), negativeBitangent, vert->tangent);
+
+		for (int coordsIndex = 0; coordsIndex < mesh->coordsCount; coordsIndex++)
+		{
+			int channel = coordsIndex + 1;
+			Point3 uv = gMesh->GetMapVertex(channel, gMesh->GetFaceTextureVertex(gFace->meshFaceIndex, i, channel));
+
+			vert->coords[coordsIndex][0] = VertexPacking::PackHalf(uv.x);
+			vert->coords[coordsIndex][1] = VertexPacking::PackHalf(uv.y);
+		}
+
+		mesh->vertices.push_back(vert);
 	}
 }
 
@@ -335,7 +512,11 @@ bool SGMExporter::GetMeshes(std::vector<Scene3DMesh*> &meshes, BinaryWriter *bw)
 
 	for (int i = 0; i < (int)meshNodes.size(); i++)
 	{
+		report.BeginMesh(meshNodes[i]->GetNodeID(), StringUtils::ToNarrow(meshNodes[i]->GetName()));
+
+		Stopwatch convertTime;
 		Scene3DMesh *mesh = ConvertMesh(meshNodes[i]);
+		report.AddTime(ExportReport::Stage_ConvertMesh, convertTime.GetSeconds());
 
 		if (mesh != NULL)
 		{
@@ -361,11 +542,24 @@ bool SGMExporter::GetMeshes(std::vector<Scene3DMesh*> &meshes, BinaryWriter *bw)
 			mesh->m_worldInverseMatrix.a[14] = m.GetRow(3).z;
 			mesh->m_worldInverseMatrix.a[15] = m.GetRow(3).w;
 
+			for (unsigned j = 0; j < mesh->parts.size(); j++)
+			{
+				MeshPartStats partStats;
+				partStats.Collect(mesh, mesh->parts[j]);
+				report.AddPart(partStats);
+			}
+
 			meshesCount++;
+
+			Stopwatch serializationTime;
 			GeoSaver::SaveMesh(mesh, *bw);
+			report.AddTime(ExportReport::Stage_Serialization, serializationTime.GetSeconds());
+
 			delete mesh;
 		}
 			//meshes.push_back(mesh);
+		else
+			report.SkipMesh();
 
 		StepProgress();
 	}
@@ -387,6 +581,9 @@ bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_i
 	Log::StartLog(true, false, false);
 	Log::LogT("=== exporting skinned mesh to file '%s'", fileName.c_str());
 
+	std::string settingsDir = StringUtils::ToNarrow(max_interface->GetDir(APP_PLUGCFG_DIR));
+	settings.Load(settingsDir + "\\SkinnedMeshExporter.ini");
+
 	scene->SetStaticFrame(0);
 
 	IGameConversionManager *cm = GetConversionManager();
@@ -401,6 +598,7 @@ bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_i
 	}
 
 	meshesCount = 0;
+	report.Clear();
 
 	std::ofstream fileStream(fileName.c_str(), std::ios::binary);
 	BinaryWriter bw(&fileStream);
@@ -410,10 +608,40 @@ bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_i
 	1.2
 		- vertex channels in mesh part
 
+	1.3
+		- animated properties of every type write their keys: int keys
+		  count, then per key float time and the value, bool as uint8 and
+		  vector as three floats. Before only float and int ones did, the
+		  others wrote nothing after the animation type
+
+	1.4
+		- uint8 influences count and uint8 weight bits, 8 or 16, after the
+		  bones of a mesh. A vertex has that many uint8 bone indices, heaviest
+		  first, and as many unorm weights of the weight bits, summing to
+		  exactly the unorm's 1
+
+	1.5
+		- vertices are in parts of at most 256 bones: int parts count after
+		  the weight bits, per part int palette size, int indices into the
+		  mesh's bones, then the part's vertices, bone indices of the
+		  vertices point into the part's palette
+
+	1.6
+		- parts are indexed: the part's unique vertices are followed by uint8
+		  index size, 2 or 4, int index count and the triangle list
+
+	1.7
+		- normals, tangents and uvs: uint8 uv channels count, 0 to 2, after
+		  the weight bits. A part's vertices are in two streams, positions,
+		  bone indices and weights of all of them first, then per vertex two
+		  int16 octahedral snorms of the normal, two of the tangent, the
+		  lowest bit of the second one set when the bitangent is
+		  -cross(normal, tangent), and two half floats per uv channel
+
 	*/
 
 	bw.Write("FTSMDL", 6);
-	bw.Write((unsigned short)((1 << 8) | 2)); // version 1.2
+	bw.Write((unsigned short)((1 << 8) | 7)); // version 1.7
 
 	bw.Write((int)0);
 
@@ -426,6 +654,8 @@ bool SGMExporter::DoExport(const TCHAR *name, ExpInterface *ei, Interface *max_i
 	bw.Write((int)meshesCount);
 	fileStream.close();
 
+	report.Save(fileName + ".stats.json", fileName);
+
 	return true;
 }
 
@@ -14,6 +14,8 @@
 #include "..\..\CommonIncludes\IExportInterface.h"
 
 #include "scene3d\GeoSaver.h"
+#include "ExportReport.h"
+#include "ExportSettings.h"
 
 class SGMExporter : public IExportInterface
 {
@@ -22,10 +24,19 @@ private:
 	std::string fileName;
 
 	IGameScene *scene;
+	ExportReport report;
+	ExportSettings settings;
+
+	// vertices of the mesh being converted that had influences cut or had none
+	unsigned trimmedVerticesCount;
+	unsigned unweightedVerticesCount;
+	unsigned droppedInfluencesCount;
 
 	bool GetMeshes(std::vector<Scene3DMesh*> &meshes, BinaryWriter *bw);
 	Scene3DMesh* ConvertMesh(IGameNode* meshNode);
-	void ExtractVertices(IGameSkin* skin, FaceEx *gFace, IGameMesh *gMesh, std::vector<Scene3DVertex*> &vertices);
+	void CollectInfluences(IGameSkin *skin, IGameMesh *gMesh, Scene3DMesh *mesh, std::vector<Scene3DVertex> &controlVertices);
+	bool IsMirrored(IGameMesh *gMesh);
+	void ExtractVertices(FaceEx *gFace, IGameMesh *gMesh, bool mirrored, const std::vector<Scene3DVertex> &controlVertices, Scene3DMesh *mesh);
 	IGameMaterial* SGMExporter::GetMaterialById( IGameMaterial *mat, int id );
 	void FilterMeshNodes(IGameNode *node, std::vector<IGameNode*> &meshNodes);
 	void CollectProperties(Scene3DMesh *mesh, IGameMesh *gMesh);
@@ -0,0 +1,302 @@
+#include "BonePaletteSplitter.h"
+
+#include <Utils/Log.h>
+
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+
+namespace
+{
+	class PositionKey
+	{
+	public:
+		uint32_t bits[3];
+
+		PositionKey(const sm::Vec3 &position)
+		{
+			float values[3] = { position.x, position.y, position.z };
+
+			for (int i = 0; i < 3; i++)
+			{
+				if (values[i] == 0.0f)
+					values[i] = 0.0f; // -0.0 and 0.0 are the same place
+
+				memcpy(&bits[i], &values[i], sizeof(float));
+			}
+		}
+
+		bool operator==(const PositionKey &other) const
+		{
+			return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+		}
+	};
+
+	class PositionKeyHash
+	{
+	public:
+		size_t operator()(const PositionKey &key) const
+		{
+			return key.bits[0] * 73856093u ^ key.bits[1] * 19349663u ^ key.bits[2] * 83492791u;
+		}
+	};
+}
+
+// builds one part at a time out of triangles not taken yet
+class BonePaletteSplitter::Grower
+{
+public:
+	// sorted bones of each triangle, those with weight only
+	std::vector<std::vector<int> > triangleBones;
+
+	// triangles around each position, and the position of each corner
+	std::vector<std::vector<unsigned> > positionTriangles;
+	std::vector<unsigned> cornerPositions;
+
+	std::vector<int> trianglePart;
+	std::vector<int> bonePart;
+
+	unsigned maxBones;
+	unsigned nextSeed;
+
+	Grower(Scene3DMesh *mesh, unsigned maxBones) :
+		maxBones(maxBones),
+		nextSeed(0)
+	{
+		unsigned trianglesCount = (unsigned)mesh->vertices.size() / 3;
+
+		triangleBones.resize(trianglesCount);
+		trianglePart.resize(trianglesCount, -1);
+		bonePart.resize(mesh->bonesIds.size(), -1);
+		cornerPositions.resize(trianglesCount * 3);
+
+		std::unordered_map<PositionKey, unsigned, PositionKeyHash> positionIds;
+
+		for (unsigned i = 0; i < trianglesCount * 3; i++)
+		{
+			const Scene3DVertex *vert = mesh->vertices[i];
+
+			for (int j = 0; j < mesh->influencesCount; j++)
+				if (vert->weight[j] > 0)
+					triangleBones[i / 3].push_back(vert->boneIndex[j]);
+
+			std::pair<std::unordered_map<PositionKey, unsigned, PositionKeyHash>::iterator, bool> inserted =
+				positionIds.insert(std::make_pair(PositionKey(vert->position), (unsigned)positionIds.size()));
+
+			cornerPositions[i] = inserted.first->second;
+			if (inserted.second)
+				positionTriangles.push_back(std::vector<unsigned>());
+
+			std::vector<unsigned> &triangles = positionTriangles[cornerPositions[i]];
+			if (triangles.size() == 0 || triangles.back() != i / 3)
+				triangles.push_back(i / 3);
+		}
+
+		for (unsigned i = 0; i < trianglesCount; i++)
+		{
+			std::vector<int> &bones = triangleBones[i];
+
+			std::sort(bones.begin(), bones.end());
+			bones.erase(std::unique(bones.begin(), bones.end()), bones.end());
+
+			assert(bones.size() <= maxBones);
+		}
+	}
+
+	unsigned GetNewBonesCount(unsigned triangle, int part) const
+	{
+		unsigned count = 0;
+
+		for (unsigned i = 0; i < triangleBones[triangle].size(); i++)
+			if (bonePart[triangleBones[triangle][i]] != part)
+				count++;
+
+		return count;
+	}
+
+	// false when every triangle is taken
+	bool Grow(int part, std::vector<int> &palette)
+	{
+		while (nextSeed < trianglePart.size() && trianglePart[nextSeed] != -1)
+			nextSeed++;
+
+		if (nextSeed == trianglePart.size())
+			return false;
+
+		std::deque<unsigned> frontier;
+
+		// adjacent triangles that need new bones, taken when no adjacent
+		// triangle fits the palette as it is
+		std::vector<unsigned> growing;
+
+		Take(nextSeed, part, palette, frontier);
+
+		for (;;)
+		{
+			while (frontier.size() > 0)
+			{
+				unsigned triangle = frontier.front();
+				frontier.pop_front();
+
+				if (trianglePart[triangle] != -1)
+					continue;
+
+				unsigned newBones = GetNewBonesCount(triangle, part);
+
+				if (newBones == 0)
+					Take(triangle, part, palette, frontier);
+				else if (palette.size() + newBones <= maxBones)
+					growing.push_back(triangle);
+			}
+
+			int best = -1;
+			unsigned bestNewBones = maxBones + 1;
+			unsigned kept = 0;
+
+			for (unsigned i = 0; i < growing.size(); i++)
+			{
+				unsigned triangle = growing[i];
+				if (trianglePart[triangle] != -1)
+					continue;
+
+				unsigned newBones = GetNewBonesCount(triangle, part);
+				if (palette.size() + newBones > maxBones)
+					continue;
+
+				growing[kept++] = triangle;
+
+				if (newBones < bestNewBones)
+				{
+					best = (int)triangle;
+					bestNewBones = newBones;
+				}
+			}
+
+			growing.resize(kept);
+
+			// nothing around fits, a piece of the mesh elsewhere may
+			if (best == -1)
+			{
+				for (unsigned i = nextSeed; i < trianglePart.size() && bestNewBones > 0; i++)
+				{
+					if (trianglePart[i] != -1)
+						continue;
+
+					unsigned newBones = GetNewBonesCount(i, part);
+					if (palette.size() + newBones <= maxBones && newBones < bestNewBones)
+					{
+						best = (int)i;
+						bestNewBones = newBones;
+					}
+				}
+			}
+
+			if (best == -1)
+				return true;
+
+			Take(best, part, palette, frontier);
+		}
+	}
+
+	void Take(unsigned triangle, int part, std::vector<int> &palette, std::deque<unsigned> &frontier)
+	{
+		trianglePart[triangle] = part;
+
+		for (unsigned i = 0; i < triangleBones[triangle].size(); i++)
+		{
+			int bone = triangleBones[triangle][i];
+
+			if (bonePart[bone] != part)
+			{
+				bonePart[bone] = part;
+				palette.push_back(bone);
+			}
+		}
+
+		for (unsigned i = 0; i < 3; i++)
+		{
+			const std::vector<unsigned> &triangles = positionTriangles[cornerPositions[triangle * 3 + i]];
+
+			for (unsigned j = 0; j < triangles.size(); j++)
+				if (trianglePart[triangles[j]] == -1)
+					frontier.push_back(triangles[j]);
+		}
+	}
+};
+
+void BonePaletteSplitter::Split(Scene3DMesh *mesh, unsigned maxBones)
+{
+	// no bones to split by, vertices are bound to a bone 0 that isn't there
+	if (mesh->bonesIds.size() == 0)
+	{
+		Scene3DMeshPart *part = new Scene3DMeshPart();
+		part->vertices.swap(mesh->vertices);
+		mesh->parts.push_back(part);
+		return;
+	}
+
+	Grower grower(mesh, maxBones);
+
+	std::vector<int> palette;
+	while (grower.Grow((int)mesh->parts.size(), palette))
+	{
+		Scene3DMeshPart *part = new Scene3DMeshPart();
+
+		std::sort(palette.begin(), palette.end());
+		part->palette.swap(palette);
+
+		mesh->parts.push_back(part);
+	}
+
+	// mesh bone to palette index, filled for one part at a time
+	std::vector<int> paletteIndices(mesh->bonesIds.size(), 0);
+
+	for (unsigned i = 0; i < mesh->parts.size(); i++)
+	{
+		Scene3DMeshPart *part = mesh->parts[i];
+
+		for (unsigned j = 0; j < part->palette.size(); j++)
+			paletteIndices[part->palette[j]] = j;
+
+		for (unsigned j = 0; j < grower.trianglePart.size(); j++)
+		{
+			if (grower.trianglePart[j] != (int)i)
+				continue;
+
+			for (unsigned k = 0; k < 3; k++)
+			{
+				Scene3DVertex *vert = mesh->vertices[j * 3 + k];
+
+				// slots without weight keep pointing at the palette's first bone
+				for (int l = 0; l < Scene3DVertex::MaxInfluences; l++)
+					vert->boneIndex[l] = vert->weight[l] > 0 ? (uint16_t)paletteIndices[vert->boneIndex[l]] : 0;
+
+				part->vertices.push_back(vert);
+			}
+		}
+	}
+
+	mesh->vertices.clear();
+
+	// positions used by more than one part, their vertices are stored in each
+	unsigned sharedPositionsCount = 0;
+
+	for (unsigned i = 0; i < grower.positionTriangles.size(); i++)
+	{
+		const std::vector<unsigned> &triangles = grower.positionTriangles[i];
+
+		for (unsigned j = 1; j < triangles.size(); j++)
+		{
+			if (grower.trianglePart[triangles[j]] != grower.trianglePart[triangles[0]])
+			{
+				sharedPositionsCount++;
+				break;
+			}
+		}
+	}
+
+	Log::LogT("split into %d parts of at most %d bones, %d positions shared between parts",
+		(int)mesh->parts.size(), maxBones, sharedPositionsCount);
+}
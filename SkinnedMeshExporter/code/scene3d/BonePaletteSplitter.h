@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Scene3DMesh.h"
+
+// Splits a skinned mesh into parts whose triangles use at most a given
+// number of bones, so every part is drawn with one palette of matrices that
+// fits the shader's constants. Parts grow greedily over adjacent triangles,
+// taking first those that need no new bones and then those that need the
+// fewest, so parts stay connected and few vertices end up in more than one.
+class BonePaletteSplitter
+{
+public:
+	// Moves the mesh's vertices to its parts and remaps their bone indices
+	// to the parts' palettes. maxBones has to fit the bones of any triangle.
+	static void Split(Scene3DMesh *mesh, unsigned maxBones);
+
+private:
+	class Grower;
+};
@@ -1,4 +1,5 @@
 #include "GeoSaver.h"
+#include "MeshPartIndexer.h"
 #include <Graphics/VertexInformation.h>
 #include <Utils/Log.h>
 #include <sstream>
@@ -26,24 +27,79 @@ void GeoSaver::SaveMesh(Scene3DMesh *mesh, BinaryWriter &bw)
 	for (int i = 0; i < (int)mesh->bonesIds.size(); i++)
 		bw.Write(mesh->bonesIds[i]);
 
-	bw.Write((int)mesh->vertices.size());
+	bw.Write((uint8_t)mesh->influencesCount);
+	bw.Write((uint8_t)mesh->weightBits);
+	bw.Write((uint8_t)mesh->coordsCount);
 
-	for (int i = 0; i < (int)mesh->vertices.size(); i++)
+	bw.Write((int)mesh->parts.size());
+
+	for (unsigned i = 0; i < mesh->parts.size(); i++)
+		SaveMeshPart(mesh, mesh->parts[i], bw);
+
+	SaveProperties(mesh, bw);
+}
+
+void GeoSaver::SaveMeshPart(Scene3DMesh *mesh, Scene3DMeshPart *meshPart, BinaryWriter &bw)
+{
+	bw.Write((int)meshPart->palette.size());
+	for (unsigned i = 0; i < meshPart->palette.size(); i++)
+		bw.Write(meshPart->palette[i]);
+
+	bw.Write((int)meshPart->vertices.size());
+
+	// skin stream, all a depth or shadow pass reads
+	for (int i = 0; i < (int)meshPart->vertices.size(); i++)
 	{
-		Scene3DVertex *vert = mesh->vertices[i];
+		Scene3DVertex *vert = meshPart->vertices[i];
 
 		bw.Write(vert->position.x);
 		bw.Write(vert->position.y);
 		bw.Write(vert->position.z);
 
-		for (int boneIndex = 0; boneIndex < 4; boneIndex++)
+		for (int boneIndex = 0; boneIndex < mesh->influencesCount; boneIndex++)
 			bw.Write((uint8_t)vert->boneIndex[boneIndex]);
 
-		for (int boneIndex = 0; boneIndex < 4; boneIndex++)
-			bw.Write(vert->weight[boneIndex]);
+		for (int boneIndex = 0; boneIndex < mesh->influencesCount; boneIndex++)
+		{
+			if (mesh->weightBits == 8)
+				bw.Write((uint8_t)vert->weight[boneIndex]);
+			else
+				bw.Write((uint16_t)vert->weight[boneIndex]);
+		}
 	}
 
-	SaveProperties(mesh, bw);
+	// attribute stream
+	for (int i = 0; i < (int)meshPart->vertices.size(); i++)
+	{
+		Scene3DVertex *vert = meshPart->vertices[i];
+
+		bw.Write((uint16_t)vert->normal[0]);
+		bw.Write((uint16_t)vert->normal[1]);
+		bw.Write((uint16_t)vert->tangent[0]);
+		bw.Write((uint16_t)vert->tangent[1]);
+
+		for (int coordsIndex = 0; coordsIndex < mesh->coordsCount; coordsIndex++)
+		{
+			bw.Write(vert->coords[coordsIndex][0]);
+			bw.Write(vert->coords[coordsIndex][1]);
+		}
+	}
+
+	uint8_t indexSize = MeshPartIndexer::GetIndexSize(meshPart);
+
+	bw.Write(indexSize);
+	bw.Write((int)meshPart->indices.size());
+
+	if (indexSize == 2)
+	{
+		for (unsigned i = 0; i < meshPart->indices.size(); i++)
+			bw.Write((uint16_t)meshPart->indices[i]);
+	}
+	else
+	{
+		for (unsigned i = 0; i < meshPart->indices.size(); i++)
+			bw.Write((uint32_t)meshPart->indices[i]);
+	}
 }
 
 void GeoSaver::SaveProperties(Scene3DMesh *mesh, BinaryWriter &bw)
@@ -78,39 +134,25 @@ void GeoSaver::SaveProperty(Property *prop, BinaryWriter &bw)
 	}
 	else
 	{
-		if (prop->GetPropertyType() == Property::PropertyType_Float)
-		{
-			IInterpolator<float> *inter = prop->GetInterpolator<float>();
+		const std::vector<float> &times = prop->GetKeyTimes();
+		const std::vector<Property::Value> &values = prop->GetKeyValues();
 
-			bw.Write(inter->GetKeysCount());
-
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
-			{
-				float value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
-
-				bw.Write(time);
-				bw.Write(value);
-			}
-		}
+		bw.Write(prop->GetKeysCount());
 
-		if (prop->GetPropertyType() == Property::PropertyType_Int)
+		for (unsigned i = 0; i < times.size(); i++)
 		{
-			IInterpolator<int> *inter = prop->GetInterpolator<int>();
+			bw.Write(times[i]);
 
-			bw.Write(inter->GetKeysCount());
-
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
+			switch (prop->GetPropertyType())
 			{
-				int value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
-
-				bw.Write(time);
-				bw.Write(value);
+			case Property::PropertyType_Boolean: bw.Write(values[i].boolValue); break;
+			case Property::PropertyType_Int: bw.Write(values[i].intValue); break;
+			case Property::PropertyType_Float: bw.Write(values[i].floatValue); break;
+			case Property::PropertyType_Vector3:
+				bw.Write(values[i].vector3Value[0]);
+				bw.Write(values[i].vector3Value[1]);
+				bw.Write(values[i].vector3Value[2]);
+				break;
 			}
 		}
 	}
@@ -150,32 +192,17 @@ void GeoSaver::SavePropertyTxt(Property *prop, BinaryWriter &bw, std::stringstre
 	{
 		data << "\t<property name=\"" << prop->GetName() << "\" type=\"" << prop->GetPropertyType() << "\" anim=\"" << prop->IsAnimatable() << "\" anim_type=\"" << prop->GetAnimationType() << "\">\n";
 
-		if (prop->GetPropertyType() == Property::PropertyType_Float)
-		{
-			IInterpolator<float> *inter = prop->GetInterpolator<float>();
-
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
-			{
-				float value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
-				data << "\t\t<key time=\"" << time << "\" value=\"" << value << "\" />\n";
-			}
-		}
+		const std::vector<float> &times = prop->GetKeyTimes();
+		const std::vector<Property::Value> &values = prop->GetKeyValues();
 
-		if (prop->GetPropertyType() == Property::PropertyType_Int)
+		for (unsigned i = 0; i < times.size(); i++)
 		{
-			IInterpolator<int> *inter = prop->GetInterpolator<int>();
+			data << "\t\t<key time=\"" << times[i] << "\" value=\"";
 
-			for (unsigned i = 0; i < prop->GetKeysCount(); i++)
-			{
-				int value;
-				float time;
-				bool stopKey;
-				inter->GetKeyframe(i, time, value, stopKey);
-				data << "\t\t<key time=\"" << time << "\" value=\"" << value << "\" />\n";
-			}
+			for (unsigned j = 0; j < prop->GetComponentsCount(); j++)
+				data << (j > 0 ? "," : "") << prop->GetComponent(values[i], j);
+
+			data << "\" />\n";
 		}
 
 		data << "\t</property>\n";
@@ -16,6 +16,7 @@ class GeoSaver
 public:
 	static void SaveMeshes(std::vector<Scene3DMesh*> &meshes, std::ostream &os);
 	static void SaveMesh(Scene3DMesh *mesh, BinaryWriter &bw);
+	static void SaveMeshPart(Scene3DMesh *mesh, Scene3DMeshPart *meshPart, BinaryWriter &bw);
 	static void SaveProperties(Scene3DMesh *mesh, BinaryWriter &bw);
 	static void SaveProperty(Property *prop, BinaryWriter &bw);
 	static void SavePropertiesTxt(Scene3DMesh *mesh, BinaryWriter &bw);
@@ -0,0 +1,117 @@
+#include "MeshPartIndexer.h"
+#include <Utils/Log.h>
+
+#include <unordered_map>
+#include <string.h>
+
+namespace
+{
+	uint32_t FloatBits(float value)
+	{
+		if (value == 0.0f)
+			value = 0.0f; // -0.0 and 0.0 must land in the same bucket
+
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(float));
+		return bits;
+	}
+
+	void HashCombine(size_t &hash, uint32_t value)
+	{
+		hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+
+	class VertexHash
+	{
+	public:
+		size_t operator()(const Scene3DVertex *vert) const
+		{
+			size_t hash = 0;
+
+			HashCombine(hash, FloatBits(vert->position.x));
+			HashCombine(hash, FloatBits(vert->position.y));
+			HashCombine(hash, FloatBits(vert->position.z));
+
+			for (int i = 0; i < Scene3DVertex::MaxInfluences; i++)
+				HashCombine(hash, ((uint32_t)vert->boneIndex[i] << 16) | vert->weight[i]);
+
+			HashCombine(hash, ((uint32_t)(uint16_t)vert->normal[0] << 16) | (uint16_t)vert->normal[1]);
+			HashCombine(hash, ((uint32_t)(uint16_t)vert->tangent[0] << 16) | (uint16_t)vert->tangent[1]);
+
+			for (int i = 0; i < Scene3DVertex::MaxCoords; i++)
+				HashCombine(hash, ((uint32_t)vert->coords[i][0] << 16) | vert->coords[i][1]);
+
+			return hash;
+		}
+	};
+
+	// unused influences are always bone 0 with weight 0 and missing uv
+	// channels 0, so all of them can be compared. Attributes are compared
+	// packed, corners that differ less than the packing resolves weld.
+	class VertexEqual
+	{
+	public:
+		bool operator()(const Scene3DVertex *a, const Scene3DVertex *b) const
+		{
+			if (a->position.x != b->position.x || a->position.y != b->position.y || a->position.z != b->position.z)
+				return false;
+
+			for (int i = 0; i < Scene3DVertex::MaxInfluences; i++)
+				if (a->boneIndex[i] != b->boneIndex[i] || a->weight[i] != b->weight[i])
+					return false;
+
+			if (a->normal[0] != b->normal[0] || a->normal[1] != b->normal[1] ||
+				a->tangent[0] != b->tangent[0] || a->tangent[1] != b->tangent[1])
+				return false;
+
+			for (int i = 0; i < Scene3DVertex::MaxCoords; i++)
+				if (a->coords[i][0] != b->coords[i][0] || a->coords[i][1] != b->coords[i][1])
+					return false;
+
+			return true;
+		}
+	};
+}
+
+void MeshPartIndexer::Weld(Scene3DMeshPart *meshPart)
+{
+	if (meshPart->indices.size() > 0)
+		return;
+
+	typedef std::unordered_map<const Scene3DVertex*, uint32_t, VertexHash, VertexEqual> VertexMap;
+
+	VertexMap uniqueVertices(meshPart->vertices.size());
+
+	std::vector<Scene3DVertex*> vertices;
+	vertices.reserve(meshPart->vertices.size() / 2);
+
+	meshPart->indices.resize(meshPart->vertices.size());
+
+	for (unsigned i = 0; i < meshPart->vertices.size(); i++)
+	{
+		Scene3DVertex *vert = meshPart->vertices[i];
+
+		VertexMap::iterator it = uniqueVertices.find(vert);
+		if (it != uniqueVertices.end())
+		{
+			meshPart->indices[i] = it->second;
+			delete vert;
+		}
+		else
+		{
+			uint32_t index = (uint32_t)vertices.size();
+			uniqueVertices[vert] = index;
+			vertices.push_back(vert);
+			meshPart->indices[i] = index;
+		}
+	}
+
+	Log::LogT("welded %d corners into %d vertices", (int)meshPart->indices.size(), (int)vertices.size());
+
+	meshPart->vertices.swap(vertices);
+}
+
+uint8_t MeshPartIndexer::GetIndexSize(const Scene3DMeshPart *meshPart)
+{
+	return meshPart->vertices.size() <= MaxVertices16Bit ? 2 : 4;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Scene3DMeshPart.h"
+
+class MeshPartIndexer
+{
+public:
+	static const unsigned MaxVertices16Bit = 65535;
+
+	// Replaces the per-corner vertex soup of the part with unique vertices and
+	// an index buffer. Vertices are equal when position, bones and weights are.
+	static void Weld(Scene3DMeshPart *meshPart);
+
+	// Size of a single index in bytes, the smallest one that can address every vertex of the part.
+	static uint8_t GetIndexSize(const Scene3DMeshPart *meshPart);
+};
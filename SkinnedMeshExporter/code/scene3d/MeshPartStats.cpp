@@ -0,0 +1,106 @@
+#include "MeshPartStats.h"
+#include "MeshPartIndexer.h"
+
+#include <algorithm>
+
+MeshPartStats::MeshPartStats() :
+	cornersCount(0),
+	uniqueVerticesCount(0),
+	storedVerticesCount(0),
+	vertexSize(0),
+	indexSize(0),
+	acmr(-1.0f)
+{
+	boundsMin.Set(0.0f, 0.0f, 0.0f);
+	boundsMax.Set(0.0f, 0.0f, 0.0f);
+}
+
+void MeshPartStats::Collect(const Scene3DMesh *mesh, const Scene3DMeshPart *meshPart)
+{
+	materialName = mesh->materialName;
+
+	cornersCount = (unsigned)meshPart->indices.size();
+	uniqueVerticesCount = (unsigned)meshPart->vertices.size();
+	storedVerticesCount = uniqueVerticesCount;
+	indexSize = MeshPartIndexer::GetIndexSize(meshPart);
+	acmr = CalculateAcmr(meshPart->indices, uniqueVerticesCount, CacheSize);
+
+	if (meshPart->vertices.size() > 0)
+	{
+		boundsMin = meshPart->vertices[0]->position;
+		boundsMax = boundsMin;
+	}
+
+	for (unsigned i = 1; i < meshPart->vertices.size(); i++)
+	{
+		const sm::Vec3 &p = meshPart->vertices[i]->position;
+		boundsMin.Set(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+		boundsMax.Set(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+	}
+
+	CollectAttribBytes(mesh);
+}
+
+void MeshPartStats::CollectAttribBytes(const Scene3DMesh *mesh)
+{
+	// sizes follow GeoSaver::SaveMeshPart, skin stream then attribute stream
+	attribBytes.clear();
+	attribBytes.push_back(AttribBytes("position", 3 * sizeof(float)));
+	attribBytes.push_back(AttribBytes("bone_indices", mesh->influencesCount * sizeof(uint8_t)));
+	attribBytes.push_back(AttribBytes("bone_weights", mesh->influencesCount * mesh->weightBits / 8));
+	attribBytes.push_back(AttribBytes("normal", 2 * sizeof(int16_t)));
+	attribBytes.push_back(AttribBytes("tangent", 2 * sizeof(int16_t)));
+	attribBytes.push_back(AttribBytes("coords", mesh->coordsCount * 2 * sizeof(uint16_t)));
+
+	vertexSize = 0;
+
+	for (unsigned i = 0; i < attribBytes.size(); i++)
+	{
+		vertexSize += attribBytes[i].bytes;
+		attribBytes[i].bytes *= storedVerticesCount;
+	}
+}
+
+float MeshPartStats::GetRedundancy() const
+{
+	if (uniqueVerticesCount == 0)
+		return 0.0f;
+
+	return (float)cornersCount / (float)uniqueVerticesCount;
+}
+
+unsigned MeshPartStats::GetVerticesBytes() const
+{
+	return vertexSize * storedVerticesCount;
+}
+
+unsigned MeshPartStats::GetIndicesBytes() const
+{
+	return indexSize * cornersCount;
+}
+
+float MeshPartStats::CalculateAcmr(const std::vector<uint32_t> &indices, unsigned verticesCount, unsigned cacheSize)
+{
+	unsigned trianglesCount = (unsigned)indices.size() / 3;
+	if (trianglesCount == 0)
+		return 0.0f;
+
+	// a vertex is still in the FIFO if less than cacheSize misses happened since it was pushed
+	std::vector<unsigned> pushedAt(verticesCount, 0);
+	std::vector<bool> pushed(verticesCount, false);
+	unsigned misses = 0;
+
+	for (unsigned i = 0; i < trianglesCount * 3; i++)
+	{
+		uint32_t index = indices[i];
+
+		if (!pushed[index] || misses - pushedAt[index] >= cacheSize)
+		{
+			pushed[index] = true;
+			pushedAt[index] = misses;
+			misses++;
+		}
+	}
+
+	return (float)misses / (float)trianglesCount;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Scene3DVertex.h"
+#include "Scene3DMeshPart.h"
 #include <Math\Vec3.h>
 #include <Math\Matrix.h>
 #include <Math\Vec2.h>
@@ -14,19 +15,47 @@ public:
 	std::string name;
 
 	std::vector<int> bonesIds;
+
+	// every corner of every triangle while the mesh is converted, moved to
+	// the parts when it's split into bone palettes
 	std::vector<Scene3DVertex*> vertices;
+	std::vector<Scene3DMeshPart*> parts;
+
+	// influences every vertex stores, the most any vertex kept, and bits of a weight
+	int influencesCount;
+	int weightBits;
+
+	// uv channels in the attribute stream, 0 to Scene3DVertex::MaxCoords
+	int coordsCount;
 
 	std::vector<Property*> properties;
 	sm::Matrix m_worldInverseMatrix;
 
 	std::string materialName;
 
+	Scene3DMesh() :
+		influencesCount(0),
+		weightBits(8),
+		coordsCount(0)
+	{
+	}
+
 	~Scene3DMesh()
 	{
 		for (unsigned i = 0; i < vertices.size(); i++)
 			delete vertices[i];
 
 		vertices.clear();
+
+		for (unsigned i = 0; i < parts.size(); i++)
+			delete parts[i];
+
+		parts.clear();
+
+		for (unsigned i = 0; i < properties.size(); i++)
+			delete properties[i];
+
+		properties.clear();
 	}
 };
 
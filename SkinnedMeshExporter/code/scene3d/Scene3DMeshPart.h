@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include "Scene3DVertex.h"
+
+// Triangles of a skinned mesh drawn with one bone palette, bone indices of
+// its vertices point into the palette instead of into the mesh's bones
+class Scene3DMeshPart
+{
+public:
+	// indices into the mesh's bonesIds
+	std::vector<int> palette;
+
+	std::vector<Scene3DVertex*> vertices;
+	std::vector<uint32_t> indices;
+
+	~Scene3DMeshPart()
+	{
+		for (unsigned i = 0; i < vertices.size(); i++)
+			delete vertices[i];
+
+		vertices.clear();
+	}
+};
@@ -3,10 +3,27 @@
 #include <Math\Vec3.h>
 #include <Math\Vec2.h>
 
+#include <stdint.h>
+
 class Scene3DVertex
 {
 public:
+	static const int MaxInfluences = 8;
+	static const int MaxCoords = 2;
+
 	sm::Vec3 position;
-	uint8_t boneIndex[4];
-	float weight[4];
+
+	// heaviest first, unused ones are bone 0 with weight 0. Indices into the
+	// mesh's bones, into the part's palette once the mesh is split
+	uint16_t boneIndex[MaxInfluences];
+
+	// unorm of the mesh's weight bits, the weights of a vertex sum to exactly its 1
+	uint16_t weight[MaxInfluences];
+
+	// the rest goes to the attribute stream already packed, see VertexPacking:
+	// octahedral normal, octahedral tangent with the bitangent's sign in the
+	// lowest bit and halves of the uv channels
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t coords[MaxCoords][2];
 };
@@ -0,0 +1,103 @@
+#include "SkinInfluences.h"
+
+#include <algorithm>
+#include <math.h>
+
+// heavier first, lower bone first for equal weights, so results don't
+// depend on the order 3ds Max lists the bones in
+class SkinInfluences::InfluenceGreater
+{
+public:
+	bool operator()(const Influence &a, const Influence &b) const
+	{
+		if (a.weight != b.weight)
+			return a.weight > b.weight;
+
+		return a.bone < b.bone;
+	}
+};
+
+unsigned SkinInfluences::Pack(std::vector<Influence> &influences, unsigned maxCount, float threshold, unsigned weightBits, Scene3DVertex *vertex)
+{
+	uint32_t one = (1u << weightBits) - 1;
+
+	for (int i = 0; i < Scene3DVertex::MaxInfluences; i++)
+	{
+		vertex->boneIndex[i] = 0;
+		vertex->weight[i] = 0;
+	}
+
+	std::sort(influences.begin(), influences.end(), InfluenceGreater());
+
+	unsigned count = std::min((unsigned)influences.size(), std::min(maxCount, (unsigned)Scene3DVertex::MaxInfluences));
+
+	float sum = 0.0f;
+	for (unsigned i = 0; i < count; i++)
+		sum += std::max(influences[i].weight, 0.0f);
+
+	if (count == 0 || sum <= 0.0f)
+	{
+		vertex->weight[0] = (uint16_t)one;
+		return 0;
+	}
+
+	// threshold applies to the weights as the vertex keeps them
+	unsigned kept = 1;
+	while (kept < count && influences[kept].weight / sum >= threshold)
+		kept++;
+
+	sum = 0.0f;
+	for (unsigned i = 0; i < kept; i++)
+		sum += influences[i].weight;
+
+	// Largest remainder: weights are rounded down and what's missing to 1
+	// goes one step each to the weights that lost the most
+	uint32_t quantized[Scene3DVertex::MaxInfluences];
+	float remainders[Scene3DVertex::MaxInfluences];
+	uint32_t quantizedSum = 0;
+
+	for (unsigned i = 0; i < kept; i++)
+	{
+		float scaled = influences[i].weight / sum * (float)one;
+
+		quantized[i] = std::min((uint32_t)floorf(scaled), one);
+		remainders[i] = scaled - (float)quantized[i];
+		quantizedSum += quantized[i];
+	}
+
+	while (quantizedSum < one)
+	{
+		unsigned largest = 0;
+		for (unsigned i = 1; i < kept; i++)
+			if (remainders[i] > remainders[largest])
+				largest = i;
+
+		quantized[largest]++;
+		remainders[largest] -= 1.0f;
+		quantizedSum++;
+	}
+
+	while (quantizedSum > one)
+	{
+		unsigned smallest = 0;
+		for (unsigned i = 1; i < kept; i++)
+			if (quantized[i] > 0 && (quantized[smallest] == 0 || remainders[i] < remainders[smallest]))
+				smallest = i;
+
+		quantized[smallest]--;
+		remainders[smallest] += 1.0f;
+		quantizedSum--;
+	}
+
+	// weights rounded down to nothing are dropped, they're last
+	while (kept > 1 && quantized[kept - 1] == 0)
+		kept--;
+
+	for (unsigned i = 0; i < kept; i++)
+	{
+		vertex->boneIndex[i] = (uint16_t)influences[i].bone;
+		vertex->weight[i] = (uint16_t)quantized[i];
+	}
+
+	return kept;
+}
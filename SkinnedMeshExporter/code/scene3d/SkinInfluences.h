@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Scene3DVertex.h"
+
+#include <vector>
+
+// Bone influences of a vertex brought to what the vertex stores: at most a
+// given count of the heaviest ones, light ones dropped and the rest scaled
+// back to 1, then quantized so the integer weights sum to exactly the
+// unorm's 1 and the shader doesn't lose or gain weight to rounding.
+class SkinInfluences
+{
+public:
+	class Influence
+	{
+	public:
+		int bone;
+		float weight;
+	};
+
+	// Fills the vertex's bones and weights and returns the number of
+	// influences kept. A vertex without any weight gets all of it from
+	// bone 0 and 0 is returned.
+	static unsigned Pack(std::vector<Influence> &influences, unsigned maxCount, float threshold, unsigned weightBits, Scene3DVertex *vertex);
+
+private:
+	class InfluenceGreater;
+};
@@ -0,0 +1,96 @@
+#include "VertexPacking.h"
+
+#include <math.h>
+#include <string.h>
+
+void VertexPacking::PackOctahedral(const sm::Vec3 &vector, int16_t packed[2])
+{
+	float length = fabsf(vector.x) + fabsf(vector.y) + fabsf(vector.z);
+	if (length == 0.0f)
+	{
+		packed[0] = 0;
+		packed[1] = 0;
+		return;
+	}
+
+	float x = vector.x / length;
+	float y = vector.y / length;
+
+	// the lower half folds over the diagonals onto the corners of the square
+	if (vector.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+		x = foldedX;
+		y = foldedY;
+	}
+
+	packed[0] = PackSnorm16(x);
+	packed[1] = PackSnorm16(y);
+}
+
+void VertexPacking::PackTangent(const sm::Vec3 &tangent, bool negativeBitangent, int16_t packed[2])
+{
+	PackOctahedral(tangent, packed);
+
+	packed[1] = (int16_t)((packed[1] & ~1) | (negativeBitangent ? 1 : 0));
+}
+
+uint16_t VertexPacking::PackHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	// infinity stays infinity, nan stays nan
+	if (exponent == 0xff)
+		return (uint16_t)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+
+	int halfExponent = (int)exponent - 127 + 15;
+
+	if (halfExponent >= 31)
+		return (uint16_t)(sign | 0x7c00);
+
+	if (halfExponent <= 0)
+	{
+		// below half's smallest subnormal
+		if (halfExponent < -10)
+			return (uint16_t)sign;
+
+		// subnormal, the implicit 1 becomes explicit
+		mantissa |= 0x800000;
+
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		if (rest > halfway || (rest == halfway && (half & 1) != 0))
+			half++;
+
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+
+	// a carry out of the mantissa moves to the next exponent, up to infinity
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1) != 0))
+		half++;
+
+	return (uint16_t)(sign | half);
+}
+
+int16_t VertexPacking::PackSnorm16(float value)
+{
+	if (value > 1.0f)
+		value = 1.0f;
+	if (value < -1.0f)
+		value = -1.0f;
+
+	return (int16_t)floorf(value * 32767.0f + 0.5f);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Math\Vec3.h>
+
+#include <stdint.h>
+
+// Compact encodings of vertex attributes, decoded by the vertex shader
+class VertexPacking
+{
+public:
+	// Unit vector folded onto an octahedron and unfolded into a square,
+	// two snorm16 with an error well under what 8-bit normal maps resolve.
+	// A zero vector comes out as 0, 0, which decodes to +z.
+	static void PackOctahedral(const sm::Vec3 &vector, int16_t packed[2]);
+
+	// Tangent as an octahedral pair, with the lowest bit of the second one
+	// set when the bitangent is -cross(normal, tangent)
+	static void PackTangent(const sm::Vec3 &tangent, bool negativeBitangent, int16_t packed[2]);
+
+	// IEEE 754 half, rounded to nearest even, out of range values become infinity
+	static uint16_t PackHalf(float value);
+
+private:
+	static int16_t PackSnorm16(float value);
+};